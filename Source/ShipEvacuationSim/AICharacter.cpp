@@ -1,16 +1,28 @@
 #include "AICharacter.h"
 #include "AgentMovementComponent.h"
+#include "Crowd/AgentPoolSubsystem.h"
+#include "Crowd/AgentSpatialGridSubsystem.h"
+#include "Crowd/CrowdSchedulerSubsystem.h"
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Logging/SimulationLogSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Navigation/FlowFieldSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Navigation/NavQuerySubsystem.h"
+#include "SimulationInstance.h"
 #include "AIController.h"
+#include "BrainComponent.h"
 #include "NavigationSystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Components/MeshComponent.h"
 
 // Constructor
 AAiCharacter::AAiCharacter(const FObjectInitializer& ObjectInitializer)
     : Super(ObjectInitializer.SetDefaultSubobjectClass<UAgentMovementComponent>(CharacterMovementComponentName))
 {
-    PrimaryActorTick.bCanEverTick = true;
-    PrimaryActorTick.TickInterval = FMath::FRandRange(0.2f, 0.5f);
+    // Repulsion, capsule resizing and recovery are batched by UCrowdUpdateSubsystem
+    PrimaryActorTick.bCanEverTick = false;
     
     GetCharacterMovement()->bUseRVOAvoidance = true;
 }
@@ -20,10 +32,17 @@ void AAiCharacter::BeginPlay()
 {
     Super::BeginPlay();
 
-    float ThrotleRandomOffset = FMath::FRandRange(0.25f, 0.35f);
-    GetWorldTimerManager().SetTimer(ThrottledUpdateTimer, this, &AAiCharacter::ThrottledUpdate, ThrotleRandomOffset, true);
-    float StuckRandomOffset = FMath::FRandRange(2.0f, 3.5f);
-    GetWorldTimerManager().SetTimer(StuckCheckTimer, this, &AAiCharacter::CheckIfStuck, StuckRandomOffset, true);
+    // Replays draw recorded agents instead of simulating them
+    const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+    if (GameInstance && GameInstance->IsReplaying())
+    {
+        if (AController* AgentController = GetController())
+        {
+            AgentController->Destroy();
+        }
+        Destroy();
+        return;
+    }
 
     // Initial Avoidance setup
     GetCharacterMovement()->AvoidanceConsiderationRadius = 50;
@@ -33,69 +52,206 @@ void AAiCharacter::BeginPlay()
     DefaultCapsuleHalfHeight = GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
     LastLocation = GetActorLocation();
 
-    StartNavMeshRecoveryCheck();
+    // Restored when a pooled agent is reused, in case it wears the mustered material
+    TInlineComponentArray<UMeshComponent*> Meshes(this);
+    for (const UMeshComponent* Mesh : Meshes)
+    {
+        if (Mesh->GetNumMaterials() > 0)
+        {
+            DefaultBodyMaterial = Mesh->GetMaterial(0);
+            break;
+        }
+    }
+
+    // Neighbours come from the spatial grid, so agent-vs-agent overlap events are not needed
+    if (GetCapsuleComponent()->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Overlap)
+    {
+        GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+    }
+
+    RegisterWithCrowd();
 }
 
-// Tick
-void AAiCharacter::Tick(float DeltaTime)
+// EndPlay
+void AAiCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-    Super::Tick(DeltaTime);
+    UnregisterFromCrowd();
+
+    Super::EndPlay(EndPlayReason);
+}
 
-    // Repulsion behavior
-    FVector RepulsionForce = FVector::ZeroVector;
-    for (AActor* Other : NearbyAgentsCache)
+void AAiCharacter::RegisterWithCrowd()
+{
+    if (UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>())
     {
-        if (Other == this) continue;
+        Grid->RegisterAgent(this);
+    }
 
-        FVector ToOther = GetActorLocation() - Other->GetActorLocation();
-        float Distance = ToOther.Size();
-        if (Distance < 80.0f && Distance > KINDA_SMALL_NUMBER)
-        {
-            float Strength = (20.0f - Distance) / 20.0f;
-            RepulsionForce += ToOther.GetSafeNormal() * Strength;
-        }
+    if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Crowd->RegisterAgent(this);
     }
 
-    RepulsionForce = RepulsionForce.GetClampedToMaxSize(1.0f);
-    
-    FVector VelocityNorm = GetVelocity().GetSafeNormal();
-    bool bHasMovement = !GetVelocity().IsNearlyZero();
+    // Throttled update, stuck check and navmesh check
+    if (UCrowdSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UCrowdSchedulerSubsystem>())
+    {
+        Scheduler->RegisterAgent(this);
+    }
+}
 
-    FVector RepulsionForceClamped = RepulsionForce.GetClampedToMaxSize(1.0f);
-    FVector FinalDirection = (bHasMovement ? VelocityNorm : FVector::ZeroVector) + RepulsionForceClamped * 2.0f;
+void AAiCharacter::UnregisterFromCrowd()
+{
+    if (UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>())
+    {
+        Grid->UnregisterAgent(this);
+    }
 
-    FinalDirection = FinalDirection.GetSafeNormal();
+    if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Crowd->UnregisterAgent(this);
+    }
 
-    // Only add movement input if there's a meaningful direction
-    if (!FinalDirection.IsNearlyZero())
+    if (UCrowdSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UCrowdSchedulerSubsystem>())
     {
-        // Optional: only move if repulsion is strong or agent is already moving
-        if (bHasMovement || RepulsionForceClamped.SizeSquared() > 0.01f)
+        Scheduler->UnregisterAgent(this);
+    }
+}
+
+// Demographics
+void AAiCharacter::SetBodyMaterial(UMaterialInterface* Material)
+{
+    if (!Material) return;
+
+    TInlineComponentArray<UMeshComponent*> Meshes(this);
+    for (UMeshComponent* Mesh : Meshes)
+    {
+        if (Mesh->GetNumMaterials() > 0)
         {
-            AddMovementInput(FinalDirection, 1.0f);
+            Mesh->SetMaterial(0, Material);
         }
     }
+}
+
+// Agent Pool
+void AAiCharacter::DeactivateForPool()
+{
+    UnregisterFromCrowd();
+    StopFollowingFlowField();
+    GetWorldTimerManager().ClearAllTimersForObject(this);
 
-    // Capsule resizing interpolation
-    if (bIsResizingCapsule)
+    // Mustered agents have already given up their controller
+    if (AController* AgentController = GetController())
     {
-        float CurrentRadius = GetCapsuleComponent()->GetUnscaledCapsuleRadius();
-        float CurrentHalfHeight = GetCapsuleComponent()->GetUnscaledCapsuleHalfHeight();
-        float NewRadius = FMath::FInterpTo(CurrentRadius, TargetCapsuleRadius, DeltaTime, ResizeSpeed);
-        float NewHalfHeight = FMath::FInterpTo(CurrentHalfHeight, TargetCapsuleHalfHeight, DeltaTime, ResizeSpeed);
+        PooledController = AgentController;
+        AgentController->UnPossess();
+    }
 
-        GetCapsuleComponent()->SetCapsuleSize(NewRadius, NewHalfHeight, true);
+    UCharacterMovementComponent* MoveComp = GetCharacterMovement();
+    MoveComp->StopMovementImmediately();
+    MoveComp->DisableMovement();
 
-        if (FMath::IsNearlyEqual(NewRadius, TargetCapsuleRadius, 0.5f) &&
-            FMath::IsNearlyEqual(NewHalfHeight, TargetCapsuleHalfHeight, 0.5f))
+    SetActorHiddenInGame(true);
+    SetActorEnableCollision(false);
+    bInAgentPool = true;
+}
+
+void AAiCharacter::ActivateFromPool(const FVector& Location, const FRotator& Rotation)
+{
+    SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+    SetActorHiddenInGame(false);
+    SetActorEnableCollision(true);
+    bInAgentPool = false;
+
+    // Per-run state back to what BeginPlay starts with
+    bHasMustered = false;
+    bWaitingToRespond = false;
+    bSimulationReduced = false;
+    bIsRecovering = false;
+    bCapsuleShrunk = false;
+    bIsResizingCapsule = false;
+    CustomAvoidanceWeight = 0.0f;
+    NavWidthEstimate = 0.0f;
+    TimeSinceLastMove = 0.0f;
+    LastLocation = Location;
+    GetCapsuleComponent()->SetCapsuleSize(DefaultCapsuleRadius, DefaultCapsuleHalfHeight);
+    SetBodyMaterial(DefaultBodyMaterial);
+
+    UCharacterMovementComponent* MoveComp = GetCharacterMovement();
+    MoveComp->SetMovementMode(MOVE_Walking);
+    MoveComp->MaxWalkSpeed = WalkSpeedOnFlat;
+    MoveComp->AvoidanceConsiderationRadius = 50;
+
+    const UAgentMovementComponent* AgentMovement = Cast<UAgentMovementComponent>(MoveComp);
+    MoveComp->SetAvoidanceEnabled(!AgentMovement || !AgentMovement->UsesOrcaAvoidance());
+
+    RegisterWithCrowd();
+
+    // Possessing again restarts the behavior tree
+    if (!GetController())
+    {
+        if (AController* AgentController = PooledController.Get())
+        {
+            AgentController->Possess(this);
+        }
+        else
         {
-            bIsResizingCapsule = false;
+            SpawnDefaultController();
         }
     }
+    PooledController.Reset();
+}
 
-    if (bIsRecovering)
+void AAiCharacter::DestroyForReset()
+{
+    if (AController* AgentController = GetController())
     {
-        SmoothRecoverToNavMesh(DeltaTime);
+        AgentController->UnPossess();
+        AgentController->Destroy();
+    }
+
+    if (AController* AgentController = PooledController.Get())
+    {
+        AgentController->Destroy();
+    }
+    PooledController.Reset();
+
+    Destroy();
+}
+
+// Response Time
+void AAiCharacter::WaitForResponseTime()
+{
+    if (Demographics.Awareness <= 0.0f) return;
+
+    AAIController* AIController = Cast<AAIController>(GetController());
+    UBrainComponent* Brain = AIController ? AIController->GetBrainComponent() : nullptr;
+    if (!Brain) return;
+
+    Brain->PauseLogic(TEXT("ResponseTime"));
+    AIController->StopMovement();
+    bWaitingToRespond = true;
+
+    GetWorldTimerManager().SetTimer(ResponseTimer, this, &AAiCharacter::Respond, Demographics.Awareness, false);
+}
+
+void AAiCharacter::Respond()
+{
+    bWaitingToRespond = false;
+
+    // Time spent waiting does not count towards being stuck
+    LastLocation = GetActorLocation();
+    TimeSinceLastMove = 0.0f;
+
+    AAIController* AIController = Cast<AAIController>(GetController());
+    if (UBrainComponent* Brain = AIController ? AIController->GetBrainComponent() : nullptr)
+    {
+        Brain->ResumeLogic(TEXT("ResponseTime"));
+    }
+
+    // Agents still waiting to respond are not a stalled run
+    if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Crowd->NotifyAgentProgress();
     }
 }
 
@@ -110,7 +266,10 @@ void AAiCharacter::ShrinkCapsule()
         TargetCapsuleRadius = DefaultCapsuleRadius * 0.7f;
         TargetCapsuleHalfHeight = DefaultCapsuleHalfHeight * 0.8f;
 
-        GetWorldTimerManager().SetTimer(CapsuleResetTimer, this, &AAiCharacter::RestoreCapsule, 2.0f, false);
+        if (UCrowdSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UCrowdSchedulerSubsystem>())
+        {
+            Scheduler->ScheduleOnce(this, ECrowdTask::RestoreCapsule, 2.0f);
+        }
     }
 }
 
@@ -127,11 +286,28 @@ void AAiCharacter::RestoreCapsule()
 // Updates
 void AAiCharacter::ThrottledUpdate()
 {
-    // Adjust movement speed based on vertical velocity
-    float VerticalSpeed = GetVelocity().Z;
-    GetCharacterMovement()->MaxWalkSpeed = FMath::Abs(VerticalSpeed) > 20.0f ? WalkSpeedOnStairs : WalkSpeedOnFlat;
-    
-    float NavWidth = EstimateNavMeshWidth(50.0f);
+    SIM_SCOPE_CYCLE_COUNTER(ThrottledUpdate);
+
+    float NavWidth = 0.f;
+
+    // Baked metadata gives stairs and width in one lookup; fall back to probing the navmesh without it
+    FNavMetadataSample NavMeta;
+    const UNavMetadataSubsystem* NavMetaSubsystem = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+    if (NavMetaSubsystem && NavMetaSubsystem->Lookup(GetNavAgentLocation(), NavMeta))
+    {
+        GetCharacterMovement()->MaxWalkSpeed = NavMeta.bStairs ? WalkSpeedOnStairs : WalkSpeedOnFlat;
+        NavWidth = NavMeta.ClearWidth;
+    }
+    else
+    {
+        // Adjust movement speed based on vertical velocity
+        float VerticalSpeed = GetVelocity().Z;
+        GetCharacterMovement()->MaxWalkSpeed = FMath::Abs(VerticalSpeed) > 20.0f ? WalkSpeedOnStairs : WalkSpeedOnFlat;
+
+        // Answered next frame, so this update uses the previous estimate
+        UpdateNavMeshWidthEstimate(50.0f);
+        NavWidth = NavWidthEstimate;
+    }
 
     // In tight spaces (width ≈ 80), we want high avoidance weight (e.g. 30)
     // In open spaces (width ≈ 200+), we want low avoidance weight (e.g. 10)
@@ -143,12 +319,15 @@ void AAiCharacter::ThrottledUpdate()
 
     GetCharacterMovement()->AvoidanceWeight = ScaledWeight;
 
-    NearbyAgentsCache = GetNearbyAgents();
-    //AdjustAvoidanceWeight(NearbyAgentsCache.Num());
+    //AdjustAvoidanceWeight(GetNearbyAgentsCount());
 }
 
 void AAiCharacter::CheckIfStuck()
 {
+    SIM_SCOPE_CYCLE_COUNTER(StuckCheck);
+
+    if (bWaitingToRespond) return;
+
     float DistanceMoved = FVector::Dist(GetActorLocation(), LastLocation);
 
     if (DistanceMoved < 5.0f)
@@ -159,10 +338,16 @@ void AAiCharacter::CheckIfStuck()
     {
         TimeSinceLastMove = 0.0f;
         LastLocation = GetActorLocation();
+
+        if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+        {
+            Crowd->NotifyAgentProgress();
+        }
     }
 
     if (TimeSinceLastMove > 2.0f && !bCapsuleShrunk)
     {
+        LogEvent(EAgentLogEvent::Stuck);
         ShrinkCapsule();
 
         if (IsOnStairs())
@@ -176,22 +361,27 @@ void AAiCharacter::CheckIfStuck()
 TArray<AActor*> AAiCharacter::GetNearbyAgents()
 {
     TArray<AActor*> NearbyAgents;
-    if (UCapsuleComponent* Capsule = GetCapsuleComponent())
+    if (const UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>())
     {
-        Capsule->GetOverlappingActors(NearbyAgents, AAiCharacter::StaticClass());
+        Grid->ForEachInRadius(GetActorLocation(), NeighbourRadius, false, [&](int32 Slot)
+        {
+            AAiCharacter* Other = Grid->GetAgentInSlot(Slot);
+            if (Other != this)
+            {
+                NearbyAgents.Add(Other);
+            }
+        });
     }
     return NearbyAgents;
 }
 
 int32 AAiCharacter::GetNearbyAgentsCount()
 {
-    TArray<AActor*> OverlappingActors;
-    GetCapsuleComponent()->GetOverlappingActors(OverlappingActors);
+    const UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>();
+    if (!Grid) return 0;
 
-    return OverlappingActors.FilterByPredicate([](AActor* Actor)
-    {
-        return Actor->IsA(AAiCharacter::StaticClass());
-    }).Num();
+    // The grid includes this agent
+    return FMath::Max(0, Grid->CountInRadius(GetActorLocation(), NeighbourRadius) - 1);
 }
 
 void AAiCharacter::AdjustAvoidanceWeight(int32 NearbyAgents)
@@ -207,74 +397,86 @@ void AAiCharacter::AdjustAvoidanceWeight(int32 NearbyAgents)
 // NavMesh Recovery
 void AAiCharacter::CheckNavMeshRecovery()
 {
+    SIM_SCOPE_CYCLE_COUNTER(NavRecoveryCheck);
+
     if (bIsRecovering) return;
 
-    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
-    if (!NavSys) return;
+    UNavQuerySubsystem* NavQueries = GetWorld()->GetSubsystem<UNavQuerySubsystem>();
+    if (!NavQueries) return;
 
-    FNavLocation ProjectedLocation;
-    if (!NavSys->ProjectPointToNavigation(GetActorLocation(), ProjectedLocation, FVector(100.f)))
+    NavQueries->ProjectPoint(this, GetActorLocation(), FVector(100.f), [this, NavQueries](const FNavQueryResult& OnNavMesh)
     {
-        UE_LOG(LogTemp, Warning, TEXT("Agent %s is off the navmesh."), *GetName());
-    
-        FVector Fallback = FindClosestValidPoint(); // <- See below for implementation
-        RecoveryTargetLocation = Fallback;
-        bIsRecovering = true;
+        if (OnNavMesh.bSuccess || bIsRecovering || bHasMustered) return;
 
-        GetCharacterMovement()->DisableMovement();
-    }
-}
+        UE_LOG(LogTemp, Warning, TEXT("Agent %s is off the navmesh."), *GetName());
+        LogEvent(EAgentLogEvent::OffNavMesh);
 
-FVector AAiCharacter::FindClosestValidPoint()
-{
-    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
-    if (!NavSys) return GetActorLocation(); // fail-safe
+        // Closest valid point within a bigger radius, staying put if there is none
+        NavQueries->ProjectPoint(this, GetActorLocation(), FVector(500.f), [this](const FNavQueryResult& Closest)
+        {
+            if (bIsRecovering || bHasMustered) return;
 
-    FNavLocation ValidLocation;
-    bool bFound = NavSys->ProjectPointToNavigation(GetActorLocation(), ValidLocation, FVector(500.f)); // bigger radius
+            RecoveryTargetLocation = Closest.bSuccess ? Closest.Location : GetActorLocation();
+            bIsRecovering = true;
 
-    return bFound ? ValidLocation.Location : GetActorLocation(); // safer fallback
+            GetCharacterMovement()->DisableMovement();
+        });
+    });
 }
 
-void AAiCharacter::StartNavMeshRecoveryCheck()
+void AAiCharacter::SmoothRecoverToNavMesh(float DeltaTime)
 {
-    float RandomOffset = FMath::FRandRange(3.0f, 4.0f);
-    GetWorldTimerManager().SetTimer(NavMeshCheckTimer, this, &AAiCharacter::CheckNavMeshRecovery, RandomOffset, true);
+    ApplyRecoveryStep(FMath::VInterpTo(GetActorLocation(), RecoveryTargetLocation, DeltaTime, 2.0f));
 }
 
-void AAiCharacter::SmoothRecoverToNavMesh(float DeltaTime)
+void AAiCharacter::ApplyRecoveryStep(const FVector& NewLocation)
 {
-    FVector NewLocation = FMath::VInterpTo(GetActorLocation(), RecoveryTargetLocation, DeltaTime, 2.0f);
-    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+    UNavQuerySubsystem* NavQueries = GetWorld()->GetSubsystem<UNavQuerySubsystem>();
+    if (!NavQueries) return;
+
+    NavQueries->ProjectPoint(this, NewLocation, FVector(50.f), [this](const FNavQueryResult& Step)
     {
-        FNavLocation NavLoc;
-        if (NavSys->ProjectPointToNavigation(NewLocation, NavLoc, FVector(50.f)))
+        if (!bIsRecovering) return;
+
+        if (Step.bSuccess)
         {
-            SetActorLocation(NavLoc.Location);
+            SetActorLocation(Step.Location);
         }
-    }
-
-    if (FVector::DistSquared(GetActorLocation(), RecoveryTargetLocation) < 100.0f)
-    {
-        bIsRecovering = false;
 
-        UCharacterMovementComponent* MoveComp = GetCharacterMovement();
-        if (MoveComp)
+        if (FVector::DistSquared(GetActorLocation(), RecoveryTargetLocation) < 100.0f)
         {
-            MoveComp->SetMovementMode(MOVE_Walking);
-            MoveComp->Velocity = FVector::ZeroVector; // Reset lingering bad velocity
-            MoveComp->UpdateComponentVelocity();      // Force update
+            bIsRecovering = false;
+            LogEvent(EAgentLogEvent::Recovered);
+
+            UCharacterMovementComponent* MoveComp = GetCharacterMovement();
+            if (MoveComp)
+            {
+                MoveComp->SetMovementMode(MOVE_Walking);
+                MoveComp->Velocity = FVector::ZeroVector; // Reset lingering bad velocity
+                MoveComp->UpdateComponentVelocity();      // Force update
+            }
         }
-    }
+    });
 }
 
 void AAiCharacter::FinishedMustering()
 {
-    // 1. Stop ticking
-    SetActorTickEnabled(false);
+    LogEvent(EAgentLogEvent::Mustered);
+
+    // 1. Stop crowd updates (the agent still counts as a neighbour)
+    if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Crowd->MarkMustered(this);
+    }
+
+    StopFollowingFlowField();
 
-    // 2. Clear all timers
+    // 2. Clear all timers and scheduled checks
     GetWorldTimerManager().ClearAllTimersForObject(this);
+    if (UCrowdSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UCrowdSchedulerSubsystem>())
+    {
+        Scheduler->UnregisterAgent(this);
+    }
 
     // 3. Stop movement
     if (UCharacterMovementComponent* MoveComp = GetCharacterMovement())
@@ -286,8 +488,75 @@ void AAiCharacter::FinishedMustering()
     AAIController* AIController = Cast<AAIController>(GetController());
     if (AIController)
     {
+        PooledController = AIController;
         AIController->UnPossess();
     }
+
+    // 5. Pooled agents leave the station and wait for the next run
+    if (UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+    {
+        Pool->NotifyMustered(this);
+    }
+}
+
+// Flow Field Navigation
+bool AAiCharacter::FollowFlowField(AActor* MusterStation)
+{
+    const UFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UFlowFieldSubsystem>();
+    if (!FlowField)
+        return false;
+
+    const int32 Goal = MusterStation ? FlowField->FindGoal(MusterStation) : FlowField->FindNearestGoal(GetNavAgentLocation());
+    if (!FlowField->IsGoalReady(Goal))
+        return false;
+
+    // The crowd manager steers from here on; drop the current path so the two do not fight
+    if (AAIController* AIController = Cast<AAIController>(GetController()))
+    {
+        AIController->StopMovement();
+    }
+
+    FlowFieldGoal = Goal;
+    return true;
+}
+
+void AAiCharacter::StopFollowingFlowField()
+{
+    FlowFieldGoal = INDEX_NONE;
+}
+
+// Simulation LOD
+bool AAiCharacter::SetSimulationReduced(bool bReduced)
+{
+    if (bReduced == bSimulationReduced) return true;
+
+    UCharacterMovementComponent* MoveComp = GetCharacterMovement();
+    if (bReduced)
+    {
+        // Nav walking projects onto the navmesh instead of sweeping for the floor
+        MoveComp->SetMovementMode(MOVE_NavWalking);
+        if (MoveComp->MovementMode != MOVE_NavWalking)
+        {
+            MoveComp->SetMovementMode(MOVE_Walking);
+            return false;
+        }
+
+        MoveComp->SetAvoidanceEnabled(false);
+    }
+    else
+    {
+        MoveComp->SetMovementMode(MOVE_Walking);
+
+        const UAgentMovementComponent* AgentMovement = Cast<UAgentMovementComponent>(MoveComp);
+        MoveComp->SetAvoidanceEnabled(!AgentMovement || !AgentMovement->UsesOrcaAvoidance());
+
+        // Time spent reduced does not count towards being stuck
+        LastLocation = GetActorLocation();
+        TimeSinceLastMove = 0.0f;
+    }
+
+    bSimulationReduced = bReduced;
+    return true;
 }
 
 // Optional External Triggers
@@ -302,29 +571,43 @@ void AAiCharacter::ResetAvoidance()
 }
 
 // NavMesh Width Estimation
-float AAiCharacter::EstimateNavMeshWidth(float SampleDistance)
+void AAiCharacter::UpdateNavMeshWidthEstimate(float SampleDistance)
 {
+    SIM_SCOPE_CYCLE_COUNTER(NavWidthEstimate);
+
     FVector Location = GetActorLocation();
-    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
-    if (!NavSys) return 0.f;
+    UNavQuerySubsystem* NavQueries = GetWorld()->GetSubsystem<UNavQuerySubsystem>();
+    if (!NavQueries) return;
 
     const FVector LeftOffset = GetActorRightVector() * -SampleDistance;
     const FVector RightOffset = GetActorRightVector() * SampleDistance;
 
-    FNavLocation LeftPoint, RightPoint;
-    bool bLeft = NavSys->ProjectPointToNavigation(Location + LeftOffset, LeftPoint);
-    bool bRight = NavSys->ProjectPointToNavigation(Location + RightOffset, RightPoint);
-
-    if (bLeft && bRight)
-        return FVector::Dist(LeftPoint.Location, RightPoint.Location);
-    if (bLeft || bRight)
-        return SampleDistance * 2.0f;
-
-    return 0.f;
+    // Callbacks run in request order, so the left result is in by the time the right one arrives
+    const TSharedRef<FNavQueryResult> LeftPoint = MakeShared<FNavQueryResult>();
+    NavQueries->ProjectPoint(this, Location + LeftOffset, INVALID_NAVEXTENT, [LeftPoint](const FNavQueryResult& Result)
+    {
+        *LeftPoint = Result;
+    });
+    NavQueries->ProjectPoint(this, Location + RightOffset, INVALID_NAVEXTENT, [this, LeftPoint, SampleDistance](const FNavQueryResult& RightPoint)
+    {
+        if (LeftPoint->bSuccess && RightPoint.bSuccess)
+            NavWidthEstimate = FVector::Dist(LeftPoint->Location, RightPoint.Location);
+        else if (LeftPoint->bSuccess || RightPoint.bSuccess)
+            NavWidthEstimate = SampleDistance * 2.0f;
+        else
+            NavWidthEstimate = 0.f;
+    });
 }
 
 bool AAiCharacter::IsOnStairs() const
 {
+    FNavMetadataSample NavMeta;
+    const UNavMetadataSubsystem* NavMetaSubsystem = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+    if (NavMetaSubsystem && NavMetaSubsystem->Lookup(GetNavAgentLocation(), NavMeta))
+    {
+        return NavMeta.bStairs;
+    }
+
     const FFindFloorResult& FloorResult = GetCharacterMovement()->CurrentFloor;
     if (!FloorResult.bBlockingHit)
         return false;
@@ -340,3 +623,11 @@ void AAiCharacter::ApplyDownhillNudge()
 
     GetCharacterMovement()->Velocity += Nudge;
 }
+
+void AAiCharacter::LogEvent(EAgentLogEvent Event) const
+{
+    if (USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>())
+    {
+        Log->LogAgentEvent(this, Event);
+    }
+}
@@ -2,6 +2,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Crowd/PopulationGenerator.h"
+#include "Logging/AgentLogEvent.h"
 #include "AICharacter.generated.h"
 
 UCLASS()
@@ -22,8 +24,13 @@ public:
 	UPROPERTY(BlueprintReadWrite)
 	float WalkSpeedOnStairs = 100.0f;
 
-	// Core Events
-	virtual void Tick(float DeltaTime) override;
+	// Set by the spawner's population generator
+	UPROPERTY(BlueprintReadWrite)
+	FAgentDemographics Demographics;
+
+	// Gender or role material on every mesh of the agent
+	UFUNCTION(BlueprintCallable)
+	void SetBodyMaterial(UMaterialInterface* Material);
 
 	// Avoidance Helpers
 	void AdjustAvoidanceWeight(int32 NearbyAgents);
@@ -45,13 +52,12 @@ public:
 	// Utility Updates
 	void ThrottledUpdate();
 	void CheckIfStuck();
-	float EstimateNavMeshWidth(float SampleDistance);
+	void UpdateNavMeshWidthEstimate(float SampleDistance);
 
 	// NavMesh Recovery
 	void CheckNavMeshRecovery();
-	FVector FindClosestValidPoint();
-	void StartNavMeshRecoveryCheck();
 	void SmoothRecoverToNavMesh(float DeltaTime);
+	void ApplyRecoveryStep(const FVector& NewLocation);
 
 	UFUNCTION(BlueprintCallable)
 	void FinishedMustering();
@@ -59,13 +65,62 @@ public:
 	bool IsOnStairs() const;
 	void ApplyDownhillNudge();
 
+	// Flow Field Navigation
+	// Steer down the shared field to a station instead of following a path; no station picks the cheapest one
+	UFUNCTION(BlueprintCallable)
+	bool FollowFlowField(AActor* MusterStation = nullptr);
+
+	UFUNCTION(BlueprintCallable)
+	void StopFollowingFlowField();
+
+	UFUNCTION(BlueprintPure)
+	bool IsFollowingFlowField() const { return FlowFieldGoal != INDEX_NONE; }
+
+	// Simulation LOD
+	// Reduced agents nav-walk without floor sweeps or local avoidance and skip the stuck and navmesh checks.
+	// Returns false if the agent cannot change level (no navigation data to walk on).
+	bool SetSimulationReduced(bool bReduced);
+
+	UFUNCTION(BlueprintPure)
+	bool IsSimulationReduced() const { return bSimulationReduced; }
+
+	bool IsCapsuleShrunk() const { return bCapsuleShrunk; }
+	bool IsRecovering() const { return bIsRecovering; }
+
+	// Agent Pool
+	// A pooled agent is hidden, without collision or controller and out of the crowd until it is activated again
+	void DeactivateForPool();
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation);
+
+	bool IsInAgentPool() const { return bInAgentPool; }
+
+	// Destroys the agent with its controller, including the one it gave up on mustering
+	void DestroyForReset();
+
+	// Response Time
+	// Pauses the behavior tree for Demographics.Awareness seconds; called by the pool once the agent is placed
+	void WaitForResponseTime();
+
+	UFUNCTION(BlueprintPure)
+	bool IsWaitingToRespond() const { return bWaitingToRespond; }
+
+	// Run log
+	void LogEvent(EAgentLogEvent Event) const;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
+	// Per-frame repulsion, capsule and recovery steps run in the crowd manager
+	friend class UCrowdUpdateSubsystem;
+
+	// Throttled update, stuck and navmesh checks and the capsule restore are scheduled there
+	friend class UCrowdSchedulerSubsystem;
+
 	// Avoidance
 	float CustomAvoidanceWeight = 0.0f;
-	TArray<AActor*> NearbyAgentsCache;
+	float NeighbourRadius = 80.0f;
 
 	// Stuck Detection
 	FVector LastLocation;
@@ -79,14 +134,36 @@ private:
 	float TargetCapsuleRadius = 0.0f;
 	float TargetCapsuleHalfHeight = 0.0f;
 	float ResizeSpeed = 50.0f; // Units/sec
-	FTimerHandle CapsuleResetTimer;
+
+	// Width from the last UpdateNavMeshWidthEstimate
+	float NavWidthEstimate = 0.0f;
 
 	// NavMesh Recovery
 	bool bIsRecovering = false;
 	FVector RecoveryTargetLocation;
 	float RecoverySpeed = 500.0f;
-	FTimerHandle NavMeshCheckTimer;
 
-	FTimerHandle ThrottledUpdateTimer;
-	FTimerHandle StuckCheckTimer;
+	// Flow field goal index, INDEX_NONE when following a path
+	int32 FlowFieldGoal = INDEX_NONE;
+
+	// Set by the crowd manager's simulation LOD
+	bool bSimulationReduced = false;
+
+	int32 SchedulerHandle = INDEX_NONE;
+
+	// Given up on mustering or pooling; possesses the agent again when it leaves the pool
+	TWeakObjectPtr<AController> PooledController;
+	bool bInAgentPool = false;
+
+	// Response Time
+	bool bWaitingToRespond = false;
+	FTimerHandle ResponseTimer;
+
+	void Respond();
+
+	UPROPERTY()
+	UMaterialInterface* DefaultBodyMaterial = nullptr;
+
+	void RegisterWithCrowd();
+	void UnregisterFromCrowd();
 };
@@ -2,11 +2,91 @@
 
 
 #include "AgentMovementComponent.h"
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "SimulationInstance.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "NavigationData.h"
 
-void UAgentMovementComponent::PhysWalking(float DeltaTime, int32 Iterations)
+void UAgentMovementComponent::BeginPlay()
 {
-	Super::PhysWalking(DeltaTime, Iterations);
+	Super::BeginPlay();
+
+	Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>();
+	NavMetadata = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+
+	const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetWorld()->GetGameInstance());
+	if (GameInstance && GameInstance->BatchSettings.bNavMeshWalking)
+	{
+		bNavMeshWalking = true;
+	}
+
+	// Spread the checks so agents spawned together do not all sweep on the same frame
+	TimeToFloorCheck = FMath::FRandRange(0.f, FloorCheckInterval);
+}
+
+void UAgentMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	SIM_SCOPE_CYCLE_COUNTER(AgentMovement);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const EAgentMovementKind Kind = MovementMode == MOVE_NavWalking ? EAgentMovementKind::Reduced
+		: IsNavMeshWalking() ? EAgentMovementKind::NavMeshWalking
+		: EAgentMovementKind::Walking;
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Crowd)
+	{
+		Crowd->AddMovementTime(Kind, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+}
+
+void UAgentMovementComponent::SetOrcaAvoidance(bool bEnable)
+{
+	bOrcaAvoidance = bEnable;
+	AvoidanceVelocity.Reset();
+
+	// The two avoidance models would fight over the velocity
+	SetAvoidanceEnabled(!bEnable);
+}
+
+bool UAgentMovementComponent::IsMovingOnGround() const
+{
+	return Super::IsMovingOnGround() || (IsNavMeshWalking() && UpdatedComponent);
+}
+
+float UAgentMovementComponent::GetMaxSpeed() const
+{
+	return IsNavMeshWalking() ? MaxWalkSpeed : Super::GetMaxSpeed();
+}
+
+float UAgentMovementComponent::GetMaxBrakingDeceleration() const
+{
+	return IsNavMeshWalking() ? BrakingDecelerationWalking : Super::GetMaxBrakingDeceleration();
+}
+
+void UAgentMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+
+	if (!bOrcaAvoidance || !IsMovingOnGround()) return;
+
+	// Same place the engine applies its RVO velocity
+	PreferredVelocity = Velocity;
+	if (AvoidanceVelocity.IsSet())
+	{
+		Velocity.X = AvoidanceVelocity->X;
+		Velocity.Y = AvoidanceVelocity->Y;
+	}
+}
 
+void UAgentMovementComponent::ClampHorizontalSpeed()
+{
 	const float MaxSpeed = GetMaxSpeed();
 
 	FVector HorizontalVelocity = FVector(Velocity.X, Velocity.Y, 0.f);
@@ -16,4 +96,191 @@ void UAgentMovementComponent::PhysWalking(float DeltaTime, int32 Iterations)
 		Velocity.X = HorizontalVelocity.X;
 		Velocity.Y = HorizontalVelocity.Y;
 	}
-}
\ No newline at end of file
+}
+
+void UAgentMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	if (IsNavMeshWalking())
+	{
+		Velocity.Z = 0.f;
+		TimeToFloorCheck = FloorCheckInterval;
+	}
+}
+
+// Walking
+void UAgentMovementComponent::PhysWalking(float DeltaTime, int32 Iterations)
+{
+	Super::PhysWalking(DeltaTime, Iterations);
+
+	ClampHorizontalSpeed();
+
+	if (!bNavMeshWalking || MovementMode != MOVE_Walking) return;
+
+	TimeToFloorCheck -= DeltaTime;
+	if (TimeToFloorCheck > 0.f) return;
+
+	TimeToFloorCheck = FloorCheckInterval;
+	if (CurrentFloor.IsWalkableFloor() && CanNavMeshWalk())
+	{
+		SetMovementMode(MOVE_Custom, uint8(EAgentMovementMode::NavMeshWalking));
+	}
+}
+
+void UAgentMovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == uint8(EAgentMovementMode::NavMeshWalking))
+	{
+		PhysNavMeshWalking(DeltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(DeltaTime, Iterations);
+}
+
+void UAgentMovementComponent::PhysNavMeshWalking(float DeltaTime, int32 Iterations)
+{
+	if (DeltaTime < MIN_TICK_TIME) return;
+
+	if (!CharacterOwner || (!CharacterOwner->Controller && !bRunPhysicsWithNoController && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity()))
+	{
+		Acceleration = FVector::ZeroVector;
+		Velocity = FVector::ZeroVector;
+		return;
+	}
+
+	bool bFallBack = !bNavMeshWalking;
+	TimeToFloorCheck -= DeltaTime;
+	if (TimeToFloorCheck <= 0.f)
+	{
+		TimeToFloorCheck = FloorCheckInterval;
+
+		FFindFloorResult Floor;
+		FindFloor(UpdatedComponent->GetComponentLocation(), Floor, nullptr);
+		if (Floor.IsWalkableFloor())
+		{
+			CurrentFloor = Floor;
+		}
+		bFallBack |= !Floor.IsWalkableFloor() || !CanNavMeshWalk();
+	}
+
+	const ANavigationData* NavData = GetNavData();
+	if (bFallBack || !NavData)
+	{
+		SetMovementMode(MOVE_Walking);
+		StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	if (!HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Acceleration.Z = 0.f;
+		CalcVelocity(DeltaTime, GroundFriction, false, GetMaxBrakingDeceleration());
+	}
+	ApplyRootMotionToVelocity(DeltaTime);
+	Velocity.Z = 0.f;
+	ClampHorizontalSpeed();
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector FeetOffset(0.f, 0.f, CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+	const FVector OldFeet = OldLocation - FeetOffset;
+	FVector Target = OldFeet + Velocity * DeltaTime;
+
+	// The navmesh edge stands in for the walls
+	FSharedConstNavQueryFilter Filter = NavData->GetDefaultQueryFilter();
+	FVector EdgeLocation;
+	SimulationPerf::AddCount(ESimPerfCounter::NavQueries, 2);
+	if (NavData->Raycast(OldFeet, Target, EdgeLocation, Filter))
+	{
+		Target = EdgeLocation;
+	}
+
+	// On stairs the floor rises with the baked slope over the step just taken
+	float ProjectionHeight = FlatProjectionHeight;
+	FNavMetadataSample Sample;
+	if (NavMetadata && NavMetadata->Lookup(OldFeet, Sample) && Sample.bStairs)
+	{
+		ProjectionHeight += FVector::Dist2D(OldFeet, Target) * FMath::Tan(FMath::DegreesToRadians(Sample.SlopeDegrees));
+	}
+
+	FNavLocation Projected;
+	if (!NavData->ProjectPoint(Target, Projected, FVector(FlatProjectionHeight, FlatProjectionHeight, ProjectionHeight), Filter))
+	{
+		SetMovementMode(MOVE_Walking);
+		StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	// The horizontal step is swept against pawns and geometry the navmesh does not know about.
+	// The height change is not: rising first and dropping last keeps the sweep clear of the steps.
+	const FVector Delta = Projected.Location + FeetOffset - OldLocation;
+	const FQuat Rotation = UpdatedComponent->GetComponentQuat();
+	const FVector Rise(0.f, 0.f, FMath::Max(Delta.Z, 0.f));
+	const FVector Drop(0.f, 0.f, FMath::Min(Delta.Z, 0.f));
+
+	FHitResult Hit;
+	MoveUpdatedComponent(Rise, Rotation, false);
+	MoveUpdatedComponent(FVector(Delta.X, Delta.Y, 0.f), Rotation, true, &Hit);
+	MoveUpdatedComponent(Drop, Rotation, false);
+
+	const FVector Moved = UpdatedComponent->GetComponentLocation() - OldLocation;
+	if (!bJustTeleported && !HasAnimRootMotion() && !CurrentRootMotion.HasOverrideVelocity())
+	{
+		Velocity.X = Moved.X / DeltaTime;
+		Velocity.Y = Moved.Y / DeltaTime;
+	}
+
+	// Full walking slides along whatever was hit from the next update on
+	if (Hit.IsValidBlockingHit())
+	{
+		SetMovementMode(MOVE_Walking);
+	}
+}
+
+bool UAgentMovementComponent::CanNavMeshWalk()
+{
+	if (!bNavMeshWalking || !GetNavData()) return false;
+
+	// Fires and other baked obstacles change the navmesh under the agent
+	FNavMetadataSample Sample;
+	if (NavMetadata && NavMetadata->Lookup(GetActorFeetLocation(), Sample) && Sample.bBlocked) return false;
+
+	return !IsNearDynamicObstacle();
+}
+
+bool UAgentMovementComponent::IsNearDynamicObstacle() const
+{
+	const UCapsuleComponent* Capsule = CharacterOwner ? CharacterOwner->GetCapsuleComponent() : nullptr;
+	if (!Capsule) return false;
+
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
+	ObjectParams.AddObjectTypesToQuery(ECC_Destructible);
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AgentDynamicObstacle), false, CharacterOwner);
+	const FCollisionShape Shape = FCollisionShape::MakeCapsule(
+		Capsule->GetScaledCapsuleRadius() + DynamicObstacleMargin,
+		Capsule->GetScaledCapsuleHalfHeight());
+
+	TArray<FOverlapResult> Overlaps;
+	SimulationPerf::AddCount(ESimPerfCounter::OverlapsQueried);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, UpdatedComponent->GetComponentLocation(), UpdatedComponent->GetComponentQuat(), ObjectParams, Shape, QueryParams);
+
+	// Other pawns within both radii plus the margin, and movable geometry that would block the
+	// capsule; triggers and volumes do not count
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		if (Cast<APawn>(Overlap.GetActor())) return true;
+
+		const UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (Component && Component->Mobility == EComponentMobility::Movable
+			&& Component->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Block)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/AggregateRunsCommandlet.h"
+#include "Batch/RunAggregator.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+UAggregateRunsCommandlet::UAggregateRunsCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UAggregateRunsCommandlet::Main(const FString& Params)
+{
+	FString Directory = FPaths::ProjectSavedDir() / TEXT("SimulationLogs");
+	float Interval = 10.f;
+	float IdleTimeout = 600.f;
+	int32 MaxMinutes = 30;
+
+	FParse::Value(*Params, TEXT("Dir="), Directory);
+	FParse::Value(*Params, TEXT("Interval="), Interval);
+	FParse::Value(*Params, TEXT("IdleTimeout="), IdleTimeout);
+	FParse::Value(*Params, TEXT("Minutes="), MaxMinutes);
+	const bool bWatch = FParse::Param(*Params, TEXT("Watch"));
+
+	if (FPaths::IsRelative(Directory))
+	{
+		Directory = FPaths::ProjectDir() / Directory;
+	}
+	FString AggregatePath = Directory / TEXT("Aggregate.simagg");
+	FParse::Value(*Params, TEXT("Out="), AggregatePath);
+	const FString CsvPath = FPaths::Combine(FPaths::GetPath(AggregatePath), FPaths::GetBaseFilename(AggregatePath) + TEXT("_Summary.csv"));
+
+	FRunAggregator Aggregator;
+	if (!Aggregator.Load(AggregatePath))
+	{
+		Aggregator.MaxMinutes = FMath::Max(MaxMinutes, 1);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("AggregateRuns: %s, %d runs already aggregated."), *Directory, Aggregator.GetNumRuns());
+
+	double LastNewRunTime = FPlatformTime::Seconds();
+	while (true)
+	{
+		TArray<FString> Directories = { Directory };
+		TArray<FString> SubDirectories;
+		IFileManager::Get().FindFiles(SubDirectories, *(Directory / TEXT("*")), false, true);
+		for (const FString& SubDirectory : SubDirectories)
+		{
+			Directories.Add(Directory / SubDirectory);
+		}
+
+		int32 Added = 0;
+		for (const FString& RunDirectory : Directories)
+		{
+			Added += Aggregator.ConsumeDirectory(RunDirectory);
+		}
+
+		if (Added > 0)
+		{
+			LastNewRunTime = FPlatformTime::Seconds();
+			if (!Aggregator.Save(AggregatePath) || !Aggregator.ExportCsv(CsvPath))
+			{
+				UE_LOG(LogTemp, Error, TEXT("AggregateRuns: could not write %s."), *AggregatePath);
+				return 1;
+			}
+			UE_LOG(LogTemp, Display, TEXT("AggregateRuns: +%d runs, %d total in %d groups."), Added, Aggregator.GetNumRuns(), Aggregator.GetGroups().Num());
+		}
+
+		if (!bWatch || FPlatformTime::Seconds() - LastNewRunTime > IdleTimeout) break;
+		FPlatformProcess::Sleep(Interval);
+	}
+
+	return 0;
+}
@@ -0,0 +1,420 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/ParameterSweepCommandlet.h"
+#include "Batch/RunAggregator.h"
+#include "Batch/RunLogMerger.h"
+#include "Batch/RunStatistics.h"
+#include "Batch/SimulationParameters.h"
+#include "Batch/SimWorkerProcess.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace ParameterSweep
+{
+	struct FParameter
+	{
+		FString Name;
+
+		// Discrete levels; empty for a continuous range
+		TArray<FString> Values;
+
+		double Min = 0.0;
+		double Max = 0.0;
+		int32 Steps = 3;
+	};
+
+	struct FDefinition
+	{
+		FString Map;
+		bool bLatinHypercube = false;
+		int32 Samples = 10;
+		int32 Seed = 0;
+		TArray<FParameter> Parameters;
+
+		FString Metric = TEXT("TotalTimeSeconds");
+		int32 MinRuns = 5;
+		int32 MaxRuns = 50;
+		double Confidence = 0.95;
+		double RelativeHalfWidth = 0.05;
+	};
+
+	static FString FormatValue(double Value)
+	{
+		return FString::SanitizeFloat(Value);
+	}
+
+	static bool LoadDefinition(const FString& FilePath, FDefinition& Out)
+	{
+		FString Json;
+		TSharedPtr<FJsonObject> Root;
+		if (!FFileHelper::LoadFileToString(Json, *FilePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("ParameterSweep: could not read %s."), *FilePath);
+			return false;
+		}
+
+		Root->TryGetStringField(TEXT("Map"), Out.Map);
+		Root->TryGetNumberField(TEXT("Samples"), Out.Samples);
+		Root->TryGetNumberField(TEXT("Seed"), Out.Seed);
+		Root->TryGetStringField(TEXT("Metric"), Out.Metric);
+
+		FString Design;
+		Root->TryGetStringField(TEXT("Design"), Design);
+		Out.bLatinHypercube = Design.Equals(TEXT("LatinHypercube"), ESearchCase::IgnoreCase) || Design.Equals(TEXT("LHS"), ESearchCase::IgnoreCase);
+
+		const TArray<TSharedPtr<FJsonValue>>* Parameters = nullptr;
+		if (Root->TryGetArrayField(TEXT("Parameters"), Parameters))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *Parameters)
+			{
+				const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+				if (!Object.IsValid()) continue;
+
+				FParameter& Parameter = Out.Parameters.AddDefaulted_GetRef();
+				Object->TryGetStringField(TEXT("Name"), Parameter.Name);
+				Object->TryGetNumberField(TEXT("Min"), Parameter.Min);
+				Object->TryGetNumberField(TEXT("Max"), Parameter.Max);
+				Object->TryGetNumberField(TEXT("Steps"), Parameter.Steps);
+
+				const TArray<TSharedPtr<FJsonValue>>* Levels = nullptr;
+				if (Object->TryGetArrayField(TEXT("Values"), Levels))
+				{
+					for (const TSharedPtr<FJsonValue>& Level : *Levels)
+					{
+						Parameter.Values.Add(Level->Type == EJson::Number ? FormatValue(Level->AsNumber()) : Level->AsString());
+					}
+				}
+
+				if (Parameter.Name.IsEmpty() || !Parameter.Name.Contains(TEXT(".")))
+				{
+					UE_LOG(LogTemp, Error, TEXT("ParameterSweep: parameter names are Class.Property, got '%s'."), *Parameter.Name);
+					return false;
+				}
+			}
+		}
+
+		const TSharedPtr<FJsonObject>* Stopping = nullptr;
+		if (Root->TryGetObjectField(TEXT("Stopping"), Stopping))
+		{
+			(*Stopping)->TryGetNumberField(TEXT("MinRuns"), Out.MinRuns);
+			(*Stopping)->TryGetNumberField(TEXT("MaxRuns"), Out.MaxRuns);
+			(*Stopping)->TryGetNumberField(TEXT("Confidence"), Out.Confidence);
+			(*Stopping)->TryGetNumberField(TEXT("RelativeHalfWidth"), Out.RelativeHalfWidth);
+		}
+
+		Out.MinRuns = FMath::Max(Out.MinRuns, 2);
+		Out.MaxRuns = FMath::Max(Out.MaxRuns, Out.MinRuns);
+		return Out.Parameters.Num() > 0;
+	}
+
+	// Full factorial over each parameter's levels
+	static TArray<TArray<FString>> ExpandGrid(const FDefinition& Definition)
+	{
+		TArray<TArray<FString>> Levels;
+		for (const FParameter& Parameter : Definition.Parameters)
+		{
+			TArray<FString>& ParameterLevels = Levels.AddDefaulted_GetRef();
+			if (Parameter.Values.Num() > 0)
+			{
+				ParameterLevels = Parameter.Values;
+				continue;
+			}
+
+			const int32 Steps = FMath::Max(Parameter.Steps, 1);
+			for (int32 i = 0; i < Steps; ++i)
+			{
+				const double Alpha = Steps > 1 ? double(i) / (Steps - 1) : 0.5;
+				ParameterLevels.Add(FormatValue(FMath::Lerp(Parameter.Min, Parameter.Max, Alpha)));
+			}
+		}
+
+		TArray<TArray<FString>> Points;
+		Points.AddDefaulted();
+		for (const TArray<FString>& ParameterLevels : Levels)
+		{
+			TArray<TArray<FString>> Expanded;
+			for (const TArray<FString>& Point : Points)
+			{
+				for (const FString& Level : ParameterLevels)
+				{
+					TArray<FString>& NewPoint = Expanded.Add_GetRef(Point);
+					NewPoint.Add(Level);
+				}
+			}
+			Points = MoveTemp(Expanded);
+		}
+		return Points;
+	}
+
+	// One sample per stratum of every parameter, strata paired by independent shuffles
+	static TArray<TArray<FString>> ExpandLatinHypercube(const FDefinition& Definition)
+	{
+		const int32 NumSamples = FMath::Max(Definition.Samples, 1);
+		FRandomStream Random(Definition.Seed);
+
+		TArray<TArray<FString>> Points;
+		Points.SetNum(NumSamples);
+
+		for (const FParameter& Parameter : Definition.Parameters)
+		{
+			TArray<int32> Strata;
+			for (int32 i = 0; i < NumSamples; ++i)
+			{
+				Strata.Add(i);
+			}
+			for (int32 i = NumSamples - 1; i > 0; --i)
+			{
+				Strata.Swap(i, Random.RandRange(0, i));
+			}
+
+			for (int32 i = 0; i < NumSamples; ++i)
+			{
+				const double U = (Strata[i] + Random.FRand()) / NumSamples;
+				if (Parameter.Values.Num() > 0)
+				{
+					Points[i].Add(Parameter.Values[FMath::Min(int32(U * Parameter.Values.Num()), Parameter.Values.Num() - 1)]);
+				}
+				else
+				{
+					Points[i].Add(FormatValue(FMath::Lerp(Parameter.Min, Parameter.Max, U)));
+				}
+			}
+		}
+		return Points;
+	}
+
+	// Summary fields a run must have been written with to count for a point
+	static TMap<FString, FString> GetPointSummary(const FDefinition& Definition, const FSimulationParameters& Parameters)
+	{
+		TMap<FString, FString> Expected;
+		Expected.Add(TEXT("Seed"), FString::FromInt(Definition.Seed));
+		if (!Definition.Map.IsEmpty())
+		{
+			Expected.Add(TEXT("Map"), FPaths::GetBaseFilename(Definition.Map));
+		}
+		for (const FSimulationParameter& Parameter : Parameters.Entries)
+		{
+			Expected.Add(FString::Printf(TEXT("Param_%s.%s"), *Parameter.ClassName, *Parameter.PropertyName), Parameter.Value);
+		}
+		return Expected;
+	}
+
+	// Point_N is named by index only; a run left by an earlier sweep with other values or parameters does not count
+	static bool IsRunOfPoint(const FRunLog& Log, const TMap<FString, FString>& Expected)
+	{
+		if (!Log.MatchesSummary(Expected)) return false;
+
+		for (const TPair<FString, FString>& Pair : Log.Summary)
+		{
+			if (Pair.Key.StartsWith(TEXT("Param_")) && !Expected.Contains(Pair.Key)) return false;
+		}
+		return true;
+	}
+
+	// Completed runs are numbered from 0 with no gaps; stops at the first missing one, or the first made
+	// for different settings, which is rerun and overwritten.
+	// Only runs where everyone mustered go into the statistics; the others are counted in OutUnfinished.
+	static int32 GatherCompletedRuns(const FString& Directory, const TMap<FString, FString>& Expected, int32 MaxRuns, const FString& Metric, FRunningStats& OutStats, int32& OutUnfinished)
+	{
+		OutStats = FRunningStats();
+		OutUnfinished = 0;
+
+		int32 Run = 0;
+		for (; Run < MaxRuns; ++Run)
+		{
+			FRunLog Log;
+			if (!FRunLogMerger::ParseRunLog(FRunLogMerger::GetRunLogPath(Directory, Run), Log) || !Log.IsComplete()) break;
+
+			if (!IsRunOfPoint(Log, Expected))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("ParameterSweep: %s was run with other settings, rerunning from run %d."), *Directory, Run);
+				break;
+			}
+
+			// A timeout or stall would add the timeout to the mean rather than a muster time
+			if (!Log.IsAllMustered())
+			{
+				OutUnfinished++;
+				continue;
+			}
+
+			if (const FString* Value = Log.Summary.Find(Metric))
+			{
+				OutStats.Add(FCString::Atod(**Value));
+			}
+		}
+		return Run;
+	}
+
+	static bool IsConverged(const FDefinition& Definition, const FRunningStats& Stats)
+	{
+		return Stats.Count >= Definition.MinRuns
+			&& Stats.GetConfidenceHalfWidth(Definition.Confidence) <= Definition.RelativeHalfWidth * FMath::Abs(Stats.Mean);
+	}
+}
+
+UParameterSweepCommandlet::UParameterSweepCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UParameterSweepCommandlet::Main(const FString& Params)
+{
+	using namespace ParameterSweep;
+
+	FString SweepFile;
+	int32 NumWorkers = FPlatformMisc::NumberOfCores();
+	FString WorkerExecutable = FPlatformProcess::ExecutablePath();
+	FString ExtraArgs;
+	FString OutputDirectory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("SimulationLogs/Sweep"));
+
+	FParse::Value(*Params, TEXT("Sweep="), SweepFile);
+	FParse::Value(*Params, TEXT("Workers="), NumWorkers);
+	FParse::Value(*Params, TEXT("WorkerExe="), WorkerExecutable);
+	FParse::Value(*Params, TEXT("WorkerArgs="), ExtraArgs, false);
+	FParse::Value(*Params, TEXT("OutDir="), OutputDirectory);
+
+	if (FPaths::IsRelative(SweepFile))
+	{
+		SweepFile = FPaths::ProjectDir() / SweepFile;
+	}
+
+	FDefinition Definition;
+	if (!LoadDefinition(SweepFile, Definition))
+	{
+		UE_LOG(LogTemp, Error, TEXT("ParameterSweep: no valid sweep in '%s'."), *SweepFile);
+		return 1;
+	}
+	NumWorkers = FMath::Max(NumWorkers, 1);
+
+	const TArray<TArray<FString>> Points = Definition.bLatinHypercube ? ExpandLatinHypercube(Definition) : ExpandGrid(Definition);
+	UE_LOG(LogTemp, Display, TEXT("ParameterSweep: %d points (%s), %d-%d runs each, output %s"),
+		Points.Num(), Definition.bLatinHypercube ? TEXT("Latin hypercube") : TEXT("grid"), Definition.MinRuns, Definition.MaxRuns, *OutputDirectory);
+
+	TArray<FString> Header = { TEXT("Point") };
+	for (const FParameter& Parameter : Definition.Parameters)
+	{
+		Header.Add(Parameter.Name);
+	}
+	Header.Append({ TEXT("Runs"), TEXT("Unfinished"), TEXT("Mean"), TEXT("StdDev"), TEXT("HalfWidth"), TEXT("Converged") });
+	FString Summary = FString::Join(Header, TEXT(",")) + TEXT("\n");
+
+	int32 NumConverged = 0;
+	int32 TotalRuns = 0;
+	int32 TotalUnfinished = 0;
+
+	// Cross-run statistics per point, updated as rounds complete
+	const FString AggregatePath = OutputDirectory / TEXT("Aggregate.simagg");
+	FRunAggregator Aggregator;
+	Aggregator.Load(AggregatePath);
+
+	for (int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex)
+	{
+		const TArray<FString>& Point = Points[PointIndex];
+		const FString Directory = OutputDirectory / FString::Printf(TEXT("Point_%03d"), PointIndex);
+		IFileManager::Get().MakeDirectory(*Directory, true);
+
+		FSimulationParameters Parameters;
+		for (int32 i = 0; i < Definition.Parameters.Num(); ++i)
+		{
+			FSimulationParameter& Parameter = Parameters.Entries.AddDefaulted_GetRef();
+			Definition.Parameters[i].Name.Split(TEXT("."), &Parameter.ClassName, &Parameter.PropertyName);
+			Parameter.Value = Point[i];
+		}
+		const TMap<FString, FString> Expected = GetPointSummary(Definition, Parameters);
+
+		FRunningStats Stats;
+		int32 Unfinished = 0;
+		int32 Completed = GatherCompletedRuns(Directory, Expected, Definition.MaxRuns, Definition.Metric, Stats, Unfinished);
+		int32 Round = 0;
+
+		while (Completed < Definition.MaxRuns && !IsConverged(Definition, Stats))
+		{
+			// Fill up to MinRuns first, then one run per worker per round
+			const int32 RoundRuns = FMath::Min(Completed < Definition.MinRuns ? FMath::Max(Definition.MinRuns - Completed, NumWorkers) : NumWorkers, Definition.MaxRuns - Completed);
+			const int32 RoundWorkers = FMath::Min(NumWorkers, RoundRuns);
+
+			TArray<FProcHandle> Processes;
+			int32 NextRun = Completed;
+			for (int32 i = 0; i < RoundWorkers; ++i)
+			{
+				const int32 Count = RoundRuns / RoundWorkers + (i < RoundRuns % RoundWorkers ? 1 : 0);
+				// Each run reloads the map, so it matches a run made on its own in another round
+				const FString SimArgs = FString::Printf(TEXT("-SimRuns=%d -SimRunStart=%d -SimSeed=%d -SimLogDir=\"%s\" -SimParams=\"%s\" -SimReload"),
+					Count, NextRun, Definition.Seed, *Directory, *Parameters.ToString());
+
+				FProcHandle Process = FSimWorkerProcess::Launch(WorkerExecutable, Definition.Map, SimArgs,
+					Directory / FString::Printf(TEXT("Round_%d_Worker_%02d.log"), Round, i), ExtraArgs);
+				if (Process.IsValid())
+				{
+					Processes.Add(Process);
+				}
+				else
+				{
+					UE_LOG(LogTemp, Error, TEXT("ParameterSweep: failed to launch a worker (%s)."), *WorkerExecutable);
+				}
+				NextRun += Count;
+			}
+
+			for (FProcHandle& Process : Processes)
+			{
+				FPlatformProcess::WaitForProc(Process);
+				FPlatformProcess::CloseProc(Process);
+			}
+
+			const int32 PreviousCompleted = Completed;
+			Completed = GatherCompletedRuns(Directory, Expected, Definition.MaxRuns, Definition.Metric, Stats, Unfinished);
+			Round++;
+
+			if (Aggregator.ConsumeDirectory(Directory) > 0)
+			{
+				Aggregator.Save(AggregatePath);
+				Aggregator.ExportCsv(OutputDirectory / TEXT("Aggregate_Summary.csv"));
+			}
+
+			if (Completed == PreviousCompleted)
+			{
+				UE_LOG(LogTemp, Error, TEXT("ParameterSweep: point %d made no progress in round %d, giving up on it."), PointIndex, Round);
+				break;
+			}
+		}
+
+		const bool bConverged = IsConverged(Definition, Stats);
+		const double HalfWidth = Stats.Count > 1 ? Stats.GetConfidenceHalfWidth(Definition.Confidence) : 0.0;
+		NumConverged += bConverged ? 1 : 0;
+		TotalRuns += Completed;
+		TotalUnfinished += Unfinished;
+
+		UE_LOG(LogTemp, Display, TEXT("ParameterSweep: point %d [%s] %d runs, %s %.2f +/- %.2f%s"),
+			PointIndex, *Parameters.ToString(), Completed, *Definition.Metric, Stats.Mean, HalfWidth, bConverged ? TEXT("") : TEXT(" (not converged)"));
+		if (Unfinished > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ParameterSweep: point %d had %d runs that timed out or stalled; they are left out of the mean."), PointIndex, Unfinished);
+		}
+
+		Summary += FString::FromInt(PointIndex);
+		for (const FString& Value : Point)
+		{
+			Summary += TEXT(",") + Value;
+		}
+		Summary += FString::Printf(TEXT(",%d,%d,%.4f,%.4f,%.4f,%d\n"), Completed, Unfinished, Stats.Mean, Stats.GetStdDev(), HalfWidth, bConverged ? 1 : 0);
+	}
+
+	FFileHelper::SaveStringToFile(Summary, *(OutputDirectory / TEXT("Sweep_Summary.csv")));
+	UE_LOG(LogTemp, Display, TEXT("ParameterSweep: %d/%d points converged using %d runs, %d unfinished (at most %d without stopping)."),
+		NumConverged, Points.Num(), TotalRuns, TotalUnfinished, Points.Num() * Definition.MaxRuns);
+
+	return NumConverged == Points.Num() ? 0 : 1;
+}
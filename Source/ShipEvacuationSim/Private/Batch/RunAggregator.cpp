@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/RunAggregator.h"
+#include "Batch/RunLogMerger.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+namespace RunAggregator
+{
+	static constexpr uint32 Magic = 0x41475353;	// "SSGA"
+	static constexpr uint32 Version = 2;
+}
+
+void FRunAggregator::FMetric::Add(double Value)
+{
+	Stats.Add(Value);
+	Digest.Add(Value);
+}
+
+FArchive& operator<<(FArchive& Ar, FRunAggregator::FMetric& Metric)
+{
+	FRunningStats& Stats = Metric.Stats;
+	return Ar << Stats.Count << Stats.Mean << Stats.M2 << Stats.Min << Stats.Max << Metric.Digest;
+}
+
+FArchive& operator<<(FArchive& Ar, FRunAggregator::FGroup& Group)
+{
+	return Ar << Group.Runs << Group.Summary << Group.Minutes;
+}
+
+// Files
+bool FRunAggregator::Load(const FString& FilePath)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Reader) return false;
+
+	uint32 FileMagic = 0, FileVersion = 0;
+	*Reader << FileMagic << FileVersion;
+	if (FileMagic != RunAggregator::Magic || FileVersion != RunAggregator::Version)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("RunAggregator: %s is not a version %u aggregate."), *FilePath, RunAggregator::Version);
+		return false;
+	}
+
+	*Reader << MaxMinutes << Groups << Consumed;
+	return !Reader->IsError();
+}
+
+bool FRunAggregator::Save(const FString& FilePath)
+{
+	// Write next to the old file and swap, so a reader never sees a partial aggregate
+	const FString TempPath = FilePath + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+		if (!Writer) return false;
+
+		uint32 FileMagic = RunAggregator::Magic, FileVersion = RunAggregator::Version;
+		*Writer << FileMagic << FileVersion << MaxMinutes << Groups << Consumed;
+		if (!Writer->Close()) return false;
+	}
+	return IFileManager::Get().Move(*FilePath, *TempPath, true, true);
+}
+
+// Runs
+int32 FRunAggregator::ConsumeDirectory(const FString& Directory)
+{
+	const FString Key = FPaths::ConvertRelativePathToFull(Directory);
+
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *FPaths::Combine(Directory, TEXT("Run_*.simlog")), true, false);
+
+	int32 Added = 0;
+	for (const FString& FileName : FileNames)
+	{
+		FString RunName = FPaths::GetBaseFilename(FileName);
+		RunName.RemoveFromStart(TEXT("Run_"));
+		if (!RunName.IsNumeric() || IsConsumed(Key, FCString::Atoi(*RunName))) continue;
+
+		// Runs still being written have no summary yet; they are picked up on a later pass
+		FRunLog Log;
+		if (FRunLogMerger::ParseRunLog(FPaths::Combine(Directory, FileName), Log) && Log.IsComplete())
+		{
+			AddRun(Log, Key);
+			MarkConsumed(Key, Log.RunIndex);
+			Added++;
+		}
+	}
+	return Added;
+}
+
+FString FRunAggregator::GetGroupKey(const FRunLog& Log, const FString& Source)
+{
+	// Runs of different maps never share a group; logs from before the Map field fall back to their directory
+	const FString* Map = Log.Summary.Find(TEXT("Map"));
+	const FString Scenario = Map ? *Map : Source;
+
+	TArray<FString> Parameters;
+	for (const TPair<FString, FString>& Pair : Log.Summary)
+	{
+		if (Pair.Key.StartsWith(TEXT("Param_")))
+		{
+			Parameters.Add(Pair.Key.RightChop(6) + TEXT("=") + Pair.Value);
+		}
+	}
+	Parameters.Sort();
+
+	const FString Point = Parameters.Num() > 0 ? FString::Join(Parameters, TEXT(";")) : FString(TEXT("Default"));
+	return Scenario.IsEmpty() ? Point : Scenario + TEXT(":") + Point;
+}
+
+void FRunAggregator::AddRun(const FRunLog& Log, const FString& Source)
+{
+	FGroup& Group = Groups.FindOrAdd(GetGroupKey(Log, Source));
+	Group.Runs++;
+
+	for (const TPair<FString, FString>& Pair : Log.Summary)
+	{
+		if (!Pair.Key.StartsWith(TEXT("Param_")) && Pair.Value.IsNumeric())
+		{
+			Group.Summary.FindOrAdd(Pair.Key).Add(FCString::Atod(*Pair.Value));
+		}
+	}
+
+	// Progress is sampled in time order; take the last sample at or before each minute
+	Group.Minutes.SetNum(FMath::Max(Group.Minutes.Num(), MaxMinutes));
+	int32 Sample = 0;
+	int32 Mustered = 0;
+	for (int32 Minute = 0; Minute < MaxMinutes; ++Minute)
+	{
+		const double EndTime = (Minute + 1) * 60.0;
+		while (Sample < Log.Progress.Num() && Log.Progress[Sample].Key <= EndTime)
+		{
+			Mustered = Log.Progress[Sample].Value;
+			Sample++;
+		}
+		Group.Minutes[Minute].Add(Mustered);
+	}
+}
+
+int32 FRunAggregator::GetNumRuns() const
+{
+	int32 Runs = 0;
+	for (const TPair<FString, FGroup>& Pair : Groups)
+	{
+		Runs += Pair.Value.Runs;
+	}
+	return Runs;
+}
+
+bool FRunAggregator::IsConsumed(const FString& Directory, int32 RunIndex) const
+{
+	const TArray<FIntPoint>* Ranges = Consumed.Find(Directory);
+	if (!Ranges) return false;
+
+	for (const FIntPoint& Range : *Ranges)
+	{
+		if (RunIndex >= Range.X && RunIndex <= Range.Y) return true;
+	}
+	return false;
+}
+
+void FRunAggregator::MarkConsumed(const FString& Directory, int32 RunIndex)
+{
+	TArray<FIntPoint>& Ranges = Consumed.FindOrAdd(Directory);
+
+	int32 Insert = 0;
+	while (Insert < Ranges.Num() && Ranges[Insert].Y < RunIndex - 1)
+	{
+		++Insert;
+	}
+
+	if (Insert < Ranges.Num() && Ranges[Insert].X <= RunIndex + 1)
+	{
+		// Extends an existing range, possibly closing the gap to the next one
+		FIntPoint& Range = Ranges[Insert];
+		Range.X = FMath::Min(Range.X, RunIndex);
+		Range.Y = FMath::Max(Range.Y, RunIndex);
+		if (Insert + 1 < Ranges.Num() && Ranges[Insert + 1].X <= Range.Y + 1)
+		{
+			Range.Y = FMath::Max(Range.Y, Ranges[Insert + 1].Y);
+			Ranges.RemoveAt(Insert + 1);
+		}
+	}
+	else
+	{
+		Ranges.Insert(FIntPoint(RunIndex, RunIndex), Insert);
+	}
+}
+
+// Export
+bool FRunAggregator::ExportCsv(const FString& FilePath) const
+{
+	FString Csv = TEXT("Group,Metric,Count,Mean,StdDev,Min,P5,P50,P95,P99,Max\n");
+
+	auto AppendRow = [&Csv](const FString& Group, const FString& Name, const FMetric& Metric)
+	{
+		const FRunningStats& Stats = Metric.Stats;
+		if (Stats.Count == 0) return;
+
+		Csv += FString::Printf(TEXT("\"%s\",%s,%lld,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n"),
+			*Group, *Name, Stats.Count, Stats.Mean, Stats.GetStdDev(), Stats.Min,
+			Metric.Digest.GetQuantile(0.05), Metric.Digest.GetQuantile(0.5), Metric.Digest.GetQuantile(0.95), Metric.Digest.GetQuantile(0.99),
+			Stats.Max);
+	};
+
+	TArray<FString> GroupKeys;
+	Groups.GetKeys(GroupKeys);
+	GroupKeys.Sort();
+
+	for (const FString& GroupKey : GroupKeys)
+	{
+		const FGroup& Group = Groups[GroupKey];
+
+		TArray<FString> MetricNames;
+		Group.Summary.GetKeys(MetricNames);
+		MetricNames.Sort();
+		for (const FString& Name : MetricNames)
+		{
+			AppendRow(GroupKey, Name, Group.Summary[Name]);
+		}
+
+		for (int32 Minute = 0; Minute < Group.Minutes.Num(); ++Minute)
+		{
+			AppendRow(GroupKey, FString::Printf(TEXT("MusteredAtMinute_%d"), Minute + 1), Group.Minutes[Minute]);
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/RunFarmCommandlet.h"
+#include "Batch/RunLogMerger.h"
+#include "Batch/SimWorkerProcess.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+namespace RunFarm
+{
+	struct FWorker
+	{
+		int32 Id = 0;
+		int32 FirstRun = 0;
+		int32 EndRun = 0;	// Exclusive
+		FString LogDirectory;
+		FProcHandle Process;
+		int32 Restarts = 0;
+		bool bFinished = false;
+		bool bFailed = false;
+	};
+
+	static int32 FindFirstIncompleteRun(const FWorker& Worker, const TMap<FString, FString>& Settings)
+	{
+		for (int32 Run = Worker.FirstRun; Run < Worker.EndRun; ++Run)
+		{
+			if (!FRunLogMerger::IsRunComplete(Worker.LogDirectory, Run, Settings))
+			{
+				return Run;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	// Logs left by a farm with another seed, map or run split would be skipped as done and merged; start the worker over
+	static void ClearStaleRuns(const FWorker& Worker, const TMap<FString, FString>& Settings)
+	{
+		TArray<FString> FileNames;
+		IFileManager::Get().FindFiles(FileNames, *FPaths::Combine(Worker.LogDirectory, TEXT("Run_*.simlog")), true, false);
+
+		for (const FString& FileName : FileNames)
+		{
+			FRunLog Log;
+			if (!FRunLogMerger::ParseRunLog(FPaths::Combine(Worker.LogDirectory, FileName), Log)) continue;
+
+			const bool bInRange = Log.RunIndex >= Worker.FirstRun && Log.RunIndex < Worker.EndRun;
+			if (!bInRange || (Log.IsComplete() && !Log.MatchesSummary(Settings)))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("RunFarm: %s is from a different batch, clearing worker %d's logs."), *FileName, Worker.Id);
+				IFileManager::Get().DeleteDirectory(*Worker.LogDirectory, false, true);
+				IFileManager::Get().MakeDirectory(*Worker.LogDirectory, true);
+				return;
+			}
+		}
+	}
+}
+
+URunFarmCommandlet::URunFarmCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 URunFarmCommandlet::Main(const FString& Params)
+{
+	using namespace RunFarm;
+
+	int32 TotalRuns = 50;
+	int32 NumWorkers = FPlatformMisc::NumberOfCores();
+	int32 Seed = 0;
+	int32 MaxRestarts = 3;
+	FString MapName;
+	FString WorkerExecutable = FPlatformProcess::ExecutablePath();
+	FString ExtraArgs;
+	FString OutputDirectory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("SimulationLogs/Farm"));
+
+	FParse::Value(*Params, TEXT("Runs="), TotalRuns);
+	FParse::Value(*Params, TEXT("Workers="), NumWorkers);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("MaxRestarts="), MaxRestarts);
+	FParse::Value(*Params, TEXT("Map="), MapName);
+	FParse::Value(*Params, TEXT("WorkerExe="), WorkerExecutable);
+	FParse::Value(*Params, TEXT("WorkerArgs="), ExtraArgs, false);
+	FParse::Value(*Params, TEXT("OutDir="), OutputDirectory);
+
+	TotalRuns = FMath::Max(TotalRuns, 1);
+	NumWorkers = FMath::Clamp(NumWorkers, 1, TotalRuns);
+
+	// Summary fields an existing run must have to be reused
+	TMap<FString, FString> Settings;
+	Settings.Add(TEXT("Seed"), FString::FromInt(Seed));
+	if (!MapName.IsEmpty())
+	{
+		Settings.Add(TEXT("Map"), FPaths::GetBaseFilename(MapName));
+	}
+
+	// Contiguous run ranges, the first (TotalRuns % NumWorkers) workers take one extra run
+	TArray<FWorker> Workers;
+	int32 NextRun = 0;
+	for (int32 i = 0; i < NumWorkers; ++i)
+	{
+		const int32 Count = TotalRuns / NumWorkers + (i < TotalRuns % NumWorkers ? 1 : 0);
+
+		FWorker& Worker = Workers.AddDefaulted_GetRef();
+		Worker.Id = i;
+		Worker.FirstRun = NextRun;
+		Worker.EndRun = NextRun + Count;
+		Worker.LogDirectory = OutputDirectory / FString::Printf(TEXT("Worker_%02d"), i);
+		IFileManager::Get().MakeDirectory(*Worker.LogDirectory, true);
+		ClearStaleRuns(Worker, Settings);
+
+		NextRun += Count;
+	}
+
+	auto LaunchWorker = [&](FWorker& Worker) -> bool
+	{
+		const int32 StartRun = FindFirstIncompleteRun(Worker, Settings);
+		if (StartRun == INDEX_NONE)
+		{
+			Worker.bFinished = true;
+			return true;
+		}
+
+		const FString SimArgs = FString::Printf(TEXT("-SimRuns=%d -SimRunStart=%d -SimSeed=%d -SimLogDir=\"%s\""),
+			Worker.EndRun - StartRun, StartRun, Seed, *Worker.LogDirectory);
+
+		Worker.Process = FSimWorkerProcess::Launch(WorkerExecutable, MapName, SimArgs,
+			Worker.LogDirectory / FString::Printf(TEXT("Worker_%d.log"), Worker.Restarts), ExtraArgs);
+		if (!Worker.Process.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("RunFarm: failed to launch worker %d (%s)."), Worker.Id, *WorkerExecutable);
+			return false;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("RunFarm: worker %d running runs %d-%d."), Worker.Id, StartRun, Worker.EndRun - 1);
+		return true;
+	};
+
+	UE_LOG(LogTemp, Display, TEXT("RunFarm: %d runs on %d workers, seed %d, output %s"), TotalRuns, NumWorkers, Seed, *OutputDirectory);
+
+	for (FWorker& Worker : Workers)
+	{
+		Worker.bFailed = !LaunchWorker(Worker);
+	}
+
+	// Poll until every worker has finished its range or used up its restarts
+	while (Workers.ContainsByPredicate([](const FWorker& Worker) { return !Worker.bFinished && !Worker.bFailed; }))
+	{
+		FPlatformProcess::Sleep(1.0f);
+
+		for (FWorker& Worker : Workers)
+		{
+			if (Worker.bFinished || Worker.bFailed || FPlatformProcess::IsProcRunning(Worker.Process))
+			{
+				continue;
+			}
+
+			int32 ReturnCode = 0;
+			FPlatformProcess::GetProcReturnCode(Worker.Process, &ReturnCode);
+			FPlatformProcess::CloseProc(Worker.Process);
+
+			if (FindFirstIncompleteRun(Worker, Settings) == INDEX_NONE)
+			{
+				Worker.bFinished = true;
+				UE_LOG(LogTemp, Display, TEXT("RunFarm: worker %d finished."), Worker.Id);
+			}
+			else if (Worker.Restarts < MaxRestarts)
+			{
+				Worker.Restarts++;
+				UE_LOG(LogTemp, Warning, TEXT("RunFarm: worker %d exited with code %d before finishing, restart %d/%d."), Worker.Id, ReturnCode, Worker.Restarts, MaxRestarts);
+				Worker.bFailed = !LaunchWorker(Worker);
+			}
+			else
+			{
+				Worker.bFailed = true;
+				UE_LOG(LogTemp, Error, TEXT("RunFarm: worker %d gave up after %d restarts."), Worker.Id, MaxRestarts);
+			}
+		}
+	}
+
+	TArray<FString> Directories;
+	for (const FWorker& Worker : Workers)
+	{
+		Directories.Add(Worker.LogDirectory);
+	}
+
+	const int32 Merged = FRunLogMerger::MergeDirectories(Directories, OutputDirectory);
+	UE_LOG(LogTemp, Display, TEXT("RunFarm: merged %d/%d runs into %s"), Merged, TotalRuns, *OutputDirectory);
+
+	return Merged == TotalRuns ? 0 : 1;
+}
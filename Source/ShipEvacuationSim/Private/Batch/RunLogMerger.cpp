@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/RunLogMerger.h"
+#include "Logging/RunLogFile.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FString FRunLogMerger::GetRunLogPath(const FString& Directory, int32 RunIndex)
+{
+	return FPaths::Combine(Directory, FString::Printf(TEXT("Run_%d.simlog"), RunIndex));
+}
+
+bool FRunLogMerger::ParseRunLog(const FString& FilePath, FRunLog& OutLog)
+{
+	FString RunName = FPaths::GetBaseFilename(FilePath);
+	RunName.RemoveFromStart(TEXT("Run_"));
+	if (!RunName.IsNumeric())
+	{
+		return false;
+	}
+	OutLog.RunIndex = FCString::Atoi(*RunName);
+
+	FRunLogReader Reader;
+	if (!Reader.Load(FilePath))
+	{
+		return false;
+	}
+
+	const int32 ProgressTable = Reader.FindTable(TEXT("Progress"));
+	for (int32 Row = 0; Row < Reader.GetNumRows(ProgressTable); ++Row)
+	{
+		OutLog.Progress.Emplace(Reader.GetValue(ProgressTable, 0, Row), int32(Reader.GetValue(ProgressTable, 1, Row)));
+	}
+
+	for (const TPair<FString, FString>& Pair : Reader.GetSummary())
+	{
+		OutLog.Summary.Add(Pair.Key, Pair.Value);
+	}
+
+	return true;
+}
+
+bool FRunLogMerger::IsRunComplete(const FString& Directory, int32 RunIndex, const TMap<FString, FString>& Expected)
+{
+	FRunLog Log;
+	return ParseRunLog(GetRunLogPath(Directory, RunIndex), Log) && Log.IsComplete() && Log.MatchesSummary(Expected);
+}
+
+int32 FRunLogMerger::MergeDirectories(const TArray<FString>& Directories, const FString& OutputDirectory)
+{
+	TArray<FRunLog> Logs;
+	for (const FString& Directory : Directories)
+	{
+		TArray<FString> FileNames;
+		IFileManager::Get().FindFiles(FileNames, *FPaths::Combine(Directory, TEXT("Run_*.simlog")), true, false);
+
+		for (const FString& FileName : FileNames)
+		{
+			FRunLog Log;
+			if (ParseRunLog(FPaths::Combine(Directory, FileName), Log) && Log.IsComplete())
+			{
+				Logs.Add(MoveTemp(Log));
+			}
+		}
+	}
+
+	Logs.Sort([](const FRunLog& A, const FRunLog& B)
+	{
+		return A.RunIndex < B.RunIndex;
+	});
+
+	// Summary columns are the union of footer keys in first-seen order
+	TArray<FString> SummaryKeys;
+	for (const FRunLog& Log : Logs)
+	{
+		for (const TPair<FString, FString>& Pair : Log.Summary)
+		{
+			SummaryKeys.AddUnique(Pair.Key);
+		}
+	}
+
+	FString Progress = TEXT("Run,Time,AgentsMustered\n");
+	FString Summary = TEXT("Run,") + FString::Join(SummaryKeys, TEXT(",")) + TEXT("\n");
+
+	for (const FRunLog& Log : Logs)
+	{
+		for (const TPair<double, int32>& Sample : Log.Progress)
+		{
+			Progress += FString::Printf(TEXT("%d,%.3f,%d\n"), Log.RunIndex, Sample.Key, Sample.Value);
+		}
+
+		Summary += FString::FromInt(Log.RunIndex);
+		for (const FString& Key : SummaryKeys)
+		{
+			const FString* Value = Log.Summary.Find(Key);
+			Summary += TEXT(",") + (Value ? *Value : FString());
+		}
+		Summary += TEXT("\n");
+	}
+
+	IFileManager::Get().MakeDirectory(*OutputDirectory, true);
+	FFileHelper::SaveStringToFile(Progress, *FPaths::Combine(OutputDirectory, TEXT("Merged_Progress.csv")));
+	FFileHelper::SaveStringToFile(Summary, *FPaths::Combine(OutputDirectory, TEXT("Merged_Summary.csv")));
+
+	return Logs.Num();
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/RunStatistics.h"
+
+namespace RunStatistics
+{
+	// Inverse of the standard normal CDF (Acklam's rational approximation, relative error < 1.2e-9)
+	static double InverseNormal(double P)
+	{
+		static const double A[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+		static const double B[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01 };
+		static const double C[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+		static const double D[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00 };
+
+		P = FMath::Clamp(P, 1e-12, 1.0 - 1e-12);
+		const double Low = 0.02425;
+
+		if (P < Low)
+		{
+			const double Q = FMath::Sqrt(-2.0 * FMath::Loge(P));
+			return (((((C[0] * Q + C[1]) * Q + C[2]) * Q + C[3]) * Q + C[4]) * Q + C[5]) / ((((D[0] * Q + D[1]) * Q + D[2]) * Q + D[3]) * Q + 1.0);
+		}
+		if (P > 1.0 - Low)
+		{
+			const double Q = FMath::Sqrt(-2.0 * FMath::Loge(1.0 - P));
+			return -(((((C[0] * Q + C[1]) * Q + C[2]) * Q + C[3]) * Q + C[4]) * Q + C[5]) / ((((D[0] * Q + D[1]) * Q + D[2]) * Q + D[3]) * Q + 1.0);
+		}
+
+		const double Q = P - 0.5;
+		const double R = Q * Q;
+		return (((((A[0] * R + A[1]) * R + A[2]) * R + A[3]) * R + A[4]) * R + A[5]) * Q / (((((B[0] * R + B[1]) * R + B[2]) * R + B[3]) * R + B[4]) * R + 1.0);
+	}
+}
+
+void FRunningStats::Add(double Value)
+{
+	Count++;
+	const double Delta = Value - Mean;
+	Mean += Delta / Count;
+	M2 += Delta * (Value - Mean);
+	Min = FMath::Min(Min, Value);
+	Max = FMath::Max(Max, Value);
+}
+
+void FRunningStats::Merge(const FRunningStats& Other)
+{
+	if (Other.Count == 0) return;
+	if (Count == 0)
+	{
+		*this = Other;
+		return;
+	}
+
+	const int64 Total = Count + Other.Count;
+	const double Delta = Other.Mean - Mean;
+	Mean += Delta * Other.Count / Total;
+	M2 += Other.M2 + Delta * Delta * (double(Count) * Other.Count / Total);
+	Count = Total;
+	Min = FMath::Min(Min, Other.Min);
+	Max = FMath::Max(Max, Other.Max);
+}
+
+double FRunningStats::GetVariance() const
+{
+	return Count > 1 ? M2 / (Count - 1) : 0.0;
+}
+
+double FRunningStats::GetConfidenceHalfWidth(double Confidence) const
+{
+	if (Count < 2) return TNumericLimits<double>::Max();
+	return GetStudentT(Confidence, Count - 1) * GetStdDev() / FMath::Sqrt(double(Count));
+}
+
+double FRunningStats::GetStudentT(double Confidence, int64 DegreesOfFreedom)
+{
+	Confidence = FMath::Clamp(Confidence, 0.0, 0.999999);
+
+	// Closed forms where the expansion below is poor
+	if (DegreesOfFreedom <= 1)
+	{
+		return FMath::Tan(UE_DOUBLE_PI * Confidence * 0.5);
+	}
+	if (DegreesOfFreedom == 2)
+	{
+		const double P = 0.5 + 0.5 * Confidence;
+		return (2.0 * P - 1.0) / FMath::Sqrt(2.0 * P * (1.0 - P));
+	}
+
+	// Cornish-Fisher expansion around the normal quantile; within 1% at 95% from 3 degrees of freedom up
+	const double Z = RunStatistics::InverseNormal(0.5 + 0.5 * Confidence);
+	const double N = double(DegreesOfFreedom);
+	const double Z3 = Z * Z * Z;
+	const double Z5 = Z3 * Z * Z;
+	const double Z7 = Z5 * Z * Z;
+
+	return Z
+		+ (Z3 + Z) / (4.0 * N)
+		+ (5.0 * Z5 + 16.0 * Z3 + 3.0 * Z) / (96.0 * N * N)
+		+ (3.0 * Z7 + 19.0 * Z5 + 17.0 * Z3 - 15.0 * Z) / (384.0 * N * N * N);
+}
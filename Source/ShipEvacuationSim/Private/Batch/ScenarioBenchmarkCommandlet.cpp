@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/ScenarioBenchmarkCommandlet.h"
+#include "Batch/RunLogMerger.h"
+#include "Batch/SimWorkerProcess.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace ScenarioBenchmark
+{
+	struct FMetric
+	{
+		const TCHAR* Name;
+		bool bHigherIsBetter;
+	};
+
+	static const FMetric Metrics[] =
+	{
+		{ TEXT("SimTimeSeconds"), false },
+		{ TEXT("WallTimeSeconds"), false },
+		{ TEXT("AgentsPerSecond"), true },
+		{ TEXT("PeakMemoryMB"), false },
+		{ TEXT("FrameMsMean"), false },
+		{ TEXT("FrameMsP95"), false },
+		{ TEXT("FrameMsP99"), false },
+	};
+
+	struct FScenarioResult
+	{
+		FString Map;
+		int32 Runs = 0;
+		TMap<FString, double> Values;
+	};
+
+	static double GetSummaryValue(const FRunLog& Log, const TCHAR* Key)
+	{
+		const FString* Value = Log.Summary.Find(Key);
+		return Value ? FCString::Atod(**Value) : 0.0;
+	}
+
+	static bool Summarise(const FString& Map, const FString& Directory, int32 NumRuns, FScenarioResult& OutResult)
+	{
+		OutResult.Map = Map;
+
+		double SimTime = 0.0, WallTime = 0.0, Mustered = 0.0, PeakMemory = 0.0;
+		double FrameMean = 0.0, FrameP95 = 0.0, FrameP99 = 0.0;
+
+		for (int32 Run = 0; Run < NumRuns; ++Run)
+		{
+			// A timed out or stalled run's times measure the timeout, not the scenario
+			FRunLog Log;
+			FRunLogMerger::ParseRunLog(FRunLogMerger::GetRunLogPath(Directory, Run), Log);
+			if (!Log.IsAllMustered())
+			{
+				UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: %s run %d did not finish (%s)."), *Map, Run, *Log.GetEndReason());
+				continue;
+			}
+
+			OutResult.Runs++;
+			SimTime += GetSummaryValue(Log, TEXT("TotalTimeSeconds"));
+			WallTime += GetSummaryValue(Log, TEXT("WallTimeSeconds"));
+			Mustered += GetSummaryValue(Log, TEXT("AgentsMustered"));
+			PeakMemory = FMath::Max(PeakMemory, GetSummaryValue(Log, TEXT("PerfPeakMemoryMB")));
+			FrameMean += GetSummaryValue(Log, TEXT("PerfFrameMsMean"));
+			FrameP95 += GetSummaryValue(Log, TEXT("PerfFrameMsP95"));
+			FrameP99 += GetSummaryValue(Log, TEXT("PerfFrameMsP99"));
+		}
+
+		if (OutResult.Runs == 0) return false;
+
+		// Percentiles are averaged per run rather than pooled over every frame
+		const double Runs = OutResult.Runs;
+		OutResult.Values.Add(TEXT("SimTimeSeconds"), SimTime / Runs);
+		OutResult.Values.Add(TEXT("WallTimeSeconds"), WallTime / Runs);
+		OutResult.Values.Add(TEXT("AgentsPerSecond"), WallTime > 0.0 ? Mustered / WallTime : 0.0);
+		OutResult.Values.Add(TEXT("PeakMemoryMB"), PeakMemory);
+		OutResult.Values.Add(TEXT("FrameMsMean"), FrameMean / Runs);
+		OutResult.Values.Add(TEXT("FrameMsP95"), FrameP95 / Runs);
+		OutResult.Values.Add(TEXT("FrameMsP99"), FrameP99 / Runs);
+		return OutResult.Runs == NumRuns;
+	}
+
+	static bool SaveResults(const FString& FilePath, const TArray<FScenarioResult>& Results, int32 NumSeeds, int32 Seed)
+	{
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetNumberField(TEXT("Seeds"), NumSeeds);
+		Root->SetNumberField(TEXT("Seed"), Seed);
+
+		TSharedRef<FJsonObject> Scenarios = MakeShared<FJsonObject>();
+		for (const FScenarioResult& Result : Results)
+		{
+			TSharedRef<FJsonObject> Scenario = MakeShared<FJsonObject>();
+			Scenario->SetNumberField(TEXT("Runs"), Result.Runs);
+			for (const TPair<FString, double>& Pair : Result.Values)
+			{
+				Scenario->SetNumberField(Pair.Key, Pair.Value);
+			}
+			Scenarios->SetObjectField(Result.Map, Scenario);
+		}
+		Root->SetObjectField(TEXT("Scenarios"), Scenarios);
+
+		FString Json;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		return FJsonSerializer::Serialize(Root, Writer) && FFileHelper::SaveStringToFile(Json, *FilePath);
+	}
+
+	static TSharedPtr<FJsonObject> LoadScenarios(const FString& FilePath)
+	{
+		FString Json;
+		if (!FFileHelper::LoadFileToString(Json, *FilePath)) return nullptr;
+
+		TSharedPtr<FJsonObject> Root;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid()) return nullptr;
+
+		const TSharedPtr<FJsonObject>* Scenarios = nullptr;
+		return Root->TryGetObjectField(TEXT("Scenarios"), Scenarios) ? *Scenarios : nullptr;
+	}
+
+	// Returns the number of metrics worse than the baseline by more than Threshold
+	static int32 CompareToBaseline(const FScenarioResult& Result, const FJsonObject& Baseline, double Threshold)
+	{
+		int32 Regressions = 0;
+		for (const FMetric& Metric : Metrics)
+		{
+			double Reference = 0.0;
+			const double* Current = Result.Values.Find(Metric.Name);
+			if (!Current || !Baseline.TryGetNumberField(Metric.Name, Reference) || Reference <= 0.0) continue;
+
+			const double Change = (*Current - Reference) / Reference;
+			const double Worse = Metric.bHigherIsBetter ? -Change : Change;
+			if (Worse > Threshold)
+			{
+				Regressions++;
+				UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: %s %s regressed %.1f%% (%.3f -> %.3f)."),
+					*Result.Map, Metric.Name, Worse * 100.0, Reference, *Current);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Display, TEXT("ScenarioBenchmark: %s %s %+.1f%% (%.3f -> %.3f)."),
+					*Result.Map, Metric.Name, Change * 100.0, Reference, *Current);
+			}
+		}
+		return Regressions;
+	}
+}
+
+UScenarioBenchmarkCommandlet::UScenarioBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UScenarioBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace ScenarioBenchmark;
+
+	int32 NumSeeds = 3;
+	int32 Seed = 0;
+	double Threshold = 0.1;
+	float MapTimeout = 1800.f;
+	FString MapList;
+	FString WorkerExecutable = FPlatformProcess::ExecutablePath();
+	FString ExtraArgs;
+	FString OutputDirectory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Benchmarks"));
+	FString BaselinePath;
+
+	FParse::Value(*Params, TEXT("Seeds="), NumSeeds);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Threshold="), Threshold);
+	FParse::Value(*Params, TEXT("MapTimeout="), MapTimeout);
+	FParse::Value(*Params, TEXT("Maps="), MapList, false);
+	FParse::Value(*Params, TEXT("WorkerExe="), WorkerExecutable);
+	FParse::Value(*Params, TEXT("WorkerArgs="), ExtraArgs, false);
+	FParse::Value(*Params, TEXT("OutDir="), OutputDirectory);
+	BaselinePath = OutputDirectory / TEXT("Baseline.json");
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	const bool bUpdateBaseline = FParse::Param(*Params, TEXT("UpdateBaseline"));
+
+	NumSeeds = FMath::Max(NumSeeds, 1);
+
+	TArray<FString> Maps;
+	MapList.ParseIntoArray(Maps, TEXT(","));
+	if (Maps.Num() == 0)
+	{
+		IFileManager::Get().FindFiles(Maps, *(FPaths::ProjectContentDir() / TEXT("Maps/Tests/*.umap")), true, false);
+		for (FString& Map : Maps)
+		{
+			Map = FPaths::GetBaseFilename(Map);
+		}
+		Maps.Sort();
+	}
+	if (Maps.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: no test maps found."));
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("ScenarioBenchmark: %d maps x %d seeds, seed %d, output %s"), Maps.Num(), NumSeeds, Seed, *OutputDirectory);
+
+	TArray<FScenarioResult> Results;
+	int32 Failures = 0;
+
+	for (const FString& Map : Maps)
+	{
+		const FString LogDirectory = OutputDirectory / Map;
+		IFileManager::Get().DeleteDirectory(*LogDirectory, false, true);
+		IFileManager::Get().MakeDirectory(*LogDirectory, true);
+
+		// Seeds reload the map so each starts from the level as authored, whatever the map's spawners support
+		const FString SimArgs = FString::Printf(TEXT("-SimRuns=%d -SimSeed=%d -SimLogDir=\"%s\" -SimReload"), NumSeeds, Seed, *LogDirectory);
+		FProcHandle Process = FSimWorkerProcess::Launch(WorkerExecutable, Map, SimArgs, LogDirectory / TEXT("Benchmark.log"), ExtraArgs);
+		if (!Process.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: failed to launch %s (%s)."), *Map, *WorkerExecutable);
+			Failures++;
+			continue;
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		while (FPlatformProcess::IsProcRunning(Process))
+		{
+			if (FPlatformTime::Seconds() - StartTime > MapTimeout)
+			{
+				UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: %s timed out after %.0f s."), *Map, MapTimeout);
+				FPlatformProcess::TerminateProc(Process, true);
+				break;
+			}
+			FPlatformProcess::Sleep(1.0f);
+		}
+		FPlatformProcess::CloseProc(Process);
+
+		FScenarioResult& Result = Results.AddDefaulted_GetRef();
+		if (!Summarise(Map, LogDirectory, NumSeeds, Result))
+		{
+			UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: %s completed %d/%d runs."), *Map, Result.Runs, NumSeeds);
+			Failures++;
+		}
+		if (Result.Runs == 0)
+		{
+			Results.Pop();
+		}
+	}
+
+	SaveResults(OutputDirectory / TEXT("Results.json"), Results, NumSeeds, Seed);
+
+	if (bUpdateBaseline)
+	{
+		if (!SaveResults(BaselinePath, Results, NumSeeds, Seed))
+		{
+			UE_LOG(LogTemp, Error, TEXT("ScenarioBenchmark: could not write baseline %s."), *BaselinePath);
+			return 1;
+		}
+		UE_LOG(LogTemp, Display, TEXT("ScenarioBenchmark: wrote baseline %s."), *BaselinePath);
+		return Failures > 0 ? 1 : 0;
+	}
+
+	const TSharedPtr<FJsonObject> Baseline = LoadScenarios(BaselinePath);
+	if (!Baseline.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ScenarioBenchmark: no baseline at %s; run with -UpdateBaseline to create one."), *BaselinePath);
+		return Failures > 0 ? 1 : 0;
+	}
+
+	int32 Regressions = 0;
+	for (const FScenarioResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* Reference = nullptr;
+		if (Baseline->TryGetObjectField(Result.Map, Reference))
+		{
+			Regressions += CompareToBaseline(Result, **Reference, Threshold);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ScenarioBenchmark: %s is not in the baseline."), *Result.Map);
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("ScenarioBenchmark: %d scenarios, %d failed, %d regressed metrics (threshold %.0f%%)."),
+		Results.Num(), Failures, Regressions, Threshold * 100.0);
+
+	return Failures > 0 || Regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/SimWorkerProcess.h"
+#include "Misc/Paths.h"
+
+FProcHandle FSimWorkerProcess::Launch(const FString& Executable, const FString& Map, const FString& SimArgs, const FString& LogFile, const FString& ExtraArgs)
+{
+	// The editor executable needs the project and -game; a packaged game does not
+	const bool bEditorExecutable = FPaths::GetBaseFilename(Executable).StartsWith(TEXT("UnrealEditor"));
+	const FString ProjectArg = bEditorExecutable
+		? FString::Printf(TEXT("\"%s\" "), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()))
+		: FString();
+	const FString GameArg = bEditorExecutable ? TEXT("-game ") : TEXT("");
+
+	const FString Args = FString::Printf(
+		TEXT("%s%s %s-nullrhi -nosound -unattended -nosplash %s%s%s -abslog=\"%s\" %s"),
+		*ProjectArg,
+		*Map,
+		*GameArg,
+		*SimArgs,
+		Map.IsEmpty() ? TEXT("") : TEXT(" -SimMap="),
+		*Map,
+		*LogFile,
+		*ExtraArgs
+	);
+
+	return FPlatformProcess::CreateProc(*Executable, *Args, false, true, true, nullptr, 0, nullptr, nullptr);
+}
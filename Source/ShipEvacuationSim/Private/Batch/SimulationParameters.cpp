@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/SimulationParameters.h"
+#include "UObject/Class.h"
+#include "UObject/UnrealType.h"
+
+FSimulationParameters FSimulationParameters::Parse(const FString& Text)
+{
+	FSimulationParameters Parameters;
+
+	TArray<FString> Assignments;
+	Text.ParseIntoArray(Assignments, TEXT(","));
+
+	for (const FString& Assignment : Assignments)
+	{
+		FString Name, Value;
+		FString ClassName, PropertyName;
+		if (!Assignment.TrimStartAndEnd().Split(TEXT("="), &Name, &Value) || !Name.Split(TEXT("."), &ClassName, &PropertyName))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SimulationParameters: ignoring '%s', expected Class.Property=Value."), *Assignment);
+			continue;
+		}
+
+		FSimulationParameter& Parameter = Parameters.Entries.AddDefaulted_GetRef();
+		Parameter.ClassName = ClassName;
+		Parameter.PropertyName = PropertyName;
+		Parameter.Value = Value;
+	}
+
+	return Parameters;
+}
+
+FString FSimulationParameters::ToString() const
+{
+	TArray<FString> Assignments;
+	for (const FSimulationParameter& Parameter : Entries)
+	{
+		Assignments.Add(FString::Printf(TEXT("%s.%s=%s"), *Parameter.ClassName, *Parameter.PropertyName, *Parameter.Value));
+	}
+	return FString::Join(Assignments, TEXT(","));
+}
+
+int32 FSimulationParameters::ApplyTo(UObject* Object) const
+{
+	if (!Object) return 0;
+
+	int32 NumSet = 0;
+	for (const FSimulationParameter& Parameter : Entries)
+	{
+		bool bClassMatches = false;
+		for (const UClass* Class = Object->GetClass(); Class && !bClassMatches; Class = Class->GetSuperClass())
+		{
+			bClassMatches = Class->GetName() == Parameter.ClassName;
+		}
+		if (!bClassMatches) continue;
+
+		FProperty* Property = FindFProperty<FProperty>(Object->GetClass(), *Parameter.PropertyName);
+		if (!Property)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SimulationParameters: %s has no property %s."), *Parameter.ClassName, *Parameter.PropertyName);
+			continue;
+		}
+
+		if (Property->ImportText_InContainer(*Parameter.Value, Object, Object, PPF_None))
+		{
+			NumSet++;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SimulationParameters: could not set %s.%s to '%s'."), *Parameter.ClassName, *Parameter.PropertyName, *Parameter.Value);
+		}
+	}
+	return NumSet;
+}
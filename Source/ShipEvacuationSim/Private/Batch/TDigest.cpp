@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Batch/TDigest.h"
+
+void FTDigest::Add(double Value, double Weight)
+{
+	if (Weight <= 0.0 || !FMath::IsFinite(Value)) return;
+
+	Buffer.Add({ Value, Weight });
+	BufferWeight += Weight;
+	Min = FMath::Min(Min, Value);
+	Max = FMath::Max(Max, Value);
+
+	// Sorting a batch at a time keeps adds amortised O(log n)
+	if (Buffer.Num() >= FMath::CeilToInt(Compression) * 5)
+	{
+		Compress();
+	}
+}
+
+void FTDigest::Merge(const FTDigest& Other)
+{
+	if (Other.GetTotalWeight() <= 0.0) return;
+
+	Buffer.Append(Other.Centroids);
+	Buffer.Append(Other.Buffer);
+	BufferWeight += Other.TotalWeight + Other.BufferWeight;
+	Min = FMath::Min(Min, Other.Min);
+	Max = FMath::Max(Max, Other.Max);
+	Compress();
+}
+
+double FTDigest::ScaleK(double Q) const
+{
+	return Compression / (2.0 * UE_DOUBLE_PI) * FMath::Asin(2.0 * FMath::Clamp(Q, 0.0, 1.0) - 1.0);
+}
+
+void FTDigest::Compress()
+{
+	if (Buffer.Num() == 0) return;
+
+	Buffer.Append(Centroids);
+	Buffer.Sort([](const FCentroid& A, const FCentroid& B) { return A.Mean < B.Mean; });
+
+	const double Total = TotalWeight + BufferWeight;
+	TArray<FCentroid> Merged;
+	Merged.Reserve(FMath::CeilToInt(Compression * 2.0));
+	Merged.Add(Buffer[0]);
+
+	// A centroid may grow while it spans at most one unit of k
+	double WeightBefore = 0.0;
+	double KLeft = ScaleK(0.0);
+	for (int32 i = 1; i < Buffer.Num(); ++i)
+	{
+		FCentroid& Last = Merged.Last();
+		const FCentroid& Next = Buffer[i];
+		const double QRight = (WeightBefore + Last.Weight + Next.Weight) / Total;
+
+		if (ScaleK(QRight) - KLeft <= 1.0)
+		{
+			Last.Weight += Next.Weight;
+			Last.Mean += (Next.Mean - Last.Mean) * Next.Weight / Last.Weight;
+		}
+		else
+		{
+			WeightBefore += Last.Weight;
+			KLeft = ScaleK(WeightBefore / Total);
+			Merged.Add(Next);
+		}
+	}
+
+	Centroids = MoveTemp(Merged);
+	TotalWeight = Total;
+	Buffer.Reset();
+	BufferWeight = 0.0;
+}
+
+double FTDigest::GetQuantile(double Q) const
+{
+	if (Buffer.Num() > 0)
+	{
+		FTDigest Compressed = *this;
+		Compressed.Compress();
+		return Compressed.GetQuantile(Q);
+	}
+
+	if (Centroids.Num() == 0) return 0.0;
+	if (Centroids.Num() == 1) return Centroids[0].Mean;
+
+	Q = FMath::Clamp(Q, 0.0, 1.0);
+	const double Target = Q * TotalWeight;
+
+	// Between the minimum and the first centroid's centre
+	const FCentroid& First = Centroids[0];
+	if (Target < First.Weight * 0.5)
+	{
+		return FMath::Lerp(Min, First.Mean, Target / (First.Weight * 0.5));
+	}
+
+	// Interpolate between neighbouring centroid centres
+	double Cumulative = First.Weight * 0.5;
+	for (int32 i = 0; i < Centroids.Num() - 1; ++i)
+	{
+		const double Gap = (Centroids[i].Weight + Centroids[i + 1].Weight) * 0.5;
+		if (Target < Cumulative + Gap)
+		{
+			return FMath::Lerp(Centroids[i].Mean, Centroids[i + 1].Mean, (Target - Cumulative) / Gap);
+		}
+		Cumulative += Gap;
+	}
+
+	// Between the last centroid's centre and the maximum
+	const FCentroid& Last = Centroids.Last();
+	const double Remaining = Last.Weight * 0.5;
+	return FMath::Lerp(Last.Mean, Max, Remaining > 0.0 ? FMath::Clamp((Target - Cumulative) / Remaining, 0.0, 1.0) : 1.0);
+}
+
+FArchive& operator<<(FArchive& Ar, FTDigest& Digest)
+{
+	if (Ar.IsSaving())
+	{
+		Digest.Compress();
+	}
+	return Ar << Digest.Compression << Digest.Centroids << Digest.TotalWeight << Digest.Min << Digest.Max;
+}
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/AgentPoolSubsystem.h"
+#include "AICharacter.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+
+bool UAgentPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAgentPoolSubsystem::Deinitialize()
+{
+	// The world destroys the actors themselves
+	Queue.Empty();
+	QueueHead = 0;
+	Active.Empty();
+	Parked.Empty();
+	PendingRelease.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UAgentPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAgentPoolSubsystem, STATGROUP_Tickables);
+}
+
+int32 UAgentPoolSubsystem::GetNumParked() const
+{
+	int32 NumParked = 0;
+	for (const TPair<const UClass*, TArray<TWeakObjectPtr<AAiCharacter>>>& Pair : Parked)
+	{
+		NumParked += Pair.Value.Num();
+	}
+	return NumParked;
+}
+
+// Requests
+void UAgentPoolSubsystem::QueueSpawn(const FAgentSpawnRequest& Request)
+{
+	if (!Request.AgentClass) return;
+
+	if (GetNumQueued() == 0)
+	{
+		BatchStart = Stats;
+	}
+	Queue.Add(Request);
+	Stats.Requested++;
+}
+
+void UAgentPoolSubsystem::Release(AAiCharacter* Agent)
+{
+	if (!Agent || Active.Remove(Agent) == 0) return;
+
+	Agent->DeactivateForPool();
+	Parked.FindOrAdd(Agent->GetClass()).Add(Agent);
+}
+
+void UAgentPoolSubsystem::ReleaseAll()
+{
+	Queue.Reset();
+	QueueHead = 0;
+	PendingRelease.Reset();
+
+	const TArray<TWeakObjectPtr<AAiCharacter>> Agents = Active.Array();
+	for (const TWeakObjectPtr<AAiCharacter>& Agent : Agents)
+	{
+		Release(Agent.Get());
+	}
+	Active.Reset();
+}
+
+void UAgentPoolSubsystem::NotifyMustered(AAiCharacter* Agent)
+{
+	if (bReleaseMusteredAgents && Active.Contains(Agent))
+	{
+		PendingRelease.Add(Agent);
+	}
+}
+
+// Tick
+void UAgentPoolSubsystem::Tick(float DeltaTime)
+{
+	for (const TWeakObjectPtr<AAiCharacter>& Agent : PendingRelease)
+	{
+		if (Agent.IsValid() && Active.Contains(Agent))
+		{
+			Release(Agent.Get());
+			Stats.ReleasedOnMuster++;
+		}
+	}
+	PendingRelease.Reset();
+
+	if (GetNumQueued() == 0) return;
+
+	SIM_SCOPE_CYCLE_COUNTER(AgentSpawn);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + SpawnBudgetMs / 1000.0;
+	do
+	{
+		SpawnAgent(Queue[QueueHead++]);
+	}
+	while (QueueHead < Queue.Num() && FPlatformTime::Seconds() < EndTime);
+
+	const double FrameSeconds = FPlatformTime::Seconds() - StartTime;
+	Stats.SpawnSeconds += FrameSeconds;
+	Stats.SpawnFrames++;
+	Stats.MaxFrameSeconds = FMath::Max(Stats.MaxFrameSeconds, FrameSeconds);
+
+	if (QueueHead == Queue.Num())
+	{
+		UE_LOG(LogTemp, Log, TEXT("AgentPool: spawned %d agents (%d new, %d reused) in %.1f ms over %d frames."),
+			QueueHead, Stats.Allocated - BatchStart.Allocated, Stats.Reused - BatchStart.Reused,
+			(Stats.SpawnSeconds - BatchStart.SpawnSeconds) * 1000.0, Stats.SpawnFrames - BatchStart.SpawnFrames);
+
+		Queue.Reset();
+		QueueHead = 0;
+	}
+}
+
+AAiCharacter* UAgentPoolSubsystem::SpawnAgent(const FAgentSpawnRequest& Request)
+{
+	// Stand the capsule on the navmesh point
+	const AAiCharacter* DefaultAgent = Request.AgentClass->GetDefaultObject<AAiCharacter>();
+	const float HalfHeight = DefaultAgent->GetCapsuleComponent() ? DefaultAgent->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() : 0.f;
+	const FVector Location = Request.Location + FVector(0.f, 0.f, HalfHeight);
+
+	AAiCharacter* Agent = TakeParked(Request.AgentClass);
+	if (Agent)
+	{
+		Agent->WalkSpeedOnFlat = Request.WalkSpeedOnFlat;
+		Agent->WalkSpeedOnStairs = Request.WalkSpeedOnStairs;
+		Agent->Demographics = Request.Demographics;
+		Agent->ActivateFromPool(Location, Request.Rotation);
+		Agent->SetBodyMaterial(Request.Material);
+
+		Stats.Reused++;
+		SimulationPerf::AddCount(ESimPerfCounter::AgentsReused);
+	}
+	else
+	{
+		// Deferred so Blueprint BeginPlay already sees the speeds and demographics
+		const FTransform Transform(Request.Rotation, Location);
+		Agent = GetWorld()->SpawnActorDeferred<AAiCharacter>(Request.AgentClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+		if (!Agent) return nullptr;
+
+		Agent->WalkSpeedOnFlat = Request.WalkSpeedOnFlat;
+		Agent->WalkSpeedOnStairs = Request.WalkSpeedOnStairs;
+		Agent->Demographics = Request.Demographics;
+		Agent->FinishSpawning(Transform);
+
+		// Replays destroy agents in BeginPlay
+		if (!IsValid(Agent)) return nullptr;
+
+		if (!Agent->GetController())
+		{
+			Agent->SpawnDefaultController();
+		}
+		Agent->SetBodyMaterial(Request.Material);
+
+		Stats.Allocated++;
+		SimulationPerf::AddCount(ESimPerfCounter::AgentsAllocated);
+	}
+
+	// Standing still for the demographic response time before heading off
+	Agent->WaitForResponseTime();
+
+	Active.Add(Agent);
+	OnAgentActivated.Broadcast(Agent);
+	return Agent;
+}
+
+AAiCharacter* UAgentPoolSubsystem::TakeParked(const UClass* AgentClass)
+{
+	TArray<TWeakObjectPtr<AAiCharacter>>* Agents = Parked.Find(AgentClass);
+	while (Agents && Agents->Num() > 0)
+	{
+		if (AAiCharacter* Agent = Agents->Pop(EAllowShrinking::No).Get())
+		{
+			return Agent;
+		}
+	}
+	return nullptr;
+}
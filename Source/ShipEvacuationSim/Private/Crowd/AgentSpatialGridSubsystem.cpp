@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/AgentSpatialGridSubsystem.h"
+#include "AICharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+
+bool UAgentSpatialGridSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAgentSpatialGridSubsystem::Deinitialize()
+{
+	RegisteredAgents.Empty();
+	SlotAgents.Empty();
+	SlotLocations.Empty();
+	SlotRadii.Empty();
+	Cells.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UAgentSpatialGridSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAgentSpatialGridSubsystem, STATGROUP_Tickables);
+}
+
+// Registration
+void UAgentSpatialGridSubsystem::RegisterAgent(AAiCharacter* Agent)
+{
+	if (Agent)
+	{
+		RegisteredAgents.AddUnique(Agent);
+	}
+}
+
+void UAgentSpatialGridSubsystem::UnregisterAgent(AAiCharacter* Agent)
+{
+	RegisteredAgents.RemoveSingleSwap(Agent);
+}
+
+// Rebuild
+void UAgentSpatialGridSubsystem::Tick(float DeltaTime)
+{
+	RebuildIfStale();
+}
+
+void UAgentSpatialGridSubsystem::RebuildIfStale()
+{
+	if (LastRebuildFrame != GFrameCounter)
+	{
+		LastRebuildFrame = GFrameCounter;
+		Rebuild();
+	}
+}
+
+FIntVector UAgentSpatialGridSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize.X),
+		FMath::FloorToInt(Location.Y / CellSize.Y),
+		FMath::FloorToInt(Location.Z / CellSize.Z)
+	);
+}
+
+void UAgentSpatialGridSubsystem::Rebuild()
+{
+	struct FEntry
+	{
+		FIntVector Cell;
+		AAiCharacter* Agent;
+		FVector Location;
+		float Radius;
+	};
+
+	TArray<FEntry> Entries;
+	Entries.Reserve(RegisteredAgents.Num());
+	MaxAgentRadius = 0.f;
+
+	for (int32 i = RegisteredAgents.Num() - 1; i >= 0; --i)
+	{
+		AAiCharacter* Agent = RegisteredAgents[i].Get();
+		if (!Agent)
+		{
+			RegisteredAgents.RemoveAtSwap(i);
+			continue;
+		}
+
+		const FVector Location = Agent->GetActorLocation();
+		const float Radius = Agent->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		MaxAgentRadius = FMath::Max(MaxAgentRadius, Radius);
+
+		Entries.Add({ GetCell(Location), Agent, Location, Radius });
+	}
+
+	// Sort by cell so each cell becomes one contiguous slot range
+	Entries.Sort([](const FEntry& A, const FEntry& B)
+	{
+		if (A.Cell.X != B.Cell.X) return A.Cell.X < B.Cell.X;
+		if (A.Cell.Y != B.Cell.Y) return A.Cell.Y < B.Cell.Y;
+		return A.Cell.Z < B.Cell.Z;
+	});
+
+	SlotAgents.SetNumUninitialized(Entries.Num(), EAllowShrinking::No);
+	SlotLocations.SetNumUninitialized(Entries.Num(), EAllowShrinking::No);
+	SlotRadii.SetNumUninitialized(Entries.Num(), EAllowShrinking::No);
+	Cells.Reset();
+
+	for (int32 Slot = 0; Slot < Entries.Num(); ++Slot)
+	{
+		const FEntry& Entry = Entries[Slot];
+		SlotAgents[Slot] = Entry.Agent;
+		SlotLocations[Slot] = Entry.Location;
+		SlotRadii[Slot] = Entry.Radius;
+
+		FCellRange& Range = Cells.FindOrAdd(Entry.Cell);
+		if (Range.Count == 0)
+		{
+			Range.Start = Slot;
+		}
+		Range.Count++;
+	}
+}
+
+// Queries
+template <typename PredicateType>
+void UAgentSpatialGridSubsystem::ForEachInBounds(const FVector& Min, const FVector& Max, PredicateType&& Predicate) const
+{
+	if (Cells.Num() == 0)
+	{
+		return;
+	}
+
+	const FIntVector MinCell = GetCell(Min);
+	const FIntVector MaxCell = GetCell(Max);
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				const FCellRange* Range = Cells.Find(FIntVector(X, Y, Z));
+				if (!Range) continue;
+
+				for (int32 Slot = Range->Start; Slot < Range->Start + Range->Count; ++Slot)
+				{
+					Predicate(Slot);
+				}
+			}
+		}
+	}
+}
+
+void UAgentSpatialGridSubsystem::ForEachInRadius(const FVector& Center, float Radius, bool bIgnoreHeight, TFunctionRef<void(int32 Slot)> Callback) const
+{
+	const float RadiusSq = FMath::Square(Radius);
+
+	// Height is bounded to one cell above and below when ignored, which keeps the query on the current deck
+	const FVector HalfSize = bIgnoreHeight ? FVector(Radius, Radius, CellSize.Z * 0.5f) : FVector(Radius);
+
+	ForEachInBounds(Center - HalfSize, Center + HalfSize, [&](int32 Slot)
+	{
+		const FVector& Location = SlotLocations[Slot];
+		const float DistSq = bIgnoreHeight ? FVector::DistSquared2D(Center, Location) : FVector::DistSquared(Center, Location);
+		if (DistSq <= RadiusSq)
+		{
+			Callback(Slot);
+		}
+	});
+}
+
+void UAgentSpatialGridSubsystem::QueryRadius(const FVector& Center, float Radius, TArray<AAiCharacter*>& OutAgents, bool bIgnoreHeight) const
+{
+	OutAgents.Reset();
+	ForEachInRadius(Center, Radius, bIgnoreHeight, [&](int32 Slot)
+	{
+		OutAgents.Add(SlotAgents[Slot]);
+	});
+}
+
+int32 UAgentSpatialGridSubsystem::CountInRadius(const FVector& Center, float Radius, bool bIgnoreHeight) const
+{
+	int32 Count = 0;
+	ForEachInRadius(Center, Radius, bIgnoreHeight, [&Count](int32 Slot)
+	{
+		Count++;
+	});
+	return Count;
+}
+
+void UAgentSpatialGridSubsystem::QueryBox(const FTransform& BoxTransform, const FVector& BoxExtent, TArray<AAiCharacter*>& OutAgents) const
+{
+	OutAgents.Reset();
+
+	// Capsule radii are world-space, so test in an unscaled frame against the scaled extent
+	FTransform Frame = BoxTransform;
+	Frame.SetScale3D(FVector::OneVector);
+	const FVector Extent = BoxExtent * BoxTransform.GetScale3D().GetAbs();
+
+	// World-space bounds of the oriented box, grown by the largest capsule so touching agents are found
+	const FBox WorldBounds = FBox(-Extent, Extent).TransformBy(Frame).ExpandBy(FVector(MaxAgentRadius, MaxAgentRadius, 0.f));
+
+	ForEachInBounds(WorldBounds.Min, WorldBounds.Max, [&](int32 Slot)
+	{
+		const FVector Local = Frame.InverseTransformPosition(SlotLocations[Slot]);
+		const float Radius = SlotRadii[Slot];
+
+		if (FMath::Abs(Local.X) <= Extent.X + Radius &&
+			FMath::Abs(Local.Y) <= Extent.Y + Radius &&
+			FMath::Abs(Local.Z) <= Extent.Z)
+		{
+			OutAgents.Add(SlotAgents[Slot]);
+		}
+	});
+}
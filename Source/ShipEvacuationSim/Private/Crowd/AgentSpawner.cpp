@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/AgentSpawner.h"
+#include "Crowd/AgentPoolSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "AICharacter.h"
+#include "SimulationInstance.h"
+#include "Components/BoxComponent.h"
+#include "Misc/Crc.h"
+#include "EngineUtils.h"
+
+AAgentSpawner::AAgentSpawner()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SpawnArea = CreateDefaultSubobject<UBoxComponent>(TEXT("SpawnArea"));
+	SetRootComponent(SpawnArea);
+	SpawnArea->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SpawnArea->SetCanEverAffectNavigation(false);
+	SpawnArea->SetBoxExtent(FVector(500.f, 500.f, 200.f));
+}
+
+void AAgentSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	if (NavMeta && !NavMeta->IsBaked())
+	{
+		// Cells are where agents are known to stand on the navmesh
+		BakedHandle = NavMeta->OnBaked.AddUObject(this, &AAgentSpawner::SpawnAgents);
+		return;
+	}
+
+	SpawnAgents();
+}
+
+void AAgentSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAgentSpawner::SpawnAgents()
+{
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+	BakedHandle.Reset();
+
+	const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+	if (GameInstance && GameInstance->IsReplaying()) return;
+
+	if (!SpawnTable || SpawnTable->GetRowStruct() != FAgentSpawnRow::StaticStruct())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: no spawn table of FAgentSpawnRow rows."), *GetName());
+		return;
+	}
+
+	// Run N of a batch gets the same population whatever ran before it, in any process; spawners differ by
+	// a CRC of their name, as FName hashes depend on the order names were created in
+	const int32 RunSeed = GameInstance ? GameInstance->BatchSettings.Seed + GameInstance->PersistentRunIndex : 0;
+	FRandomStream Stream(int32(HashCombine(GetTypeHash(RunSeed), FCrc::StrCrc32(*GetName()))));
+
+	int32 NumQueued = 0;
+	SpawnTable->ForeachRow<FAgentSpawnRow>(TEXT("AgentSpawner"), [this, &NumQueued, &Stream](const FName& RowName, const FAgentSpawnRow& Row)
+	{
+		NumQueued += QueueRow(Row, RowName, Stream);
+	});
+
+	UE_LOG(LogTemp, Log, TEXT("%s: queued %d agents from %s."), *GetName(), NumQueued, *SpawnTable->GetName());
+}
+
+int32 AAgentSpawner::QueueRow(const FAgentSpawnRow& Row, const FName& RowName, FRandomStream& Stream)
+{
+	UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>();
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	if (!Pool || !NavMeta || !NavMeta->IsBaked() || !Row.AgentClass || Row.Count <= 0) return 0;
+
+	TArray<FBox> Areas;
+	if (Row.AreaTag.IsNone())
+	{
+		Areas.Add(SpawnArea->Bounds.GetBox());
+	}
+	else
+	{
+		for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+		{
+			if (It->ActorHasTag(Row.AreaTag))
+			{
+				Areas.Add(It->GetComponentsBoundingBox(true));
+			}
+		}
+	}
+
+	TArray<int32> Cells;
+	for (const FBox& Area : Areas)
+	{
+		NavMeta->ForEachCellInBox(Area, [&Cells](int32 Cell) { Cells.Add(Cell); });
+	}
+	if (Cells.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: no navigation metadata cells in the area of row %s."), *GetName(), *RowName.ToString());
+		return 0;
+	}
+
+	// The whole row's population in one batch
+	TArray<FAgentProfile> Profiles;
+	if (Row.Demographics && Row.Demographics->GetRowStruct() == FAgentDemographicRow::StaticStruct())
+	{
+		PopulationGenerator::Generate(*Row.Demographics, Row.Count, Stream, Profiles);
+	}
+	else
+	{
+		if (Row.Demographics)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: %s is not a table of FAgentDemographicRow rows, using the speeds of row %s."), *GetName(), *Row.Demographics->GetName(), *RowName.ToString());
+		}
+
+		Profiles.SetNum(Row.Count);
+		for (FAgentProfile& Profile : Profiles)
+		{
+			const float SpeedScale = 1.f + Stream.FRandRange(-Row.SpeedVariation, Row.SpeedVariation);
+			Profile.WalkSpeedOnFlat = Row.WalkSpeedOnFlat * SpeedScale;
+			Profile.WalkSpeedOnStairs = Row.WalkSpeedOnStairs * SpeedScale;
+		}
+	}
+
+	const float HalfCell = NavMeta->CellSize * 0.5f;
+	for (const FAgentProfile& Profile : Profiles)
+	{
+		FAgentSpawnRequest Request;
+		Request.AgentClass = Row.AgentClass;
+		Request.Location = NavMeta->GetCellLocation(Cells[Stream.RandHelper(Cells.Num())]) + FVector(Stream.FRandRange(-HalfCell, HalfCell), Stream.FRandRange(-HalfCell, HalfCell), 0.f);
+		Request.Rotation = FRotator(0.f, Stream.FRandRange(-180.f, 180.f), 0.f);
+		Request.WalkSpeedOnFlat = Profile.WalkSpeedOnFlat;
+		Request.WalkSpeedOnStairs = Profile.WalkSpeedOnStairs;
+		Request.Demographics = Profile.Demographics;
+		Request.Material = Profile.Material;
+		Pool->QueueSpawn(Request);
+	}
+	return Profiles.Num();
+}
+
+void AAgentSpawner::ResetForNewRun_Implementation()
+{
+	SpawnAgents();
+}
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/AgentStateStore.h"
+
+void FAgentStateStore::Reset()
+{
+	PosX.Reset();
+	PosY.Reset();
+	PosZ.Reset();
+	VelX.Reset();
+	VelY.Reset();
+	VelZ.Reset();
+	Radius.Reset();
+	Flags.Reset();
+	SourceIndex.Reset();
+	Cells.Reset();
+}
+
+void FAgentStateStore::Reserve(int32 Count)
+{
+	PosX.Reserve(Count);
+	PosY.Reserve(Count);
+	PosZ.Reserve(Count);
+	VelX.Reserve(Count);
+	VelY.Reserve(Count);
+	VelZ.Reserve(Count);
+	Radius.Reserve(Count);
+	Flags.Reserve(Count);
+	SourceIndex.Reserve(Count);
+}
+
+int32 FAgentStateStore::Add(const FVector& Position, const FVector& Velocity, float InRadius, EAgentStateFlags InFlags, int32 InSourceIndex)
+{
+	PosX.Add(Position.X);
+	PosY.Add(Position.Y);
+	PosZ.Add(Position.Z);
+	VelX.Add(Velocity.X);
+	VelY.Add(Velocity.Y);
+	VelZ.Add(Velocity.Z);
+	Radius.Add(InRadius);
+	Flags.Add(InFlags);
+	return SourceIndex.Add(InSourceIndex);
+}
+
+template <typename T>
+static void ApplyPermutation(TArray<T>& Array, const TArray<int32>& Order, TArray<T>& Scratch)
+{
+	Scratch.SetNumUninitialized(Order.Num(), EAllowShrinking::No);
+	for (int32 i = 0; i < Order.Num(); ++i)
+	{
+		Scratch[i] = Array[Order[i]];
+	}
+	Swap(Array, Scratch);
+}
+
+void FAgentStateStore::BuildCells(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.f);
+	Cells.Reset();
+
+	const int32 Count = Num();
+	if (Count == 0) return;
+
+	TArray<FIntVector> AgentCells;
+	AgentCells.SetNumUninitialized(Count);
+
+	TArray<int32> Order;
+	Order.SetNumUninitialized(Count);
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		AgentCells[i] = GetCell(PosX[i], PosY[i], PosZ[i]);
+		Order[i] = i;
+	}
+
+	Order.Sort([&AgentCells](int32 A, int32 B)
+	{
+		const FIntVector& CA = AgentCells[A];
+		const FIntVector& CB = AgentCells[B];
+		if (CA.X != CB.X) return CA.X < CB.X;
+		if (CA.Y != CB.Y) return CA.Y < CB.Y;
+		return CA.Z < CB.Z;
+	});
+
+	TArray<float> FloatScratch;
+	ApplyPermutation(PosX, Order, FloatScratch);
+	ApplyPermutation(PosY, Order, FloatScratch);
+	ApplyPermutation(PosZ, Order, FloatScratch);
+	ApplyPermutation(VelX, Order, FloatScratch);
+	ApplyPermutation(VelY, Order, FloatScratch);
+	ApplyPermutation(VelZ, Order, FloatScratch);
+	ApplyPermutation(Radius, Order, FloatScratch);
+
+	TArray<EAgentStateFlags> FlagScratch;
+	ApplyPermutation(Flags, Order, FlagScratch);
+
+	TArray<int32> IndexScratch;
+	ApplyPermutation(SourceIndex, Order, IndexScratch);
+
+	// Sorted arrays are now grouped by cell; record each group's range
+	int32 RangeStart = 0;
+	for (int32 i = 1; i <= Count; ++i)
+	{
+		if (i == Count || AgentCells[Order[i]] != AgentCells[Order[RangeStart]])
+		{
+			Cells.Add(AgentCells[Order[RangeStart]], FIntPoint(RangeStart, i));
+			RangeStart = i;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Micro-benchmark for the repulsion kernel: Crowd.BenchmarkRepulsion [Iterations]
+
+#include "Crowd/AgentStateStore.h"
+#include "Crowd/CrowdKernels.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+
+namespace CrowdKernelBenchmark
+{
+	// Fills the store with agents at roughly 1.5 agents/m² on one deck, like a busy corridor
+	static void FillStore(FAgentStateStore& Store, int32 Count, FRandomStream& Random)
+	{
+		const float Side = FMath::Sqrt(Count / 1.5f) * 100.f;
+
+		Store.Reset();
+		Store.Reserve(Count);
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FVector Position(Random.FRandRange(0.f, Side), Random.FRandRange(0.f, Side), 90.f);
+			const FVector Velocity(Random.FRandRange(-150.f, 150.f), Random.FRandRange(-150.f, 150.f), 0.f);
+			Store.Add(Position, Velocity, 34.f, EAgentStateFlags::Active, i);
+		}
+	}
+
+	template <typename KernelType>
+	static double TimeKernel(const FAgentStateStore& Store, const CrowdKernels::FRepulsionParams& Params, int32 Iterations, TArray<FVector3f>& Out, KernelType Kernel)
+	{
+		Out.SetNumUninitialized(Store.Num());
+
+		const double Start = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Kernel(Store, Params, 0, Store.Num(), Out.GetData());
+		}
+		return FPlatformTime::Seconds() - Start;
+	}
+
+	static void Run(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 20;
+		const int32 AgentCounts[] = { 1000, 5000, 20000 };
+
+		FRandomStream Random(1337);
+		CrowdKernels::FRepulsionParams Params;
+
+		for (const int32 Count : AgentCounts)
+		{
+			FAgentStateStore Store;
+			FillStore(Store, Count, Random);
+
+			const double BuildStart = FPlatformTime::Seconds();
+			Store.BuildCells(Params.Radius);
+			const double BuildSeconds = FPlatformTime::Seconds() - BuildStart;
+
+			TArray<FVector3f> ScalarOut;
+			TArray<FVector3f> VectorOut;
+			const double ScalarSeconds = TimeKernel(Store, Params, Iterations, ScalarOut, &CrowdKernels::ComputeRepulsionScalar);
+			const double VectorSeconds = TimeKernel(Store, Params, Iterations, VectorOut, &CrowdKernels::ComputeRepulsion);
+
+			float MaxError = 0.f;
+			for (int32 i = 0; i < Count; ++i)
+			{
+				MaxError = FMath::Max(MaxError, (ScalarOut[i] - VectorOut[i]).GetAbsMax());
+			}
+
+			const double NsPerAgent = 1.0e9 / (double(Count) * Iterations);
+			UE_LOG(LogTemp, Display, TEXT("Repulsion %6d agents | build %.1f ns/agent | scalar %.1f ns/agent | simd %.1f ns/agent | speedup %.2fx | max error %g"),
+				Count,
+				BuildSeconds * 1.0e9 / Count,
+				ScalarSeconds * NsPerAgent,
+				VectorSeconds * NsPerAgent,
+				VectorSeconds > 0.0 ? ScalarSeconds / VectorSeconds : 0.0,
+				MaxError
+			);
+		}
+	}
+
+	static FAutoConsoleCommand BenchmarkRepulsionCommand(
+		TEXT("Crowd.BenchmarkRepulsion"),
+		TEXT("Times the scalar and SIMD repulsion kernels at 1k, 5k and 20k agents. Optional argument: iterations."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&Run)
+	);
+}
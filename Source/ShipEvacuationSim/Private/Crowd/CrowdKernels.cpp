@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdKernels.h"
+#include "Crowd/AgentStateStore.h"
+#include "Math/VectorRegister.h"
+
+namespace CrowdKernels
+{
+	static FORCEINLINE void AccumulatePair(float Dx, float Dy, float Dz, const FRepulsionParams& Params, FVector3f& Acc)
+	{
+		const float Distance = FMath::Sqrt(Dx * Dx + Dy * Dy + Dz * Dz);
+		if (Distance < Params.Radius && Distance > KINDA_SMALL_NUMBER)
+		{
+			const float Scale = (Params.FalloffDistance - Distance) / (Params.FalloffDistance * Distance);
+			Acc.X += Dx * Scale;
+			Acc.Y += Dy * Scale;
+			Acc.Z += Dz * Scale;
+		}
+	}
+
+	void ComputeRepulsionScalar(const FAgentStateStore& Store, const FRepulsionParams& Params, int32 Begin, int32 End, FVector3f* Out)
+	{
+		const float* RESTRICT PosX = Store.PosX.GetData();
+		const float* RESTRICT PosY = Store.PosY.GetData();
+		const float* RESTRICT PosZ = Store.PosZ.GetData();
+
+		for (int32 i = Begin; i < End; ++i)
+		{
+			FVector3f Acc = FVector3f::ZeroVector;
+
+			if (!Params.bActiveOnly || Store.HasFlag(i, EAgentStateFlags::Active))
+			{
+				const FVector Position = Store.GetPosition(i);
+				Store.ForEachCellRange(Position - FVector(Params.Radius), Position + FVector(Params.Radius), [&](int32 Start, int32 Stop)
+				{
+					for (int32 j = Start; j < Stop; ++j)
+					{
+						AccumulatePair(PosX[i] - PosX[j], PosY[i] - PosY[j], PosZ[i] - PosZ[j], Params, Acc);
+					}
+				});
+			}
+
+			Out[i] = Acc;
+		}
+	}
+
+	void ComputeRepulsion(const FAgentStateStore& Store, const FRepulsionParams& Params, int32 Begin, int32 End, FVector3f* Out)
+	{
+		const float* RESTRICT PosX = Store.PosX.GetData();
+		const float* RESTRICT PosY = Store.PosY.GetData();
+		const float* RESTRICT PosZ = Store.PosZ.GetData();
+
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float RadiusV = VectorSetFloat1(Params.Radius);
+		const VectorRegister4Float FalloffV = VectorSetFloat1(Params.FalloffDistance);
+		const VectorRegister4Float EpsilonV = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+		for (int32 i = Begin; i < End; ++i)
+		{
+			if (Params.bActiveOnly && !Store.HasFlag(i, EAgentStateFlags::Active))
+			{
+				Out[i] = FVector3f::ZeroVector;
+				continue;
+			}
+
+			const VectorRegister4Float Px = VectorSetFloat1(PosX[i]);
+			const VectorRegister4Float Py = VectorSetFloat1(PosY[i]);
+			const VectorRegister4Float Pz = VectorSetFloat1(PosZ[i]);
+
+			VectorRegister4Float AccX = Zero;
+			VectorRegister4Float AccY = Zero;
+			VectorRegister4Float AccZ = Zero;
+			FVector3f Tail = FVector3f::ZeroVector;
+
+			const FVector Position = Store.GetPosition(i);
+			Store.ForEachCellRange(Position - FVector(Params.Radius), Position + FVector(Params.Radius), [&](int32 Start, int32 Stop)
+			{
+				int32 j = Start;
+
+				// Blocks of four neighbours; cells are contiguous so these are plain unaligned loads
+				for (; j + 4 <= Stop; j += 4)
+				{
+					const VectorRegister4Float Dx = VectorSubtract(Px, VectorLoad(PosX + j));
+					const VectorRegister4Float Dy = VectorSubtract(Py, VectorLoad(PosY + j));
+					const VectorRegister4Float Dz = VectorSubtract(Pz, VectorLoad(PosZ + j));
+
+					const VectorRegister4Float DistSq = VectorMultiplyAdd(Dx, Dx, VectorMultiplyAdd(Dy, Dy, VectorMultiply(Dz, Dz)));
+					const VectorRegister4Float Dist = VectorSqrt(DistSq);
+
+					// Self and out-of-range neighbours are masked to zero; the select also discards the 0/0 lane
+					const VectorRegister4Float InRange = VectorBitwiseAnd(VectorCompareLT(Dist, RadiusV), VectorCompareGT(Dist, EpsilonV));
+					const VectorRegister4Float Scale = VectorSelect(InRange,
+						VectorDivide(VectorSubtract(FalloffV, Dist), VectorMultiply(FalloffV, Dist)),
+						Zero);
+
+					AccX = VectorMultiplyAdd(Dx, Scale, AccX);
+					AccY = VectorMultiplyAdd(Dy, Scale, AccY);
+					AccZ = VectorMultiplyAdd(Dz, Scale, AccZ);
+				}
+
+				for (; j < Stop; ++j)
+				{
+					AccumulatePair(PosX[i] - PosX[j], PosY[i] - PosY[j], PosZ[i] - PosZ[j], Params, Tail);
+				}
+			});
+
+			alignas(16) float SumX[4];
+			alignas(16) float SumY[4];
+			alignas(16) float SumZ[4];
+			VectorStoreAligned(AccX, SumX);
+			VectorStoreAligned(AccY, SumY);
+			VectorStoreAligned(AccZ, SumZ);
+
+			Out[i] = FVector3f(
+				Tail.X + SumX[0] + SumX[1] + SumX[2] + SumX[3],
+				Tail.Y + SumY[0] + SumY[1] + SumY[2] + SumY[3],
+				Tail.Z + SumZ[0] + SumZ[1] + SumZ[2] + SumZ[3]
+			);
+		}
+	}
+}
@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdSchedulerSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "AICharacter.h"
+#include "Engine/World.h"
+
+bool UCrowdSchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCrowdSchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SlotDuration = FMath::Max(SlotDuration, 0.001f);
+	NumSlots = FMath::Max(NumSlots, 1);
+	BatchSize = FMath::Max(BatchSize, 1);
+
+	Wheel.SetNum(NumSlots);
+	CurrentSlot = GetSlot(GetWorld()->GetTimeSeconds());
+}
+
+void UCrowdSchedulerSubsystem::Deinitialize()
+{
+	AgentSlots.Empty();
+	FreeHandles.Empty();
+	Wheel.Empty();
+	Ready.Empty();
+	ReadyHead = 0;
+
+	Super::Deinitialize();
+}
+
+TStatId UCrowdSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCrowdSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+// Registration
+void UCrowdSchedulerSubsystem::RegisterAgent(AAiCharacter* Agent)
+{
+	if (!Agent || Agent->SchedulerHandle != INDEX_NONE) return;
+
+	const int32 Handle = FreeHandles.Num() > 0 ? FreeHandles.Pop(EAllowShrinking::No) : AgentSlots.AddDefaulted();
+	AgentSlots[Handle].Agent = Agent;
+	Agent->SchedulerHandle = Handle;
+
+	// Golden ratio sequence: every new agent lands in the largest gap of the phases so far
+	const double Phase = FMath::Frac(NumRegistered++ * 0.6180339887);
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (const ECrowdTask Type : { ECrowdTask::ThrottledUpdate, ECrowdTask::StuckCheck, ECrowdTask::NavMeshCheck })
+	{
+		Schedule(Handle, Type, Now + Phase * GetInterval(Type));
+	}
+}
+
+void UCrowdSchedulerSubsystem::UnregisterAgent(AAiCharacter* Agent)
+{
+	if (!Agent || !AgentSlots.IsValidIndex(Agent->SchedulerHandle)) return;
+
+	// Queued tasks are dropped when they come up
+	FAgentSlot& Slot = AgentSlots[Agent->SchedulerHandle];
+	Slot.Agent = nullptr;
+	Slot.Generation++;
+
+	FreeHandles.Add(Agent->SchedulerHandle);
+	Agent->SchedulerHandle = INDEX_NONE;
+}
+
+void UCrowdSchedulerSubsystem::ScheduleOnce(AAiCharacter* Agent, ECrowdTask Task, float Delay)
+{
+	if (!Agent || !AgentSlots.IsValidIndex(Agent->SchedulerHandle)) return;
+
+	Schedule(Agent->SchedulerHandle, Task, GetWorld()->GetTimeSeconds() + Delay);
+}
+
+// Wheel
+int64 UCrowdSchedulerSubsystem::GetSlot(double Time) const
+{
+	return FMath::FloorToInt64(Time / SlotDuration);
+}
+
+float UCrowdSchedulerSubsystem::GetInterval(ECrowdTask Type) const
+{
+	switch (Type)
+	{
+	case ECrowdTask::ThrottledUpdate: return ThrottledUpdateInterval;
+	case ECrowdTask::StuckCheck: return StuckCheckInterval;
+	case ECrowdTask::NavMeshCheck: return NavMeshCheckInterval;
+	default: return 0.f;
+	}
+}
+
+void UCrowdSchedulerSubsystem::Schedule(int32 Handle, ECrowdTask Type, double DueTime)
+{
+	// Never early, at most one slot late
+	const int64 DueSlot = FMath::Max(FMath::CeilToInt64(DueTime / SlotDuration), CurrentSlot + 1);
+
+	FTask Task;
+	Task.Handle = Handle;
+	Task.Generation = AgentSlots[Handle].Generation;
+	Task.Type = Type;
+	Task.Rounds = int32((DueSlot - CurrentSlot - 1) / NumSlots);
+	Task.DueSlot = DueSlot;
+
+	Wheel[DueSlot % NumSlots].Add(Task);
+}
+
+void UCrowdSchedulerSubsystem::Advance(double Now)
+{
+	const int64 TargetSlot = GetSlot(Now);
+	while (CurrentSlot < TargetSlot)
+	{
+		CurrentSlot++;
+
+		TArray<FTask>& Bucket = Wheel[CurrentSlot % NumSlots];
+		for (int32 i = 0; i < Bucket.Num();)
+		{
+			if (Bucket[i].Rounds > 0)
+			{
+				Bucket[i].Rounds--;
+				++i;
+			}
+			else
+			{
+				Ready.Add(Bucket[i]);
+				Bucket.RemoveAtSwap(i, 1, EAllowShrinking::No);
+			}
+		}
+	}
+}
+
+// Tick
+void UCrowdSchedulerSubsystem::Tick(float DeltaTime)
+{
+	SIM_SCOPE_CYCLE_COUNTER(AgentTasks);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	Advance(Now);
+
+	if (ReadyHead >= Ready.Num())
+	{
+		LastLateness = 0.f;
+		return;
+	}
+
+	LastLateness = float(CurrentSlot - Ready[ReadyHead].DueSlot) * SlotDuration;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = BudgetMs * 0.001;
+	do
+	{
+		const int32 BatchEnd = FMath::Min(ReadyHead + BatchSize, Ready.Num());
+		for (; ReadyHead < BatchEnd; ++ReadyHead)
+		{
+			RunTask(Ready[ReadyHead], Now);
+		}
+	}
+	while (ReadyHead < Ready.Num() && FPlatformTime::Seconds() - StartTime < Budget);
+
+	Ready.RemoveAt(0, ReadyHead, EAllowShrinking::No);
+	ReadyHead = 0;
+}
+
+void UCrowdSchedulerSubsystem::RunTask(const FTask& Task, double Now)
+{
+	if (AgentSlots[Task.Handle].Generation != Task.Generation) return;
+
+	AAiCharacter* Agent = AgentSlots[Task.Handle].Agent.Get();
+	if (!Agent) return;
+
+	switch (Task.Type)
+	{
+	case ECrowdTask::ThrottledUpdate:
+		Agent->ThrottledUpdate();
+		break;
+
+	// Agents at reduced simulation LOD nav-walk alone, so they can neither leave the navmesh nor be stuck in a crowd
+	case ECrowdTask::StuckCheck:
+		if (!Agent->IsSimulationReduced()) Agent->CheckIfStuck();
+		break;
+
+	case ECrowdTask::NavMeshCheck:
+		if (!Agent->IsSimulationReduced()) Agent->CheckNavMeshRecovery();
+		break;
+
+	case ECrowdTask::RestoreCapsule:
+		Agent->RestoreCapsule();
+		return;
+	}
+
+	// The task may have unregistered the agent. Keep the phase even when running late.
+	if (AgentSlots[Task.Handle].Generation == Task.Generation)
+	{
+		Schedule(Task.Handle, Task.Type, Task.DueSlot * SlotDuration + GetInterval(Task.Type));
+	}
+}
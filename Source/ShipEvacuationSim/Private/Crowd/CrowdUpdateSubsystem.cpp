@@ -0,0 +1,426 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Crowd/AgentSpatialGridSubsystem.h"
+#include "Crowd/CrowdKernels.h"
+#include "Crowd/OrcaKernel.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Navigation/FlowFieldSubsystem.h"
+#include "Volumes/CrowdDensityVolume.h"
+#include "Volumes/FireVolume.h"
+#include "AgentMovementComponent.h"
+#include "AICharacter.h"
+#include "SimulationInstance.h"
+#include "Async/ParallelFor.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+double FCrowdLodStats::GetMovementSecondsSaved() const
+{
+	if (FullAgentSeconds <= 0.0 || ReducedAgentSeconds <= 0.0) return 0.0;
+
+	const double FullCost = FullMovementSeconds / FullAgentSeconds;
+	const double ReducedCost = ReducedMovementSeconds / ReducedAgentSeconds;
+	return (FullCost - ReducedCost) * ReducedAgentSeconds;
+}
+
+double FAgentMovementCost::GetMicroseconds(EAgentMovementKind Kind) const
+{
+	const int32 Index = int32(Kind);
+	return Ticks[Index] > 0 ? Seconds[Index] * 1.0e6 / Ticks[Index] : 0.0;
+}
+
+bool UCrowdUpdateSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCrowdUpdateSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const USimulationInstance* GameInstance = Cast<USimulationInstance>(InWorld.GetGameInstance());
+	if (GameInstance && GameInstance->BatchSettings.bSimulationLod)
+	{
+		bSimulationLod = true;
+	}
+}
+
+void UCrowdUpdateSubsystem::Deinitialize()
+{
+	Agents.Empty();
+	Store.Reset();
+	Frames.Empty();
+	Repulsion.Empty();
+	OrcaAgents.Empty();
+	OrcaVelocities.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UCrowdUpdateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCrowdUpdateSubsystem, STATGROUP_Tickables);
+}
+
+// Registration
+void UCrowdUpdateSubsystem::RegisterAgent(AAiCharacter* Agent)
+{
+	if (!Agent) return;
+
+	FAgentRecord& Record = Agents.AddDefaulted_GetRef();
+	Record.Agent = Agent;
+	Record.Interval = FMath::FRandRange(MinUpdateInterval, MaxUpdateInterval);
+
+	Record.Movement = Cast<UAgentMovementComponent>(Agent->GetCharacterMovement());
+	if (Record.Movement)
+	{
+		Record.Movement->SetOrcaAvoidance(bUseOrca);
+	}
+}
+
+void UCrowdUpdateSubsystem::UnregisterAgent(AAiCharacter* Agent)
+{
+	const int32 Index = Agents.IndexOfByPredicate([Agent](const FAgentRecord& Record)
+	{
+		return Record.Agent.Get() == Agent;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		Agents.RemoveAtSwap(Index);
+	}
+}
+
+void UCrowdUpdateSubsystem::MarkMustered(AAiCharacter* Agent)
+{
+	for (FAgentRecord& Record : Agents)
+	{
+		if (Record.Agent.Get() == Agent)
+		{
+			Record.bMustered = true;
+			return;
+		}
+	}
+}
+
+void UCrowdUpdateSubsystem::ForEachAgent(TFunctionRef<void(const AAiCharacter*)> Callback) const
+{
+	for (const FAgentRecord& Record : Agents)
+	{
+		if (const AAiCharacter* Agent = Record.Agent.Get())
+		{
+			Callback(Agent);
+		}
+	}
+}
+
+void UCrowdUpdateSubsystem::NotifyAgentProgress()
+{
+	LastProgressTime = GetWorld()->GetTimeSeconds();
+}
+
+void UCrowdUpdateSubsystem::AddMovementTime(EAgentMovementKind Kind, double Seconds)
+{
+	MovementCost.Seconds[int32(Kind)] += Seconds;
+	++MovementCost.Ticks[int32(Kind)];
+
+	(Kind == EAgentMovementKind::Reduced ? LodStats.ReducedMovementSeconds : LodStats.FullMovementSeconds) += Seconds;
+}
+
+// Tick
+void UCrowdUpdateSubsystem::Tick(float DeltaTime)
+{
+	SIM_SCOPE_CYCLE_COUNTER(CrowdUpdate);
+
+	if (UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>())
+	{
+		Grid->RebuildIfStale();
+	}
+
+	GatherHazards();
+	GatherFrames(DeltaTime);
+	SimulationPerf::AddCount(ESimPerfCounter::AgentsTicked, NumActive);
+
+	// Flow field steering still applies on frames where no agent is due an update
+	if (NumActive > 0)
+	{
+		ComputeFrames();
+	}
+	if (bUseOrca)
+	{
+		SolveAvoidance(DeltaTime);
+	}
+	ApplyFrames();
+}
+
+void UCrowdUpdateSubsystem::GatherHazards()
+{
+	Hazards.Reset();
+	if (!bSimulationLod) return;
+
+	for (TActorIterator<AFireVolume> It(GetWorld()); It; ++It)
+	{
+		Hazards.Add(It->FireBox->Bounds.GetBox());
+	}
+	for (TActorIterator<ACrowdDensityVolume> It(GetWorld()); It; ++It)
+	{
+		if (It->IsCongested())
+		{
+			Hazards.Add(It->Volume->Bounds.GetBox());
+		}
+	}
+}
+
+void UCrowdUpdateSubsystem::GatherFrames(float DeltaTime)
+{
+	// Drop destroyed agents first so record indices stay valid as SourceIndex
+	Agents.RemoveAllSwap([](const FAgentRecord& Record)
+	{
+		return !Record.Agent.IsValid();
+	});
+
+	Store.Reset();
+	Store.Reserve(Agents.Num());
+	Frames.SetNum(Agents.Num(), EAllowShrinking::No);
+	OrcaAgents.SetNum(Agents.Num(), EAllowShrinking::No);
+	NumActive = 0;
+
+	for (int32 i = 0; i < Agents.Num(); ++i)
+	{
+		FAgentRecord& Record = Agents[i];
+		AAiCharacter* Agent = Record.Agent.Get();
+		const UCapsuleComponent* Capsule = Agent->GetCapsuleComponent();
+
+		FAgentFrame& Frame = Frames[i];
+		Frame = FAgentFrame();
+		Frame.Agent = Agent;
+
+		EAgentStateFlags Flags = EAgentStateFlags::None;
+		if (Record.bMustered || Agent->bHasMustered)
+		{
+			Flags |= EAgentStateFlags::Mustered;
+		}
+		else
+		{
+			(Agent->bSimulationReduced ? LodStats.ReducedAgentSeconds : LodStats.FullAgentSeconds) += DeltaTime;
+
+			Record.Accumulated += DeltaTime;
+			if (Record.Accumulated >= Record.Interval)
+			{
+				// Reduced agents are checked for promotion but get no repulsion
+				if (!Agent->bSimulationReduced) Flags |= EAgentStateFlags::Active;
+				Frame.bActive = true;
+				Frame.DeltaTime = Record.Accumulated;
+				Record.Accumulated = 0.f;
+				NumActive++;
+			}
+		}
+
+		if (Agent->bIsResizingCapsule) Flags |= EAgentStateFlags::ResizingCapsule;
+		if (Agent->bIsRecovering) Flags |= EAgentStateFlags::Recovering;
+
+		Store.Add(Agent->GetActorLocation(), Agent->GetVelocity(), Capsule->GetScaledCapsuleRadius(), Flags, i);
+
+		// Mustered agents are obstacles; reduced ones have nobody to avoid
+		CrowdKernels::FOrcaAgent& Orca = OrcaAgents[i];
+		Orca.bSolve = bUseOrca && Record.Movement && Record.Movement->IsMovingOnGround()
+			&& !EnumHasAnyFlags(Flags, EAgentStateFlags::Mustered | EAgentStateFlags::Recovering) && !Agent->bSimulationReduced;
+		if (Orca.bSolve)
+		{
+			Orca.PreferredVelocity = FVector2f(Record.Movement->GetPreferredVelocity());
+			Orca.MaxSpeed = Record.Movement->GetMaxSpeed();
+		}
+
+		if (Frame.bActive)
+		{
+			Frame.bIsResizingCapsule = Agent->bIsResizingCapsule;
+			Frame.CapsuleRadius = Capsule->GetUnscaledCapsuleRadius();
+			Frame.CapsuleHalfHeight = Capsule->GetUnscaledCapsuleHalfHeight();
+			Frame.TargetCapsuleRadius = Agent->TargetCapsuleRadius;
+			Frame.TargetCapsuleHalfHeight = Agent->TargetCapsuleHalfHeight;
+			Frame.ResizeSpeed = Agent->ResizeSpeed;
+
+			Frame.bIsRecovering = Agent->bIsRecovering;
+			Frame.RecoveryTargetLocation = Agent->RecoveryTargetLocation;
+
+			Frame.FlowFieldGoal = Agent->FlowFieldGoal;
+			Frame.FeetLocation = Agent->GetNavAgentLocation();
+
+			// Anything the reduced update does not handle keeps the agent at full simulation
+			Frame.bReduced = Agent->bSimulationReduced;
+			Frame.bLodEligible = bSimulationLod && !Agent->bIsRecovering && !Agent->bIsResizingCapsule && !Agent->bCapsuleShrunk
+				&& Agent->GetCharacterMovement()->IsMovingOnGround();
+		}
+	}
+
+	Store.BuildCells(bUseOrca ? FMath::Max(RepulsionRadius, OrcaNeighbourDistance) : RepulsionRadius);
+}
+
+void UCrowdUpdateSubsystem::ComputeFrames()
+{
+	CrowdKernels::FRepulsionParams Params;
+	Params.Radius = RepulsionRadius;
+
+	Repulsion.SetNumUninitialized(Store.Num(), EAllowShrinking::No);
+
+	const int32 BlockSize = FMath::Max(BatchSize, 1);
+	const int32 NumBlocks = FMath::DivideAndRoundUp(Store.Num(), BlockSize);
+
+	const UFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UFlowFieldSubsystem>();
+	const UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>();
+
+	ParallelFor(TEXT("CrowdUpdate"), NumBlocks, 1, [this, &Params, BlockSize, FlowField, Grid](int32 Block)
+	{
+		const int32 Begin = Block * BlockSize;
+		const int32 End = FMath::Min(Begin + BlockSize, Store.Num());
+
+		// ORCA replaces the repulsion term
+		if (bUseOrca)
+		{
+			FMemory::Memzero(Repulsion.GetData() + Begin, (End - Begin) * sizeof(FVector3f));
+		}
+		else
+		{
+			CrowdKernels::ComputeRepulsion(Store, Params, Begin, End, Repulsion.GetData());
+		}
+
+		for (int32 i = Begin; i < End; ++i)
+		{
+			FAgentFrame& Frame = Frames[Store.SourceIndex[i]];
+			if (!Frame.bActive) continue;
+
+			const FVector RepulsionForceClamped = FVector(Repulsion[i]).GetClampedToMaxSize(1.0f);
+
+			// Flow field agents have no path; the sampled direction takes the place of their velocity
+			FVector FlowDirection;
+			if (Frame.FlowFieldGoal != INDEX_NONE && FlowField && FlowField->SampleDirection(Frame.FlowFieldGoal, Frame.FeetLocation, FlowDirection))
+			{
+				Frame.FlowInput = (FlowDirection + RepulsionForceClamped * 2.0f).GetSafeNormal();
+			}
+			else if (!bUseOrca)
+			{
+				const FVector Velocity = Store.GetVelocity(i);
+				const bool bHasMovement = !Velocity.IsNearlyZero();
+				const FVector FinalDirection = ((bHasMovement ? Velocity.GetSafeNormal() : FVector::ZeroVector) + RepulsionForceClamped * 2.0f).GetSafeNormal();
+
+				// Only add movement input if the agent is already moving or repulsion is strong
+				if (!FinalDirection.IsNearlyZero() && (bHasMovement || RepulsionForceClamped.SizeSquared() > 0.01f))
+				{
+					Frame.MoveInput = FinalDirection;
+				}
+			}
+
+			// Capsule resizing interpolation
+			if (Frame.bIsResizingCapsule)
+			{
+				Frame.NewCapsuleRadius = FMath::FInterpTo(Frame.CapsuleRadius, Frame.TargetCapsuleRadius, Frame.DeltaTime, Frame.ResizeSpeed);
+				Frame.NewCapsuleHalfHeight = FMath::FInterpTo(Frame.CapsuleHalfHeight, Frame.TargetCapsuleHalfHeight, Frame.DeltaTime, Frame.ResizeSpeed);
+				Frame.bFinishedResizing =
+					FMath::IsNearlyEqual(Frame.NewCapsuleRadius, Frame.TargetCapsuleRadius, 0.5f) &&
+					FMath::IsNearlyEqual(Frame.NewCapsuleHalfHeight, Frame.TargetCapsuleHalfHeight, 0.5f);
+			}
+
+			// Recovery steering, projected onto the navmesh when applied
+			if (Frame.bIsRecovering)
+			{
+				Frame.RecoveryStepLocation = FMath::VInterpTo(Store.GetPosition(i), Frame.RecoveryTargetLocation, Frame.DeltaTime, 2.0f);
+			}
+
+			// Simulation LOD, with a smaller radius to promote than to demote so agents do not flip at the edge
+			Frame.bWantReduced = false;
+			if (Frame.bLodEligible && Grid)
+			{
+				const FVector Position = Store.GetPosition(i);
+				const float Radius = Frame.bReduced ? LodPromoteRadius : LodDemoteRadius;
+
+				// The grid includes this agent
+				Frame.bWantReduced = Grid->CountInRadius(Position, Radius) <= 1
+					&& !Hazards.ContainsByPredicate([&Position, this](const FBox& Hazard)
+					{
+						return Hazard.ComputeSquaredDistanceToPoint(Position) < FMath::Square(LodHazardRadius);
+					});
+			}
+		}
+	});
+}
+
+void UCrowdUpdateSubsystem::SolveAvoidance(float DeltaTime)
+{
+	CrowdKernels::FOrcaParams Params;
+	Params.NeighbourDistance = OrcaNeighbourDistance;
+	Params.MaxNeighbours = OrcaMaxNeighbours;
+	Params.TimeHorizon = OrcaTimeHorizon;
+	Params.TimeStep = bDeterministicOrca ? OrcaFixedTimeStep : DeltaTime;
+	Params.bDeterministic = bDeterministicOrca;
+
+	OrcaVelocities.SetNumUninitialized(Agents.Num(), EAllowShrinking::No);
+
+	const int32 BlockSize = FMath::Max(BatchSize, 1);
+	const int32 NumBlocks = FMath::DivideAndRoundUp(Store.Num(), BlockSize);
+
+	ParallelFor(TEXT("CrowdAvoidance"), NumBlocks, 1, [this, &Params, BlockSize](int32 Block)
+	{
+		const int32 Begin = Block * BlockSize;
+		const int32 End = FMath::Min(Begin + BlockSize, Store.Num());
+
+		CrowdKernels::ComputeOrcaVelocities(Store, Params, OrcaAgents.GetData(), Begin, End, OrcaVelocities.GetData());
+	});
+}
+
+void UCrowdUpdateSubsystem::ApplyFrames()
+{
+	for (int32 i = 0; i < Frames.Num(); ++i)
+	{
+		const FAgentFrame& Frame = Frames[i];
+		FAgentRecord& Record = Agents[i];
+		AAiCharacter* Agent = Frame.Agent;
+		if (!IsValid(Agent)) continue;
+
+		if (Frame.bActive)
+		{
+			Record.FlowInput = Frame.FlowInput;
+		}
+
+		if (Record.Movement && Record.Movement->UsesOrcaAvoidance())
+		{
+			Record.Movement->SetAvoidanceVelocity(OrcaAgents[i].bSolve ? TOptional<FVector2f>(OrcaVelocities[i]) : TOptional<FVector2f>());
+		}
+
+		// Unlike path following there is nothing else moving the agent between updates
+		if (!Record.FlowInput.IsZero() && Agent->IsFollowingFlowField())
+		{
+			Agent->AddMovementInput(Record.FlowInput, 1.0f);
+		}
+
+		if (!Frame.bActive) continue;
+
+		if (Frame.bWantReduced != Frame.bReduced && Agent->SetSimulationReduced(Frame.bWantReduced))
+		{
+			(Frame.bWantReduced ? LodStats.Demotions : LodStats.Promotions)++;
+		}
+
+		if (!Frame.MoveInput.IsZero())
+		{
+			Agent->AddMovementInput(Frame.MoveInput, 1.0f);
+		}
+
+		if (Frame.bIsResizingCapsule)
+		{
+			Agent->GetCapsuleComponent()->SetCapsuleSize(Frame.NewCapsuleRadius, Frame.NewCapsuleHalfHeight, true);
+			if (Frame.bFinishedResizing)
+			{
+				Agent->bIsResizingCapsule = false;
+			}
+		}
+
+		if (Frame.bIsRecovering)
+		{
+			Agent->ApplyRecoveryStep(Frame.RecoveryStepLocation);
+		}
+	}
+}
@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/OrcaKernel.h"
+#include "Crowd/AgentStateStore.h"
+
+namespace CrowdKernels
+{
+	namespace Orca
+	{
+		static constexpr float Epsilon = 1e-5f;
+
+		// Permitted velocities lie to the left of Direction through Point
+		struct FLine
+		{
+			FVector2f Point = FVector2f::ZeroVector;
+			FVector2f Direction = FVector2f::ZeroVector;
+		};
+
+		struct FNeighbour
+		{
+			int32 Index = INDEX_NONE;
+			float DistanceSquared = 0.f;
+		};
+
+		static FORCEINLINE float Det(const FVector2f& A, const FVector2f& B)
+		{
+			return A.X * B.Y - A.Y * B.X;
+		}
+
+		// Optimises along one line, subject to the lines before it and the speed circle
+		static bool LinearProgram1(TArrayView<const FLine> Lines, int32 LineNo, float Radius, const FVector2f& OptVelocity, bool bDirectionOpt, FVector2f& Result)
+		{
+			const FLine& Line = Lines[LineNo];
+			const float DotProduct = Line.Point | Line.Direction;
+			const float Discriminant = FMath::Square(DotProduct) + FMath::Square(Radius) - Line.Point.SizeSquared();
+			if (Discriminant < 0.f)
+			{
+				// The speed circle misses the line entirely
+				return false;
+			}
+
+			const float SqrtDiscriminant = FMath::Sqrt(Discriminant);
+			float TLeft = -DotProduct - SqrtDiscriminant;
+			float TRight = -DotProduct + SqrtDiscriminant;
+
+			for (int32 i = 0; i < LineNo; ++i)
+			{
+				const float Denominator = Det(Line.Direction, Lines[i].Direction);
+				const float Numerator = Det(Lines[i].Direction, Line.Point - Lines[i].Point);
+
+				if (FMath::Abs(Denominator) <= Epsilon)
+				{
+					// Parallel lines: either this one is entirely excluded or the other adds nothing
+					if (Numerator < 0.f) return false;
+					continue;
+				}
+
+				const float T = Numerator / Denominator;
+				if (Denominator >= 0.f) TRight = FMath::Min(TRight, T);
+				else TLeft = FMath::Max(TLeft, T);
+
+				if (TLeft > TRight) return false;
+			}
+
+			if (bDirectionOpt)
+			{
+				Result = Line.Point + Line.Direction * ((OptVelocity | Line.Direction) > 0.f ? TRight : TLeft);
+			}
+			else
+			{
+				const float T = FMath::Clamp(Line.Direction | (OptVelocity - Line.Point), TLeft, TRight);
+				Result = Line.Point + Line.Direction * T;
+			}
+			return true;
+		}
+
+		// Returns the number of lines satisfied before one failed, Lines.Num() on success
+		static int32 LinearProgram2(TArrayView<const FLine> Lines, float Radius, const FVector2f& OptVelocity, bool bDirectionOpt, FVector2f& Result)
+		{
+			if (bDirectionOpt)
+			{
+				Result = OptVelocity * Radius;
+			}
+			else if (OptVelocity.SizeSquared() > FMath::Square(Radius))
+			{
+				Result = OptVelocity.GetSafeNormal() * Radius;
+			}
+			else
+			{
+				Result = OptVelocity;
+			}
+
+			for (int32 i = 0; i < Lines.Num(); ++i)
+			{
+				if (Det(Lines[i].Direction, Lines[i].Point - Result) > 0.f)
+				{
+					const FVector2f PreviousResult = Result;
+					if (!LinearProgram1(Lines, i, Radius, OptVelocity, bDirectionOpt, Result))
+					{
+						Result = PreviousResult;
+						return i;
+					}
+				}
+			}
+			return Lines.Num();
+		}
+
+		// No velocity satisfies every line: minimise the largest violation instead
+		static void LinearProgram3(TArrayView<const FLine> Lines, int32 BeginLine, float Radius, FVector2f& Result)
+		{
+			TArray<FLine, TInlineAllocator<32>> Projected;
+			float Distance = 0.f;
+
+			for (int32 i = BeginLine; i < Lines.Num(); ++i)
+			{
+				if (Det(Lines[i].Direction, Lines[i].Point - Result) <= Distance) continue;
+
+				Projected.Reset();
+				for (int32 j = 0; j < i; ++j)
+				{
+					FLine Line;
+					const float Determinant = Det(Lines[i].Direction, Lines[j].Direction);
+
+					if (FMath::Abs(Determinant) <= Epsilon)
+					{
+						if ((Lines[i].Direction | Lines[j].Direction) > 0.f) continue;
+						Line.Point = (Lines[i].Point + Lines[j].Point) * 0.5f;
+					}
+					else
+					{
+						Line.Point = Lines[i].Point + Lines[i].Direction * (Det(Lines[j].Direction, Lines[i].Point - Lines[j].Point) / Determinant);
+					}
+
+					Line.Direction = (Lines[j].Direction - Lines[i].Direction).GetSafeNormal();
+					Projected.Add(Line);
+				}
+
+				const FVector2f PreviousResult = Result;
+				if (LinearProgram2(Projected, Radius, FVector2f(-Lines[i].Direction.Y, Lines[i].Direction.X), true, Result) < Projected.Num())
+				{
+					// Only possible through rounding; keep the previous result
+					Result = PreviousResult;
+				}
+
+				Distance = Det(Lines[i].Direction, Lines[i].Point - Result);
+			}
+		}
+
+		static void InsertNeighbour(TArray<FNeighbour, TInlineAllocator<16>>& Neighbours, const FNeighbour& Candidate, int32 MaxNeighbours, const int32* SourceIndex)
+		{
+			// Sorted by distance; with SourceIndex, ties are ordered independently of the store
+			auto Before = [SourceIndex](const FNeighbour& A, const FNeighbour& B)
+			{
+				if (A.DistanceSquared != B.DistanceSquared) return A.DistanceSquared < B.DistanceSquared;
+				return SourceIndex && SourceIndex[A.Index] < SourceIndex[B.Index];
+			};
+
+			if (Neighbours.Num() == MaxNeighbours)
+			{
+				if (!Before(Candidate, Neighbours.Last())) return;
+				Neighbours.Pop(EAllowShrinking::No);
+			}
+
+			int32 Insert = Neighbours.Num();
+			while (Insert > 0 && Before(Candidate, Neighbours[Insert - 1]))
+			{
+				--Insert;
+			}
+			Neighbours.Insert(Candidate, Insert);
+		}
+	}
+
+	void ComputeOrcaVelocities(const FAgentStateStore& Store, const FOrcaParams& Params, const FOrcaAgent* Agents, int32 Begin, int32 End, FVector2f* Out)
+	{
+		using namespace Orca;
+
+		const float InvTimeHorizon = 1.f / FMath::Max(Params.TimeHorizon, Epsilon);
+		const float InvTimeStep = 1.f / FMath::Max(Params.TimeStep, Epsilon);
+		const float NeighbourDistanceSquared = FMath::Square(Params.NeighbourDistance);
+		const int32 MaxNeighbours = FMath::Max(Params.MaxNeighbours, 1);
+		const FVector Reach(Params.NeighbourDistance, Params.NeighbourDistance, Params.MaxHeightDifference);
+
+		TArray<FNeighbour, TInlineAllocator<16>> Neighbours;
+		TArray<FLine, TInlineAllocator<16>> Lines;
+
+		for (int32 i = Begin; i < End; ++i)
+		{
+			const int32 Source = Store.SourceIndex[i];
+			const FOrcaAgent& Agent = Agents[Source];
+			if (!Agent.bSolve) continue;
+
+			const FVector2f Position(Store.PosX[i], Store.PosY[i]);
+			const FVector2f Velocity(Store.VelX[i], Store.VelY[i]);
+			const float Radius = Store.Radius[i];
+
+			// Nearest neighbours on the same deck
+			Neighbours.Reset();
+			const FVector Center = Store.GetPosition(i);
+			Store.ForEachCellRange(Center - Reach, Center + Reach, [&](int32 Start, int32 Stop)
+			{
+				for (int32 j = Start; j < Stop; ++j)
+				{
+					if (j == i || FMath::Abs(Store.PosZ[j] - Store.PosZ[i]) > Params.MaxHeightDifference) continue;
+
+					const float DistanceSquared = FVector2f(Store.PosX[j] - Position.X, Store.PosY[j] - Position.Y).SizeSquared();
+					if (DistanceSquared < NeighbourDistanceSquared)
+					{
+						InsertNeighbour(Neighbours, { j, DistanceSquared }, MaxNeighbours, Params.bDeterministic ? Store.SourceIndex.GetData() : nullptr);
+					}
+				}
+			});
+
+			// One half-plane of permitted velocities per neighbour
+			Lines.Reset();
+			for (const FNeighbour& Neighbour : Neighbours)
+			{
+				const int32 j = Neighbour.Index;
+				const FVector2f RelativePosition = FVector2f(Store.PosX[j], Store.PosY[j]) - Position;
+				const FVector2f RelativeVelocity = Velocity - FVector2f(Store.VelX[j], Store.VelY[j]);
+				const float DistanceSquared = RelativePosition.SizeSquared();
+				const float CombinedRadius = Radius + Store.Radius[j];
+				const float CombinedRadiusSquared = FMath::Square(CombinedRadius);
+
+				FLine Line;
+				FVector2f U;
+
+				if (DistanceSquared > CombinedRadiusSquared)
+				{
+					// Vector from the cutoff circle centre to the relative velocity
+					const FVector2f W = RelativeVelocity - RelativePosition * InvTimeHorizon;
+					const float WLengthSquared = W.SizeSquared();
+					const float DotProduct = W | RelativePosition;
+
+					if (DotProduct < 0.f && FMath::Square(DotProduct) > CombinedRadiusSquared * WLengthSquared)
+					{
+						// Project on the cutoff circle
+						const float WLength = FMath::Sqrt(WLengthSquared);
+						const FVector2f UnitW = W / WLength;
+						Line.Direction = FVector2f(UnitW.Y, -UnitW.X);
+						U = UnitW * (CombinedRadius * InvTimeHorizon - WLength);
+					}
+					else
+					{
+						// Project on the nearer leg of the velocity obstacle
+						const float Leg = FMath::Sqrt(DistanceSquared - CombinedRadiusSquared);
+						if (Det(RelativePosition, W) > 0.f)
+						{
+							Line.Direction = FVector2f(
+								RelativePosition.X * Leg - RelativePosition.Y * CombinedRadius,
+								RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistanceSquared;
+						}
+						else
+						{
+							Line.Direction = -FVector2f(
+								RelativePosition.X * Leg + RelativePosition.Y * CombinedRadius,
+								-RelativePosition.X * CombinedRadius + RelativePosition.Y * Leg) / DistanceSquared;
+						}
+
+						U = Line.Direction * (RelativeVelocity | Line.Direction) - RelativeVelocity;
+					}
+				}
+				else
+				{
+					// Already overlapping: separate within one time step
+					const FVector2f W = RelativeVelocity - RelativePosition * InvTimeStep;
+					const float WLength = W.Size();
+					if (WLength <= Epsilon) continue;
+
+					const FVector2f UnitW = W / WLength;
+					Line.Direction = FVector2f(UnitW.Y, -UnitW.X);
+					U = UnitW * (CombinedRadius * InvTimeStep - WLength);
+				}
+
+				// Moving neighbours take half the avoidance; mustered ones take none
+				const float Share = EnumHasAnyFlags(Store.Flags[j], EAgentStateFlags::Mustered) ? 1.f : 0.5f;
+				Line.Point = Velocity + U * Share;
+				Lines.Add(Line);
+			}
+
+			FVector2f Result;
+			const int32 LineFail = LinearProgram2(Lines, Agent.MaxSpeed, Agent.PreferredVelocity, false, Result);
+			if (LineFail < Lines.Num())
+			{
+				LinearProgram3(Lines, LineFail, Agent.MaxSpeed, Result);
+			}
+
+			Out[Source] = Result;
+		}
+	}
+}
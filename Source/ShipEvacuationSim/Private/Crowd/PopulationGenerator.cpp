@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/PopulationGenerator.h"
+#include "Math/RandomStream.h"
+
+namespace PopulationGenerator
+{
+	TArray<int32> AllocateGroups(TConstArrayView<const FAgentDemographicRow*> Groups, int32 Count)
+	{
+		TArray<int32> Sizes;
+		Sizes.SetNumZeroed(Groups.Num());
+
+		double TotalShare = 0.0;
+		for (const FAgentDemographicRow* Group : Groups)
+		{
+			TotalShare += FMath::Max(Group->SpawnPercentage, 0.f);
+		}
+		if (TotalShare <= 0.0 || Count <= 0) return Sizes;
+
+		// Whole agents first, then one more for the largest remainders until Count is reached
+		TArray<TPair<double, int32>> Remainders;
+		int32 Assigned = 0;
+		for (int32 i = 0; i < Groups.Num(); ++i)
+		{
+			const double Exact = Count * FMath::Max(Groups[i]->SpawnPercentage, 0.f) / TotalShare;
+			Sizes[i] = FMath::FloorToInt32(Exact);
+			Assigned += Sizes[i];
+			Remainders.Emplace(Exact - Sizes[i], i);
+		}
+
+		// Stable, so equal remainders go to the earlier row
+		Remainders.StableSort([](const TPair<double, int32>& A, const TPair<double, int32>& B) { return A.Key > B.Key; });
+		for (int32 i = 0; Assigned < Count; ++i, ++Assigned)
+		{
+			Sizes[Remainders[i % Remainders.Num()].Value]++;
+		}
+		return Sizes;
+	}
+
+	void Generate(const UDataTable& Table, int32 Count, FRandomStream& Stream, TArray<FAgentProfile>& OutProfiles)
+	{
+		OutProfiles.Reset(Count);
+
+		TArray<FName> Names;
+		TArray<const FAgentDemographicRow*> Groups;
+		Table.ForeachRow<FAgentDemographicRow>(TEXT("PopulationGenerator"), [&Names, &Groups](const FName& Name, const FAgentDemographicRow& Row)
+		{
+			Names.Add(Name);
+			Groups.Add(&Row);
+		});
+
+		const TArray<int32> Sizes = AllocateGroups(Groups, Count);
+		for (int32 g = 0; g < Groups.Num(); ++g)
+		{
+			const FAgentDemographicRow& Group = *Groups[g];
+			for (int32 i = 0; i < Sizes[g]; ++i)
+			{
+				FAgentProfile& Profile = OutProfiles.AddDefaulted_GetRef();
+				Profile.Demographics.Group = Names[g];
+				Profile.Demographics.bMale = Group.bMale;
+				Profile.Demographics.bMobilityImpaired = Group.bMobilityImpaired;
+				Profile.Demographics.Age = Stream.RandRange(Group.AgeMin, FMath::Max(Group.AgeMin, Group.AgeMax));
+				Profile.Demographics.Awareness = FMath::Lerp(Group.AwarenessMin, FMath::Max(Group.AwarenessMin, Group.AwarenessMax), Stream.GetFraction());
+
+				const float SpeedFraction = Stream.GetFraction();
+				Profile.WalkSpeedOnFlat = FMath::Lerp(Group.WalkSpeedOnFlatMin, Group.WalkSpeedOnFlatMax, SpeedFraction);
+				Profile.WalkSpeedOnStairs = FMath::Lerp(Group.WalkSpeedOnStairsMin, Group.WalkSpeedOnStairsMax, SpeedFraction);
+				Profile.Material = Group.Material;
+			}
+		}
+
+		// Fisher-Yates
+		for (int32 i = OutProfiles.Num() - 1; i > 0; --i)
+		{
+			OutProfiles.Swap(i, Stream.RandRange(0, i));
+		}
+	}
+}
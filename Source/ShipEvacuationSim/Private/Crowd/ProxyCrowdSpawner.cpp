@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/ProxyCrowdSpawner.h"
+#include "Crowd/PopulationGenerator.h"
+#include "Crowd/ProxyCrowdSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "SimulationInstance.h"
+#include "Components/BoxComponent.h"
+#include "Misc/Crc.h"
+
+AProxyCrowdSpawner::AProxyCrowdSpawner()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SpawnArea = CreateDefaultSubobject<UBoxComponent>(TEXT("SpawnArea"));
+	SetRootComponent(SpawnArea);
+	SpawnArea->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SpawnArea->SetCanEverAffectNavigation(false);
+	SpawnArea->SetBoxExtent(FVector(500.f, 500.f, 200.f));
+}
+
+void AProxyCrowdSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	if (NavMeta && !NavMeta->IsBaked())
+	{
+		// Cells are the only places proxies can stand
+		BakedHandle = NavMeta->OnBaked.AddUObject(this, &AProxyCrowdSpawner::SpawnAgents);
+		return;
+	}
+
+	SpawnAgents();
+}
+
+void AProxyCrowdSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProxyCrowdSpawner::SpawnAgents()
+{
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+	BakedHandle.Reset();
+
+	const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+	if (GameInstance && GameInstance->IsReplaying()) return;
+
+	UProxyCrowdSubsystem* Proxies = GetWorld()->GetSubsystem<UProxyCrowdSubsystem>();
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	if (!Proxies || !NavMeta || !NavMeta->IsBaked()) return;
+
+	TArray<int32> Cells;
+	NavMeta->ForEachCellInBox(SpawnArea->Bounds.GetBox(), [&Cells](int32 Cell) { Cells.Add(Cell); });
+	if (Cells.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: no navigation metadata cells in the spawn area."), *GetName());
+		return;
+	}
+
+	// Same seeding as AAgentSpawner: stable across runs and worker processes
+	const int32 RunSeed = GameInstance ? GameInstance->BatchSettings.Seed + GameInstance->PersistentRunIndex : 0;
+	FRandomStream Stream(int32(HashCombine(GetTypeHash(RunSeed), FCrc::StrCrc32(*GetName()))));
+
+	TArray<FAgentProfile> Profiles;
+	if (Demographics && Demographics->GetRowStruct() == FAgentDemographicRow::StaticStruct())
+	{
+		PopulationGenerator::Generate(*Demographics, NumAgents, Stream, Profiles);
+	}
+
+	const float HalfCell = NavMeta->CellSize * 0.5f;
+	for (int32 i = 0; i < NumAgents; ++i)
+	{
+		const FVector CellLocation = NavMeta->GetCellLocation(Cells[Stream.RandHelper(Cells.Num())]);
+		const FVector Location = CellLocation + FVector(Stream.FRandRange(-HalfCell, HalfCell), Stream.FRandRange(-HalfCell, HalfCell), 0.f);
+		const bool bOfficer = Stream.FRand() < OfficerRatio;
+
+		if (Profiles.IsValidIndex(i))
+		{
+			Proxies->SpawnAgent(Location, Profiles[i].WalkSpeedOnFlat, Profiles[i].WalkSpeedOnStairs, bOfficer, Profiles[i].Demographics.Awareness);
+		}
+		else
+		{
+			const float SpeedScale = 1.f + Stream.FRandRange(-SpeedVariation, SpeedVariation);
+			Proxies->SpawnAgent(Location, WalkSpeedOnFlat * SpeedScale, WalkSpeedOnStairs * SpeedScale, bOfficer);
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("%s: spawned %d proxy agents on %d cells."), *GetName(), NumAgents, Cells.Num());
+}
+
+void AProxyCrowdSpawner::ResetForNewRun_Implementation()
+{
+	SpawnAgents();
+}
@@ -0,0 +1,411 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Crowd/ProxyCrowdSubsystem.h"
+#include "Crowd/CrowdKernels.h"
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Logging/SimulationLogSubsystem.h"
+#include "Navigation/FlowFieldSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Materials/MaterialInterface.h"
+
+namespace ProxyCrowd
+{
+	// Thresholds from AAiCharacter::CheckIfStuck, ShrinkCapsule and ApplyRecoveryStep
+	static constexpr float StuckCheckInterval = 2.75f;
+	static constexpr float StuckMoveDistance = 5.f;
+	static constexpr float StuckTimeStep = 0.3f;
+	static constexpr float StuckTime = 2.f;
+	static constexpr float ShrinkScale = 0.7f;
+	static constexpr float ShrinkDuration = 2.f;
+	static constexpr float RecoverySpeed = 2.f;
+	static constexpr float RecoveredDistanceSquared = 100.f;
+
+	// Off the grid but within this of a cell is a gap at a wall, not an agent lost off the navmesh
+	static constexpr float OffNavMeshReach = 500.f;
+}
+
+void FProxyAgents::Reset()
+{
+	Location.Reset();
+	Velocity.Reset();
+	WalkSpeedOnFlat.Reset();
+	WalkSpeedOnStairs.Reset();
+	Radius.Reset();
+	Goal.Reset();
+	State.Reset();
+	bOfficer.Reset();
+	ResponseTime.Reset();
+	LastMoveLocation.Reset();
+	TimeSinceLastMove.Reset();
+	NextStuckCheck.Reset();
+	RestoreRadiusTime.Reset();
+	RecoveryTarget.Reset();
+}
+
+bool UProxyCrowdSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProxyCrowdSubsystem::Deinitialize()
+{
+	Agents.Reset();
+	Store.Reset();
+	Instances = nullptr;
+
+	Super::Deinitialize();
+}
+
+TStatId UProxyCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProxyCrowdSubsystem, STATGROUP_Tickables);
+}
+
+// Agents
+int32 UProxyCrowdSubsystem::SpawnAgent(const FVector& Location, float WalkSpeedOnFlat, float WalkSpeedOnStairs, bool bOfficer, float ResponseDelay)
+{
+	EnsureInstances();
+
+	const double ResponseTime = GetWorld()->GetTimeSeconds() + FMath::Max(ResponseDelay, 0.f);
+
+	const int32 Agent = Agents.Num();
+	Agents.Location.Add(Location);
+	Agents.Velocity.Add(FVector::ZeroVector);
+	Agents.WalkSpeedOnFlat.Add(WalkSpeedOnFlat);
+	Agents.WalkSpeedOnStairs.Add(WalkSpeedOnStairs);
+	Agents.Radius.Add(AgentRadius);
+	Agents.Goal.Add(INDEX_NONE);
+	Agents.State.Add(ETrajectoryAgentState::None);
+	Agents.bOfficer.Add(bOfficer ? 1 : 0);
+	Agents.ResponseTime.Add(ResponseTime);
+	Agents.LastMoveLocation.Add(Location);
+	Agents.TimeSinceLastMove.Add(0.f);
+	Agents.RestoreRadiusTime.Add(0.0);
+	Agents.RecoveryTarget.Add(Location);
+
+	// Random phase so checks spread over frames, like the randomised actor timers; waiting is not being stuck
+	Agents.NextStuckCheck.Add(ResponseTime + FMath::FRandRange(2.0f, 3.5f));
+
+	if (Instances)
+	{
+		const int32 Instance = Instances->AddInstance(FTransform(Location), true);
+		Instances->SetCustomDataValue(Instance, 1, bOfficer ? 1.f : 0.f, true);
+	}
+	return Agent;
+}
+
+void UProxyCrowdSubsystem::ResetAgents()
+{
+	Agents.Reset();
+	NumMustered = 0;
+
+	if (Instances)
+	{
+		Instances->ClearInstances();
+	}
+}
+
+void UProxyCrowdSubsystem::EnsureInstances()
+{
+	if (Instances) return;
+
+	UStaticMesh* Mesh = Cast<UStaticMesh>(AgentMesh.TryLoad());
+	if (!Mesh)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ProxyCrowd: could not load %s, agents will not be drawn"), *AgentMesh.ToString());
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	AActor* Owner = GetWorld()->SpawnActor<AActor>(SpawnParams);
+	if (!Owner) return;
+
+	Instances = NewObject<UInstancedStaticMeshComponent>(Owner, TEXT("ProxyAgents"));
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->NumCustomDataFloats = 2;
+	Instances->SetStaticMesh(Mesh);
+	if (UMaterialInterface* Material = Cast<UMaterialInterface>(AgentMaterial.TryLoad()))
+	{
+		Instances->SetMaterial(0, Material);
+	}
+
+	Owner->SetRootComponent(Instances);
+	Instances->RegisterComponent();
+}
+
+// Tick
+void UProxyCrowdSubsystem::Tick(float DeltaTime)
+{
+	if (NumMustered < Agents.Num())
+	{
+		Step(DeltaTime);
+		HandleEvents();
+	}
+
+	UpdateInstances();
+}
+
+void UProxyCrowdSubsystem::Step(float DeltaTime)
+{
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	const UFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UFlowFieldSubsystem>();
+	Events.Reset();
+	if (!NavMeta || !NavMeta->IsBaked()) return;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Same store and kernel as the actor crowd; every moving agent is active every frame
+	Store.Reset();
+	Store.Reserve(Agents.Num());
+	for (int32 i = 0; i < Agents.Num(); ++i)
+	{
+		const bool bMoving = !EnumHasAnyFlags(Agents.State[i], ETrajectoryAgentState::Mustered | ETrajectoryAgentState::Recovering) && Now >= Agents.ResponseTime[i];
+		Store.Add(Agents.Location[i], Agents.Velocity[i], Agents.Radius[i], bMoving ? EAgentStateFlags::Active : EAgentStateFlags::None, i);
+	}
+	Store.BuildCells(RepulsionRadius);
+
+	CrowdKernels::FRepulsionParams Params;
+	Params.Radius = RepulsionRadius;
+
+	Repulsion.SetNumUninitialized(Store.Num(), EAllowShrinking::No);
+	Events.SetNumZeroed(Agents.Num());
+
+	const int32 BlockSize = FMath::Max(BatchSize, 1);
+	const int32 NumBlocks = FMath::DivideAndRoundUp(Store.Num(), BlockSize);
+
+	ParallelFor(TEXT("ProxyCrowdStep"), NumBlocks, 1, [this, &Params, BlockSize, DeltaTime, Now, NavMeta, FlowField](int32 Block)
+	{
+		const int32 Begin = Block * BlockSize;
+		const int32 End = FMath::Min(Begin + BlockSize, Store.Num());
+
+		CrowdKernels::ComputeRepulsion(Store, Params, Begin, End, Repulsion.GetData());
+
+		for (int32 s = Begin; s < End; ++s)
+		{
+			const int32 i = Store.SourceIndex[s];
+			ETrajectoryAgentState& State = Agents.State[i];
+			FVector& Location = Agents.Location[i];
+			FVector& Velocity = Agents.Velocity[i];
+			uint8& Event = Events[i];
+
+			if (EnumHasAnyFlags(State, ETrajectoryAgentState::Mustered) || Now < Agents.ResponseTime[i]) continue;
+
+			if (EnumHasAnyFlags(State, ETrajectoryAgentState::Recovering))
+			{
+				Location = FMath::VInterpTo(Location, Agents.RecoveryTarget[i], DeltaTime, ProxyCrowd::RecoverySpeed);
+				if (FVector::DistSquared(Location, Agents.RecoveryTarget[i]) < ProxyCrowd::RecoveredDistanceSquared)
+				{
+					Location = Agents.RecoveryTarget[i];
+					State &= ~ETrajectoryAgentState::Recovering;
+					Event |= Event_Recovered | Event_StateChanged;
+				}
+				continue;
+			}
+
+			const int32 Cell = NavMeta->FindCellIndex(Location);
+			if (Cell == INDEX_NONE)
+			{
+				Velocity = FVector::ZeroVector;
+				Event |= Event_OffGrid;
+				continue;
+			}
+
+			FNavMetadataSample Sample;
+			NavMeta->GetCellSample(Cell, Sample);
+
+			if (Agents.Goal[i] == INDEX_NONE && FlowField)
+			{
+				Agents.Goal[i] = FlowField->FindNearestGoal(Location);
+			}
+
+			// Steering as in UCrowdUpdateSubsystem for flow field agents
+			FVector FlowDirection = FVector::ZeroVector;
+			if (FlowField && Agents.Goal[i] != INDEX_NONE)
+			{
+				FlowField->SampleDirection(Agents.Goal[i], Location, FlowDirection);
+			}
+
+			const FVector RepulsionForce = FVector(Repulsion[s]).GetClampedToMaxSize(1.0f);
+			const float Speed = Sample.bStairs ? Agents.WalkSpeedOnStairs[i] : Agents.WalkSpeedOnFlat[i];
+			const FVector Desired = (FlowDirection + RepulsionForce * 2.0f).GetSafeNormal2D() * (FlowDirection.IsZero() ? 0.f : Speed);
+			Velocity += (Desired - Velocity) * FMath::Min(1.f, Acceleration * DeltaTime);
+
+			// Walls are the edges of the grid: take the full step, else slide along one axis, else stop
+			const FVector Move = Velocity * DeltaTime;
+			const FVector Candidates[] = { Move, FVector(Move.X, 0.f, 0.f), FVector(0.f, Move.Y, 0.f) };
+			int32 NewCell = INDEX_NONE;
+			for (const FVector& Candidate : Candidates)
+			{
+				NewCell = NavMeta->FindCellIndex(Location + Candidate);
+				if (NewCell != INDEX_NONE)
+				{
+					Location += Candidate;
+					break;
+				}
+			}
+
+			if (NewCell == INDEX_NONE)
+			{
+				Velocity = FVector::ZeroVector;
+			}
+			else
+			{
+				Location.Z = NavMeta->GetCellLocation(NewCell).Z;
+				NavMeta->GetCellSample(NewCell, Sample);
+			}
+
+			const ETrajectoryAgentState PreviousState = State;
+			if (Sample.bStairs) State |= ETrajectoryAgentState::OnStairs;
+			else State &= ~ETrajectoryAgentState::OnStairs;
+
+			// Stuck detection and the capsule shrink it triggers
+			if (EnumHasAnyFlags(State, ETrajectoryAgentState::Stuck) && Now >= Agents.RestoreRadiusTime[i])
+			{
+				State &= ~ETrajectoryAgentState::Stuck;
+				Agents.Radius[i] = AgentRadius;
+				Agents.TimeSinceLastMove[i] = 0.f;
+			}
+
+			if (Now >= Agents.NextStuckCheck[i])
+			{
+				Agents.NextStuckCheck[i] += ProxyCrowd::StuckCheckInterval;
+
+				if (FVector::Dist(Location, Agents.LastMoveLocation[i]) < ProxyCrowd::StuckMoveDistance)
+				{
+					Agents.TimeSinceLastMove[i] += ProxyCrowd::StuckTimeStep;
+				}
+				else
+				{
+					Agents.TimeSinceLastMove[i] = 0.f;
+					Agents.LastMoveLocation[i] = Location;
+					Event |= Event_Progress;
+				}
+
+				if (Agents.TimeSinceLastMove[i] > ProxyCrowd::StuckTime && !EnumHasAnyFlags(State, ETrajectoryAgentState::Stuck))
+				{
+					State |= ETrajectoryAgentState::Stuck;
+					Agents.Radius[i] = AgentRadius * ProxyCrowd::ShrinkScale;
+					Agents.RestoreRadiusTime[i] = Now + ProxyCrowd::ShrinkDuration;
+					Event |= Event_Stuck;
+				}
+			}
+
+			// Standing on one of the station's own cells
+			if (FlowField && Agents.Goal[i] != INDEX_NONE && FlowField->GetCostToGo(Agents.Goal[i], Location) == 0.f)
+			{
+				State = ETrajectoryAgentState::Mustered;
+				Velocity = FVector::ZeroVector;
+				Event |= Event_Mustered;
+			}
+
+			if (State != PreviousState)
+			{
+				Event |= Event_StateChanged;
+			}
+		}
+	});
+}
+
+void UProxyCrowdSubsystem::HandleEvents()
+{
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	bool bProgress = false;
+
+	for (int32 i = 0; i < Events.Num(); ++i)
+	{
+		const uint8 Event = Events[i];
+		if (Event == Event_None) continue;
+
+		if (Event & Event_OffGrid)
+		{
+			// A gap at a wall is closed quietly; further away the agent is lost as on AAiCharacter
+			int32 Cell = FindNearbyCell(Agents.Location[i], NavMeta->CellSize * 2.f);
+			if (Cell == INDEX_NONE)
+			{
+				LogEvent(i, EAgentLogEvent::OffNavMesh);
+				Cell = FindNearbyCell(Agents.Location[i], ProxyCrowd::OffNavMeshReach);
+			}
+
+			if (Cell != INDEX_NONE)
+			{
+				Agents.RecoveryTarget[i] = NavMeta->GetCellLocation(Cell);
+				Agents.State[i] |= ETrajectoryAgentState::Recovering;
+				Events[i] |= Event_StateChanged;
+			}
+		}
+
+		if (Event & Event_Stuck) LogEvent(i, EAgentLogEvent::Stuck);
+		if (Event & Event_Recovered) LogEvent(i, EAgentLogEvent::Recovered);
+		if (Event & Event_Mustered)
+		{
+			LogEvent(i, EAgentLogEvent::Mustered);
+			NumMustered++;
+			bProgress = true;
+		}
+
+		bProgress |= (Event & Event_Progress) != 0;
+
+		if (Instances && (Events[i] & Event_StateChanged))
+		{
+			Instances->SetCustomDataValue(i, 0, float(uint8(Agents.State[i])), false);
+		}
+	}
+
+	if (bProgress)
+	{
+		if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+		{
+			Crowd->NotifyAgentProgress();
+		}
+	}
+}
+
+void UProxyCrowdSubsystem::UpdateInstances()
+{
+	if (!Instances || Agents.Num() == 0 || Instances->GetInstanceCount() != Agents.Num()) return;
+
+	Transforms.SetNum(Agents.Num(), EAllowShrinking::No);
+	ParallelFor(Agents.Num(), [this](int32 i)
+	{
+		const FVector& Velocity = Agents.Velocity[i];
+		const FRotator Facing = Velocity.SizeSquared2D() > 1.f ? FRotator(0.f, Velocity.Rotation().Yaw, 0.f) : Transforms[i].Rotator();
+		Transforms[i] = FTransform(Facing, Agents.Location[i]);
+	});
+
+	Instances->BatchUpdateInstancesTransforms(0, Transforms, true, true, true);
+}
+
+int32 UProxyCrowdSubsystem::FindNearbyCell(const FVector& Location, float Reach) const
+{
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+	const FVector Extent(Reach, Reach, NavMeta->MaxLayerDistance);
+
+	int32 Best = INDEX_NONE;
+	double BestDistance = MAX_dbl;
+	NavMeta->ForEachCellInBox(FBox(Location - Extent, Location + Extent), [NavMeta, &Location, &Best, &BestDistance](int32 Cell)
+	{
+		const double Distance = FVector::DistSquared(NavMeta->GetCellLocation(Cell), Location);
+		if (Distance < BestDistance)
+		{
+			Best = Cell;
+			BestDistance = Distance;
+		}
+	});
+	return Best;
+}
+
+void UProxyCrowdSubsystem::LogEvent(int32 Agent, EAgentLogEvent Event) const
+{
+	if (USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>())
+	{
+		Log->LogAgentEventById(FirstAgentId + Agent, Event);
+	}
+}
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Logging/RunLogFile.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+// Writer
+FRunLogWriter::~FRunLogWriter()
+{
+	Close();
+}
+
+bool FRunLogWriter::Open(const FString& FilePath)
+{
+	Close();
+
+	Archive.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Archive.IsValid())
+	{
+		return false;
+	}
+
+	uint32 Magic = RunLogFile::Magic;
+	uint32 Version = RunLogFile::Version;
+	*Archive << Magic << Version;
+	return true;
+}
+
+void FRunLogWriter::Close()
+{
+	if (Archive.IsValid())
+	{
+		Archive->Close();
+		Archive.Reset();
+	}
+}
+
+void FRunLogWriter::WriteTable(int32 TableId, const FRunLogTable& Table)
+{
+	if (!Archive.IsValid()) return;
+
+	uint8 Chunk = uint8(RunLogFile::EChunk::Table);
+	FString Name = Table.Name;
+	int32 NumColumns = Table.Columns.Num();
+	*Archive << Chunk << TableId << Name << NumColumns;
+
+	for (const FRunLogColumn& Column : Table.Columns)
+	{
+		FString ColumnName = Column.Name;
+		uint8 Type = uint8(Column.Type);
+		*Archive << ColumnName << Type;
+	}
+}
+
+void FRunLogWriter::WriteRows(int32 TableId, const FRunLogTable& Table, const TArray<TArray<double>>& Columns)
+{
+	if (!Archive.IsValid() || Columns.Num() == 0) return;
+
+	uint8 Chunk = uint8(RunLogFile::EChunk::Rows);
+	int32 NumRows = Columns[0].Num();
+	if (NumRows == 0) return;
+
+	*Archive << Chunk << TableId << NumRows;
+
+	// Narrow each column to its declared type and write it as one contiguous block
+	for (int32 c = 0; c < Table.Columns.Num(); ++c)
+	{
+		const TArray<double>& Values = Columns[c];
+		switch (Table.Columns[c].Type)
+		{
+		case ERunLogColumnType::Int32:
+			{
+				TArray<int32> Block;
+				Block.SetNumUninitialized(NumRows);
+				for (int32 r = 0; r < NumRows; ++r) Block[r] = int32(Values[r]);
+				Archive->Serialize(Block.GetData(), Block.Num() * sizeof(int32));
+				break;
+			}
+		case ERunLogColumnType::Int64:
+			{
+				TArray<int64> Block;
+				Block.SetNumUninitialized(NumRows);
+				for (int32 r = 0; r < NumRows; ++r) Block[r] = int64(Values[r]);
+				Archive->Serialize(Block.GetData(), Block.Num() * sizeof(int64));
+				break;
+			}
+		case ERunLogColumnType::Float:
+			{
+				TArray<float> Block;
+				Block.SetNumUninitialized(NumRows);
+				for (int32 r = 0; r < NumRows; ++r) Block[r] = float(Values[r]);
+				Archive->Serialize(Block.GetData(), Block.Num() * sizeof(float));
+				break;
+			}
+		case ERunLogColumnType::Double:
+			{
+				TArray<double> Block;
+				Block.SetNumUninitialized(NumRows);
+				for (int32 r = 0; r < NumRows; ++r) Block[r] = Values[r];
+				Archive->Serialize(Block.GetData(), Block.Num() * sizeof(double));
+				break;
+			}
+		}
+	}
+}
+
+void FRunLogWriter::WriteSummary(const TArray<TPair<FString, FString>>& Summary)
+{
+	if (!Archive.IsValid()) return;
+
+	uint8 Chunk = uint8(RunLogFile::EChunk::Summary);
+	int32 Count = Summary.Num();
+	*Archive << Chunk << Count;
+
+	for (const TPair<FString, FString>& Pair : Summary)
+	{
+		FString Key = Pair.Key;
+		FString Value = Pair.Value;
+		*Archive << Key << Value;
+	}
+}
+
+void FRunLogWriter::Flush()
+{
+	if (Archive.IsValid())
+	{
+		Archive->Flush();
+	}
+}
+
+// Reader
+bool FRunLogReader::Load(const FString& FilePath)
+{
+	Tables.Reset();
+	Data.Reset();
+	Summary.Reset();
+
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Archive.IsValid())
+	{
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Archive << Magic << Version;
+	if (Magic != RunLogFile::Magic || Version != RunLogFile::Version)
+	{
+		return false;
+	}
+
+	while (!Archive->AtEnd() && !Archive->IsError())
+	{
+		uint8 Chunk = 0;
+		*Archive << Chunk;
+
+		if (Chunk == uint8(RunLogFile::EChunk::Table))
+		{
+			int32 TableId = 0;
+			FRunLogTable Table;
+			int32 NumColumns = 0;
+			*Archive << TableId << Table.Name << NumColumns;
+			if (Archive->IsError() || TableId < 0 || TableId > 1024 || NumColumns < 0 || NumColumns > RunLogFile::MaxColumns) break;
+
+			bool bValid = true;
+			for (int32 c = 0; c < NumColumns && bValid; ++c)
+			{
+				FRunLogColumn& Column = Table.Columns.AddDefaulted_GetRef();
+				uint8 Type = 0;
+				*Archive << Column.Name << Type;
+				Column.Type = ERunLogColumnType(Type);
+				bValid = !Archive->IsError() && Type <= uint8(ERunLogColumnType::Double);
+			}
+			if (!bValid) break;
+
+			if (Tables.Num() <= TableId)
+			{
+				Tables.SetNum(TableId + 1);
+				Data.SetNum(TableId + 1);
+			}
+			Data[TableId].SetNum(NumColumns);
+			Tables[TableId] = MoveTemp(Table);
+		}
+		else if (Chunk == uint8(RunLogFile::EChunk::Rows))
+		{
+			int32 TableId = 0;
+			int32 NumRows = 0;
+			*Archive << TableId << NumRows;
+			if (Archive->IsError() || !Tables.IsValidIndex(TableId) || NumRows < 0) break;
+
+			// A corrupt row count must not turn into a huge allocation
+			const FRunLogTable& Table = Tables[TableId];
+			int64 RowSize = 0;
+			for (const FRunLogColumn& Column : Table.Columns)
+			{
+				RowSize += RunLogFile::GetTypeSize(Column.Type);
+			}
+			if (int64(NumRows) * RowSize > Archive->TotalSize() - Archive->Tell()) break;
+
+			const int32 PreviousRows = GetNumRows(TableId);
+			for (int32 c = 0; c < Table.Columns.Num(); ++c)
+			{
+				TArray<double>& Column = Data[TableId][c];
+				const int32 Offset = Column.AddUninitialized(NumRows);
+
+				for (int32 r = 0; r < NumRows; ++r)
+				{
+					switch (Table.Columns[c].Type)
+					{
+					case ERunLogColumnType::Int32:	{ int32 V;  *Archive << V; Column[Offset + r] = V; break; }
+					case ERunLogColumnType::Int64:	{ int64 V;  *Archive << V; Column[Offset + r] = double(V); break; }
+					case ERunLogColumnType::Float:	{ float V;  *Archive << V; Column[Offset + r] = V; break; }
+					case ERunLogColumnType::Double:	{ double V; *Archive << V; Column[Offset + r] = V; break; }
+					}
+				}
+			}
+
+			// A block cut short is dropped whole, so every column keeps the same rows
+			if (Archive->IsError())
+			{
+				for (TArray<double>& Column : Data[TableId])
+				{
+					Column.SetNum(PreviousRows);
+				}
+				break;
+			}
+		}
+		else if (Chunk == uint8(RunLogFile::EChunk::Summary))
+		{
+			int32 Count = 0;
+			*Archive << Count;
+			for (int32 i = 0; i < Count && !Archive->IsError(); ++i)
+			{
+				FString Key;
+				FString Value;
+				*Archive << Key << Value;
+				if (!Archive->IsError())
+				{
+					Summary.Emplace(MoveTemp(Key), MoveTemp(Value));
+				}
+			}
+		}
+		else
+		{
+			// Truncated or corrupt tail; keep what was read so far
+			break;
+		}
+	}
+
+	return true;
+}
+
+int32 FRunLogReader::FindTable(const FString& Name) const
+{
+	return Tables.IndexOfByPredicate([&Name](const FRunLogTable& Table) { return Table.Name == Name; });
+}
+
+int32 FRunLogReader::GetNumRows(int32 TableId) const
+{
+	return Data.IsValidIndex(TableId) && Data[TableId].Num() > 0 ? Data[TableId][0].Num() : 0;
+}
+
+double FRunLogReader::GetValue(int32 TableId, int32 Column, int32 Row) const
+{
+	return Data[TableId][Column][Row];
+}
+
+const FString* FRunLogReader::FindSummary(const FString& Key) const
+{
+	const TPair<FString, FString>* Pair = Summary.FindByPredicate([&Key](const TPair<FString, FString>& Entry) { return Entry.Key == Key; });
+	return Pair ? &Pair->Value : nullptr;
+}
+
+FString FRunLogReader::TableToCsv(int32 TableId) const
+{
+	const FRunLogTable& Table = Tables[TableId];
+
+	TArray<FString> Header;
+	for (const FRunLogColumn& Column : Table.Columns)
+	{
+		Header.Add(Column.Name);
+	}
+
+	FString Csv = FString::Join(Header, TEXT(",")) + TEXT("\n");
+
+	const int32 NumRows = GetNumRows(TableId);
+	for (int32 r = 0; r < NumRows; ++r)
+	{
+		for (int32 c = 0; c < Table.Columns.Num(); ++c)
+		{
+			if (c > 0) Csv += TEXT(",");
+
+			const double Value = Data[TableId][c][r];
+			Csv += RunLogFile::IsIntegerType(Table.Columns[c].Type)
+				? FString::Printf(TEXT("%lld"), int64(Value))
+				: FString::Printf(TEXT("%.3f"), Value);
+		}
+		Csv += TEXT("\n");
+	}
+
+	return Csv;
+}
+
+FString FRunLogReader::SummaryToCsv() const
+{
+	FString Csv = TEXT("Key,Value\n");
+	for (const TPair<FString, FString>& Pair : Summary)
+	{
+		Csv += Pair.Key + TEXT(",") + Pair.Value + TEXT("\n");
+	}
+	return Csv;
+}
+
+bool FRunLogReader::ExportCsv(const FString& Directory, const FString& BaseName) const
+{
+	bool bOk = true;
+
+	for (int32 TableId = 0; TableId < Tables.Num(); ++TableId)
+	{
+		const FString FileName = TableId == 0
+			? BaseName + TEXT(".csv")
+			: FString::Printf(TEXT("%s_%s.csv"), *BaseName, *Tables[TableId].Name);
+		bOk &= FFileHelper::SaveStringToFile(TableToCsv(TableId), *FPaths::Combine(Directory, FileName));
+	}
+
+	bOk &= FFileHelper::SaveStringToFile(SummaryToCsv(), *FPaths::Combine(Directory, BaseName + TEXT("_Summary.csv")));
+	return bOk;
+}
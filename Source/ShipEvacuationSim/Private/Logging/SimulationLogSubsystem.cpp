@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Logging/SimulationLogSubsystem.h"
+#include "Logging/RunLogFile.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "TimerManager.h"
+
+void USimulationLogSubsystem::Deinitialize()
+{
+	EndRun();
+
+	// The last run's CSVs must be on disk before the process exits
+	ExportTask.Wait();
+	Super::Deinitialize();
+}
+
+void USimulationLogSubsystem::BeginRun(const FString& Directory, int32 RunIndex)
+{
+	EndRun();
+
+	RunDirectory = Directory;
+	RunBaseName = FString::Printf(TEXT("Run_%d"), RunIndex);
+	RunLogPath = FPaths::Combine(RunDirectory, RunBaseName + TEXT(".simlog"));
+	RunStartTime = GetWorld()->GetTimeSeconds();
+	ZoneIds.Reset();
+
+	IFileManager::Get().MakeDirectory(*RunDirectory, true);
+
+	Logger = MakeUnique<FSimulationRunLogger>();
+
+	// The first table is the one exported as Run_N.csv
+	ProgressTable = Logger->DefineTable(TEXT("Progress"), {
+		{ TEXT("Time"), ERunLogColumnType::Double },
+		{ TEXT("AgentsMustered"), ERunLogColumnType::Int32 },
+		{ TEXT("AgentsActive"), ERunLogColumnType::Int32 },
+	});
+
+	ZoneTable = Logger->DefineTable(TEXT("ZoneDensity"), {
+		{ TEXT("Time"), ERunLogColumnType::Double },
+		{ TEXT("Zone"), ERunLogColumnType::Int32 },
+		{ TEXT("Agents"), ERunLogColumnType::Int32 },
+		{ TEXT("AreaUsage"), ERunLogColumnType::Float },
+		{ TEXT("SlowRatio"), ERunLogColumnType::Float },
+		{ TEXT("Congested"), ERunLogColumnType::Int32 },
+	});
+
+	EventTable = Logger->DefineTable(TEXT("AgentEvents"), {
+		{ TEXT("Time"), ERunLogColumnType::Double },
+		{ TEXT("Agent"), ERunLogColumnType::Int32 },
+		{ TEXT("Event"), ERunLogColumnType::Int32 },
+	});
+
+	if (!Logger->Open(RunLogPath))
+	{
+		Logger.Reset();
+		return;
+	}
+
+	GetWorld()->GetTimerManager().SetTimer(FlushTimer, this, &USimulationLogSubsystem::Flush, FlushInterval, true);
+}
+
+void USimulationLogSubsystem::EndRun()
+{
+	if (!Logger.IsValid()) return;
+
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(FlushTimer);
+	}
+
+	if (Logger->GetNumStalls() > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("SimulationLogSubsystem: producer waited on a full buffer %d times."), Logger->GetNumStalls());
+	}
+
+	Logger->Close();
+	Logger.Reset();
+
+	if (bExportCsv)
+	{
+		// Reading back a large run log takes a while; exports run one after another off the game thread
+		ExportTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [LogPath = RunLogPath, Directory = RunDirectory, BaseName = RunBaseName]()
+		{
+			FRunLogReader Reader;
+			if (Reader.Load(LogPath))
+			{
+				Reader.ExportCsv(Directory, BaseName);
+			}
+		}, UE::Tasks::Prerequisites(ExportTask));
+	}
+}
+
+bool USimulationLogSubsystem::IsRunActive() const
+{
+	return Logger.IsValid();
+}
+
+double USimulationLogSubsystem::GetRunTime() const
+{
+	return GetWorld()->GetTimeSeconds() - RunStartTime;
+}
+
+int32 USimulationLogSubsystem::GetZoneId(const AActor* Zone)
+{
+	if (const int32* Existing = ZoneIds.Find(Zone))
+	{
+		return *Existing;
+	}
+
+	const int32 Id = ZoneIds.Num();
+	ZoneIds.Add(Zone, Id);
+	Logger->SetSummary(FString::Printf(TEXT("Zone_%d"), Id), Zone ? Zone->GetName() : TEXT("None"));
+	return Id;
+}
+
+void USimulationLogSubsystem::LogProgress(int32 AgentsMustered, int32 AgentsActive)
+{
+	if (!Logger.IsValid()) return;
+	Logger->AppendRow(ProgressTable, { GetRunTime(), double(AgentsMustered), double(AgentsActive) });
+}
+
+void USimulationLogSubsystem::LogZoneDensity(const AActor* Zone, int32 AgentCount, float AreaUsage, float SlowRatio, bool bCongested)
+{
+	if (!Logger.IsValid()) return;
+	Logger->AppendRow(ZoneTable, { GetRunTime(), double(GetZoneId(Zone)), double(AgentCount), AreaUsage, SlowRatio, bCongested ? 1.0 : 0.0 });
+}
+
+void USimulationLogSubsystem::LogAgentEvent(const AActor* Agent, EAgentLogEvent Event)
+{
+	if (!Agent) return;
+	LogAgentEventById(Agent->GetUniqueID(), Event);
+}
+
+void USimulationLogSubsystem::LogAgentEventById(int32 AgentId, EAgentLogEvent Event)
+{
+	if (!Logger.IsValid()) return;
+	Logger->AppendRow(EventTable, { GetRunTime(), double(AgentId), double(Event) });
+}
+
+void USimulationLogSubsystem::SetSummary(const FString& Key, const FString& Value)
+{
+	if (!Logger.IsValid()) return;
+	Logger->SetSummary(Key, Value);
+}
+
+void USimulationLogSubsystem::Flush()
+{
+	if (Logger.IsValid())
+	{
+		Logger->Flush();
+	}
+}
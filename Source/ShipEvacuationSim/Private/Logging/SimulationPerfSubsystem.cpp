@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Logging/SimulationLogSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+DEFINE_STAT(STAT_Sim_CrowdUpdate);
+DEFINE_STAT(STAT_Sim_AgentMovement);
+DEFINE_STAT(STAT_Sim_AgentTasks);
+DEFINE_STAT(STAT_Sim_ThrottledUpdate);
+DEFINE_STAT(STAT_Sim_StuckCheck);
+DEFINE_STAT(STAT_Sim_NavWidthEstimate);
+DEFINE_STAT(STAT_Sim_NavRecoveryCheck);
+DEFINE_STAT(STAT_Sim_NavQueryCallbacks);
+DEFINE_STAT(STAT_Sim_CongestionCheck);
+DEFINE_STAT(STAT_Sim_FireExpansion);
+DEFINE_STAT(STAT_Sim_NavUpdateSubmit);
+DEFINE_STAT(STAT_Sim_AgentSpawn);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents ticked"), STAT_Sim_AgentsTicked, STATGROUP_Simulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Overlaps queried"), STAT_Sim_OverlapsQueried, STATGROUP_Simulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nav queries"), STAT_Sim_NavQueries, STATGROUP_Simulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rebuilds requested"), STAT_Sim_RebuildsRequested, STATGROUP_Simulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents allocated"), STAT_Sim_AgentsAllocated, STATGROUP_Simulation);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Agents reused"), STAT_Sim_AgentsReused, STATGROUP_Simulation);
+
+UE_TRACE_CHANNEL_DEFINE(SimulationChannel);
+
+TRACE_DECLARE_INT_COUNTER(Sim_AgentsTicked, TEXT("Simulation/Agents ticked"));
+TRACE_DECLARE_INT_COUNTER(Sim_OverlapsQueried, TEXT("Simulation/Overlaps queried"));
+TRACE_DECLARE_INT_COUNTER(Sim_NavQueries, TEXT("Simulation/Nav queries"));
+TRACE_DECLARE_INT_COUNTER(Sim_RebuildsRequested, TEXT("Simulation/Rebuilds requested"));
+TRACE_DECLARE_INT_COUNTER(Sim_AgentsAllocated, TEXT("Simulation/Agents allocated"));
+TRACE_DECLARE_INT_COUNTER(Sim_AgentsReused, TEXT("Simulation/Agents reused"));
+
+namespace SimulationPerf
+{
+	// Run totals
+	static uint64 SystemCycles[int32(ESimPerfSystem::Num)] = {};
+	static int64 Counts[int32(ESimPerfCounter::Num)] = {};
+
+	static const TCHAR* SystemNames[] =
+	{
+		TEXT("CrowdUpdate"),
+		TEXT("AgentMovement"),
+		TEXT("AgentTasks"),
+		TEXT("ThrottledUpdate"),
+		TEXT("StuckCheck"),
+		TEXT("NavWidthEstimate"),
+		TEXT("NavRecoveryCheck"),
+		TEXT("NavQueryCallbacks"),
+		TEXT("CongestionCheck"),
+		TEXT("FireExpansion"),
+		TEXT("NavUpdateSubmit"),
+		TEXT("AgentSpawn"),
+	};
+	static_assert(UE_ARRAY_COUNT(SystemNames) == int32(ESimPerfSystem::Num), "One name per system");
+
+	static const TCHAR* CounterNames[] =
+	{
+		TEXT("AgentsTicked"),
+		TEXT("OverlapsQueried"),
+		TEXT("NavQueries"),
+		TEXT("RebuildsRequested"),
+		TEXT("AgentsAllocated"),
+		TEXT("AgentsReused"),
+	};
+	static_assert(UE_ARRAY_COUNT(CounterNames) == int32(ESimPerfCounter::Num), "One name per counter");
+
+	void AddCycles(ESimPerfSystem System, uint64 Cycles)
+	{
+		SystemCycles[int32(System)] += Cycles;
+	}
+
+	void AddCount(ESimPerfCounter Counter, int32 Amount)
+	{
+		Counts[int32(Counter)] += Amount;
+
+		switch (Counter)
+		{
+		case ESimPerfCounter::AgentsTicked:
+			INC_DWORD_STAT_BY(STAT_Sim_AgentsTicked, Amount);
+			TRACE_COUNTER_ADD(Sim_AgentsTicked, Amount);
+			break;
+		case ESimPerfCounter::OverlapsQueried:
+			INC_DWORD_STAT_BY(STAT_Sim_OverlapsQueried, Amount);
+			TRACE_COUNTER_ADD(Sim_OverlapsQueried, Amount);
+			break;
+		case ESimPerfCounter::NavQueries:
+			INC_DWORD_STAT_BY(STAT_Sim_NavQueries, Amount);
+			TRACE_COUNTER_ADD(Sim_NavQueries, Amount);
+			break;
+		case ESimPerfCounter::RebuildsRequested:
+			INC_DWORD_STAT_BY(STAT_Sim_RebuildsRequested, Amount);
+			TRACE_COUNTER_ADD(Sim_RebuildsRequested, Amount);
+			break;
+		case ESimPerfCounter::AgentsAllocated:
+			INC_DWORD_STAT_BY(STAT_Sim_AgentsAllocated, Amount);
+			TRACE_COUNTER_ADD(Sim_AgentsAllocated, Amount);
+			break;
+		case ESimPerfCounter::AgentsReused:
+			INC_DWORD_STAT_BY(STAT_Sim_AgentsReused, Amount);
+			TRACE_COUNTER_ADD(Sim_AgentsReused, Amount);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+bool USimulationPerfSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USimulationPerfSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldTickHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &USimulationPerfSubsystem::OnWorldTickStart);
+}
+
+void USimulationPerfSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(WorldTickHandle);
+	FrameMs.Empty();
+
+	Super::Deinitialize();
+}
+
+void USimulationPerfSubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime)
+{
+	if (World != GetWorld()) return;
+
+	// Wall time from the start of one world tick to the next covers the whole frame
+	const double Now = FPlatformTime::Seconds();
+	if (LastTickStart > 0.0)
+	{
+		FrameMs.Add(float((Now - LastTickStart) * 1000.0));
+	}
+	LastTickStart = Now;
+
+	// Insights shows the counters per frame
+	TRACE_COUNTER_SET(Sim_AgentsTicked, 0);
+	TRACE_COUNTER_SET(Sim_OverlapsQueried, 0);
+	TRACE_COUNTER_SET(Sim_NavQueries, 0);
+	TRACE_COUNTER_SET(Sim_RebuildsRequested, 0);
+	TRACE_COUNTER_SET(Sim_AgentsAllocated, 0);
+	TRACE_COUNTER_SET(Sim_AgentsReused, 0);
+}
+
+void USimulationPerfSubsystem::BeginRun()
+{
+	FrameMs.Reset();
+	LastTickStart = 0.0;
+
+	FMemory::Memzero(SimulationPerf::SystemCycles);
+	FMemory::Memzero(SimulationPerf::Counts);
+}
+
+float USimulationPerfSubsystem::GetFrameMsPercentile(float Percentile) const
+{
+	if (FrameMs.Num() == 0) return 0.f;
+
+	TArray<float> Sorted = FrameMs;
+	Sorted.Sort();
+
+	// Nearest rank
+	const int32 Rank = FMath::CeilToInt(FMath::Clamp(Percentile, 0.f, 100.f) / 100.f * Sorted.Num());
+	return Sorted[FMath::Clamp(Rank - 1, 0, Sorted.Num() - 1)];
+}
+
+void USimulationPerfSubsystem::WriteSummary(USimulationLogSubsystem& Log) const
+{
+	const int32 NumFrames = FrameMs.Num();
+
+	double TotalMs = 0.0;
+	float MaxMs = 0.f;
+	for (const float Ms : FrameMs)
+	{
+		TotalMs += Ms;
+		MaxMs = FMath::Max(MaxMs, Ms);
+	}
+
+	Log.SetSummary(TEXT("PerfFrames"), FString::FromInt(NumFrames));
+	Log.SetSummary(TEXT("PerfFrameMsMean"), FString::Printf(TEXT("%.3f"), NumFrames > 0 ? TotalMs / NumFrames : 0.0));
+	Log.SetSummary(TEXT("PerfFrameMsP95"), FString::Printf(TEXT("%.3f"), GetFrameMsPercentile(95.f)));
+	Log.SetSummary(TEXT("PerfFrameMsP99"), FString::Printf(TEXT("%.3f"), GetFrameMsPercentile(99.f)));
+	Log.SetSummary(TEXT("PerfFrameMsMax"), FString::Printf(TEXT("%.3f"), MaxMs));
+
+	// Process peak, so later runs in a batch report at least the earlier runs' peak
+	Log.SetSummary(TEXT("PerfPeakMemoryMB"), FString::Printf(TEXT("%.1f"), FPlatformMemory::GetStats().PeakUsedPhysical / (1024.0 * 1024.0)));
+
+	// Mean per frame, so runs of different length compare directly
+	for (int32 i = 0; i < int32(ESimPerfSystem::Num); ++i)
+	{
+		const double Ms = FPlatformTime::ToMilliseconds64(SimulationPerf::SystemCycles[i]);
+		Log.SetSummary(FString::Printf(TEXT("PerfMs%s"), SimulationPerf::SystemNames[i]),
+			FString::Printf(TEXT("%.4f"), NumFrames > 0 ? Ms / NumFrames : 0.0));
+	}
+
+	for (int32 i = 0; i < int32(ESimPerfCounter::Num); ++i)
+	{
+		Log.SetSummary(FString::Printf(TEXT("PerfCount%s"), SimulationPerf::CounterNames[i]), FString::Printf(TEXT("%lld"), SimulationPerf::Counts[i]));
+	}
+}
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Logging/SimulationRunLogger.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+FSimulationRunLogger::FSimulationRunLogger(uint32 RingCapacity)
+	: Queue(RingCapacity)
+{
+}
+
+FSimulationRunLogger::~FSimulationRunLogger()
+{
+	Close();
+}
+
+bool FSimulationRunLogger::Open(const FString& FilePath)
+{
+	Close();
+
+	if (!Writer.Open(FilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SimulationRunLogger: could not open %s"), *FilePath);
+		return false;
+	}
+
+	NumTablesWritten = 0;
+	Pending.Reset();
+	NumStalls = 0;
+	bStopping = false;
+
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("SimulationRunLogger"), 0, TPri_BelowNormal);
+	return Thread != nullptr;
+}
+
+void FSimulationRunLogger::Close()
+{
+	if (!Thread) return;
+
+	FRecord Record;
+	Record.TableId = Command_Close;
+	Enqueue(Record);
+
+	Stop();
+	Thread->WaitForCompletion();
+	delete Thread;
+	Thread = nullptr;
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+
+	FScopeLock ScopeLock(&Lock);
+	Tables.Reset();
+	Summary.Reset();
+}
+
+int32 FSimulationRunLogger::DefineTable(const FString& Name, const TArray<FRunLogColumn>& Columns)
+{
+	check(Columns.Num() <= RunLogFile::MaxColumns);
+
+	FScopeLock ScopeLock(&Lock);
+	FRunLogTable& Table = Tables.AddDefaulted_GetRef();
+	Table.Name = Name;
+	Table.Columns = Columns;
+	return Tables.Num() - 1;
+}
+
+void FSimulationRunLogger::AppendRow(int32 TableId, std::initializer_list<double> Values)
+{
+	if (!Thread) return;
+
+	FRecord Record;
+	Record.TableId = TableId;
+	for (const double Value : Values)
+	{
+		if (Record.NumValues == RunLogFile::MaxColumns) break;
+		Record.Values[Record.NumValues++] = Value;
+	}
+	Enqueue(Record);
+}
+
+void FSimulationRunLogger::SetSummary(const FString& Key, const FString& Value)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (TPair<FString, FString>* Existing = Summary.FindByPredicate([&Key](const TPair<FString, FString>& Pair) { return Pair.Key == Key; }))
+	{
+		Existing->Value = Value;
+	}
+	else
+	{
+		Summary.Emplace(Key, Value);
+	}
+}
+
+void FSimulationRunLogger::Flush()
+{
+	if (!Thread) return;
+
+	FRecord Record;
+	Record.TableId = Command_Flush;
+	Enqueue(Record);
+	WakeEvent->Trigger();
+}
+
+void FSimulationRunLogger::Enqueue(const FRecord& Record)
+{
+	// A full ring means the logger thread is behind; wake it and wait for space rather than drop rows
+	while (!Queue.Enqueue(Record))
+	{
+		NumStalls++;
+		WakeEvent->Trigger();
+		FPlatformProcess::Yield();
+	}
+}
+
+void FSimulationRunLogger::Stop()
+{
+	bStopping = true;
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+// Logger thread
+uint32 FSimulationRunLogger::Run()
+{
+	while (!bStopping)
+	{
+		WakeEvent->Wait(FTimespan::FromMilliseconds(100));
+		Drain();
+	}
+
+	Drain();
+	return 0;
+}
+
+void FSimulationRunLogger::Drain()
+{
+	FRecord Record;
+	while (Queue.Dequeue(Record))
+	{
+		if (Record.TableId == Command_Flush)
+		{
+			WritePending();
+			Writer.Flush();
+		}
+		else if (Record.TableId == Command_Close)
+		{
+			WritePending();
+
+			TArray<TPair<FString, FString>> SummaryCopy;
+			{
+				FScopeLock ScopeLock(&Lock);
+				SummaryCopy = Summary;
+			}
+			Writer.WriteSummary(SummaryCopy);
+			Writer.Close();
+		}
+		else if (Record.TableId >= 0)
+		{
+			if (Pending.Num() <= Record.TableId)
+			{
+				Pending.SetNum(Record.TableId + 1);
+			}
+
+			TArray<TArray<double>>& Columns = Pending[Record.TableId];
+			if (Columns.Num() < Record.NumValues)
+			{
+				Columns.SetNum(Record.NumValues);
+			}
+			for (int32 c = 0; c < Columns.Num(); ++c)
+			{
+				Columns[c].Add(c < Record.NumValues ? Record.Values[c] : 0.0);
+			}
+		}
+	}
+}
+
+void FSimulationRunLogger::WritePending()
+{
+	TArray<FRunLogTable> TablesCopy;
+	{
+		FScopeLock ScopeLock(&Lock);
+		TablesCopy = Tables;
+	}
+
+	// Definitions go out before the first row block that needs them
+	for (; NumTablesWritten < TablesCopy.Num(); ++NumTablesWritten)
+	{
+		Writer.WriteTable(NumTablesWritten, TablesCopy[NumTablesWritten]);
+	}
+
+	for (int32 TableId = 0; TableId < Pending.Num() && TableId < TablesCopy.Num(); ++TableId)
+	{
+		TArray<TArray<double>>& Columns = Pending[TableId];
+		Columns.SetNum(TablesCopy[TableId].Columns.Num());
+
+		// Rows shorter than the table were padded as they arrived; pad columns added by SetNum too
+		const int32 NumRows = Columns.Num() > 0 ? Columns[0].Num() : 0;
+		for (TArray<double>& Column : Columns)
+		{
+			Column.SetNumZeroed(NumRows);
+		}
+
+		Writer.WriteRows(TableId, TablesCopy[TableId], Columns);
+
+		for (TArray<double>& Column : Columns)
+		{
+			Column.Reset();
+		}
+	}
+}
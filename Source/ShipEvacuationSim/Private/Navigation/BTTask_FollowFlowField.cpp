@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/BTTask_FollowFlowField.h"
+#include "AICharacter.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/BlackboardData.h"
+
+UBTTask_FollowFlowField::UBTTask_FollowFlowField()
+{
+	NodeName = TEXT("Follow Flow Field");
+	bNotifyTick = true;
+
+	MusterStationKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_FollowFlowField, MusterStationKey), AActor::StaticClass());
+	MusterStationKey.AllowNoneAsValue(true);
+}
+
+void UBTTask_FollowFlowField::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* Blackboard = GetBlackboardAsset())
+	{
+		MusterStationKey.ResolveSelectedKey(*Blackboard);
+	}
+}
+
+EBTNodeResult::Type UBTTask_FollowFlowField::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	const AAIController* AIController = OwnerComp.GetAIOwner();
+	AAiCharacter* Agent = AIController ? Cast<AAiCharacter>(AIController->GetPawn()) : nullptr;
+	if (!Agent) return EBTNodeResult::Failed;
+
+	AActor* MusterStation = nullptr;
+	if (MusterStationKey.IsSet())
+	{
+		if (const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent())
+		{
+			MusterStation = Cast<AActor>(Blackboard->GetValueAsObject(MusterStationKey.SelectedKeyName));
+		}
+	}
+
+	return Agent->FollowFlowField(MusterStation) ? EBTNodeResult::InProgress : EBTNodeResult::Failed;
+}
+
+void UBTTask_FollowFlowField::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	const AAIController* AIController = OwnerComp.GetAIOwner();
+	const AAiCharacter* Agent = AIController ? Cast<AAiCharacter>(AIController->GetPawn()) : nullptr;
+
+	if (!Agent || Agent->bHasMustered)
+	{
+		FinishLatentTask(OwnerComp, Agent ? EBTNodeResult::Succeeded : EBTNodeResult::Failed);
+	}
+	else if (!Agent->IsFollowingFlowField())
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Failed);
+	}
+}
+
+EBTNodeResult::Type UBTTask_FollowFlowField::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	const AAIController* AIController = OwnerComp.GetAIOwner();
+	if (AAiCharacter* Agent = AIController ? Cast<AAiCharacter>(AIController->GetPawn()) : nullptr)
+	{
+		Agent->StopFollowingFlowField();
+	}
+
+	return EBTNodeResult::Aborted;
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/BTTask_MoveViaDeckGraph.h"
+#include "Navigation/DeckGraphSubsystem.h"
+#include "AICharacter.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "Navigation/PathFollowingComponent.h"
+
+UBTTask_MoveViaDeckGraph::UBTTask_MoveViaDeckGraph()
+{
+	NodeName = TEXT("Move Via Deck Graph");
+	bNotifyTick = true;
+
+	GoalKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_MoveViaDeckGraph, GoalKey), AActor::StaticClass());
+	GoalKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_MoveViaDeckGraph, GoalKey));
+}
+
+void UBTTask_MoveViaDeckGraph::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* Blackboard = GetBlackboardAsset())
+	{
+		GoalKey.ResolveSelectedKey(*Blackboard);
+	}
+}
+
+uint16 UBTTask_MoveViaDeckGraph::GetInstanceMemorySize() const
+{
+	return sizeof(FMoveMemory);
+}
+
+bool UBTTask_MoveViaDeckGraph::GetGoal(const UBehaviorTreeComponent& OwnerComp, FVector& OutGoal) const
+{
+	const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (!Blackboard) return false;
+
+	if (GoalKey.SelectedKeyType == UBlackboardKeyType_Object::StaticClass())
+	{
+		const AActor* Goal = Cast<AActor>(Blackboard->GetValueAsObject(GoalKey.SelectedKeyName));
+		if (!Goal) return false;
+
+		OutGoal = Goal->GetActorLocation();
+		return true;
+	}
+
+	OutGoal = Blackboard->GetValueAsVector(GoalKey.SelectedKeyName);
+	return FAISystem::IsValidLocation(OutGoal);
+}
+
+EBTNodeResult::Type UBTTask_MoveViaDeckGraph::MoveToNextWaypoint(UBehaviorTreeComponent& OwnerComp, FMoveMemory& Memory) const
+{
+	AAIController* AIController = OwnerComp.GetAIOwner();
+	const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr;
+
+	FVector Goal;
+	if (!Pawn || !GetGoal(OwnerComp, Goal)) return EBTNodeResult::Failed;
+
+	const FVector Location = Pawn->GetNavAgentLocation();
+	if (FVector::Dist2D(Location, Goal) <= AcceptanceRadius) return EBTNodeResult::Succeeded;
+
+	const UDeckGraphSubsystem* DeckGraph = Pawn->GetWorld()->GetSubsystem<UDeckGraphSubsystem>();
+	const FVector Waypoint = DeckGraph ? DeckGraph->GetNextWaypoint(Location, Goal) : Goal;
+	const bool bFinalLeg = Waypoint.Equals(Goal);
+
+	// Still short of the same waypoint or the goal after a finished move: the navmesh cannot get any closer,
+	// and asking again would only repeat the partial path every tick
+	if (Waypoint.Equals(Memory.Waypoint)) return EBTNodeResult::Failed;
+	Memory.Waypoint = Waypoint;
+
+	const EPathFollowingRequestResult::Type Result = AIController->MoveToLocation(Waypoint, bFinalLeg ? AcceptanceRadius : WaypointAcceptanceRadius);
+	switch (Result)
+	{
+	case EPathFollowingRequestResult::AlreadyAtGoal:
+		return bFinalLeg ? EBTNodeResult::Succeeded : EBTNodeResult::InProgress;
+	case EPathFollowingRequestResult::RequestSuccessful:
+		return EBTNodeResult::InProgress;
+	default:
+		return EBTNodeResult::Failed;
+	}
+}
+
+EBTNodeResult::Type UBTTask_MoveViaDeckGraph::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FMoveMemory& Memory = *CastInstanceNodeMemory<FMoveMemory>(NodeMemory);
+	Memory.Waypoint = FAISystem::InvalidLocation;
+
+	return MoveToNextWaypoint(OwnerComp, Memory);
+}
+
+void UBTTask_MoveViaDeckGraph::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	const AAIController* AIController = OwnerComp.GetAIOwner();
+	const AAiCharacter* Agent = AIController ? Cast<AAiCharacter>(AIController->GetPawn()) : nullptr;
+	if (Agent && Agent->bHasMustered)
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+		return;
+	}
+
+	// Plan the next leg once the current one is walked (or given up on)
+	if (!AIController || AIController->GetMoveStatus() != EPathFollowingStatus::Idle) return;
+
+	const EBTNodeResult::Type Result = MoveToNextWaypoint(OwnerComp, *CastInstanceNodeMemory<FMoveMemory>(NodeMemory));
+	if (Result != EBTNodeResult::InProgress)
+	{
+		FinishLatentTask(OwnerComp, Result);
+	}
+}
+
+EBTNodeResult::Type UBTTask_MoveViaDeckGraph::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	if (AAIController* AIController = OwnerComp.GetAIOwner())
+	{
+		AIController->StopMovement();
+	}
+
+	return EBTNodeResult::Aborted;
+}
@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/DeckGraphSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Navigation/NavUpdateSchedulerSubsystem.h"
+#include "Algo/Reverse.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformTime.h"
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+
+bool UDeckGraphSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UDeckGraphSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	NavMeta = Collection.InitializeDependency<UNavMetadataSubsystem>();
+	if (NavMeta)
+	{
+		BakedHandle = NavMeta->OnBaked.AddUObject(this, &UDeckGraphSubsystem::Rebuild);
+	}
+
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = Collection.InitializeDependency<UNavUpdateSchedulerSubsystem>())
+	{
+		AreaHandle = NavUpdates->OnAreaSubmitted.AddUObject(this, &UDeckGraphSubsystem::OnAreaSubmitted);
+	}
+}
+
+void UDeckGraphSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (Regions.Num() == 0 && NavMeta && NavMeta->IsBaked())
+	{
+		Rebuild();
+	}
+}
+
+void UDeckGraphSubsystem::Deinitialize()
+{
+	if (NavMeta)
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = GetWorld()->GetSubsystem<UNavUpdateSchedulerSubsystem>())
+	{
+		NavUpdates->OnAreaSubmitted.Remove(AreaHandle);
+	}
+
+	CellRegions.Empty();
+	Regions.Empty();
+	Portals.Empty();
+	Edges.Empty();
+	ModifierBounds.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UDeckGraphSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UDeckGraphSubsystem, STATGROUP_Tickables);
+}
+
+// Build
+void UDeckGraphSubsystem::Rebuild()
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	CellRegions.Reset();
+	Regions.Reset();
+	Portals.Reset();
+	Edges.Reset();
+	RefreshCursor = 0;
+
+	BuildRegions();
+	BuildPortals();
+
+	UE_LOG(LogTemp, Log, TEXT("DeckGraph: %d regions, %d portals, %d edges in %.2f s"),
+		Regions.Num(), Portals.Num(), Edges.Num(), FPlatformTime::Seconds() - StartTime);
+}
+
+void UDeckGraphSubsystem::BuildRegions()
+{
+	const int32 NumCells = NavMeta->GetNumCells();
+
+	// Deck volumes, lowest first, take precedence over the baked deck ids
+	TArray<FBox> DeckVolumes;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (It->GetClass()->GetName().StartsWith(DeckVolumeClassPrefix))
+		{
+			DeckVolumes.Add(It->GetComponentsBoundingBox(true));
+		}
+	}
+	DeckVolumes.Sort([](const FBox& A, const FBox& B) { return A.Min.Z < B.Min.Z; });
+
+	TArray<int32> CellDecks;
+	TBitArray<> CellStairs(false, NumCells);
+	CellDecks.SetNumUninitialized(NumCells);
+
+	FNavMetadataSample Sample;
+	for (int32 i = 0; i < NumCells; ++i)
+	{
+		NavMeta->GetCellSample(i, Sample);
+		CellStairs[i] = Sample.bStairs;
+		CellDecks[i] = DeckVolumes.Num() + Sample.Deck;
+
+		if (DeckVolumes.Num() > 0)
+		{
+			// Test a little above the floor in case the volume starts right at it
+			const FVector Location = NavMeta->GetCellLocation(i) + FVector(0.f, 0.f, NavMeta->CellSize);
+			const int32 Volume = DeckVolumes.IndexOfByPredicate([&Location](const FBox& Box) { return Box.IsInsideOrOn(Location); });
+			if (Volume != INDEX_NONE)
+			{
+				CellDecks[i] = Volume;
+			}
+		}
+	}
+
+	// Flood fill: flat cells join neighbours on the same deck, stair cells join stair cells
+	CellRegions.Init(INDEX_NONE, NumCells);
+	TArray<int32> Stack;
+	TArray<int32> Neighbours;
+	for (int32 Seed = 0; Seed < NumCells; ++Seed)
+	{
+		if (CellRegions[Seed] != INDEX_NONE) continue;
+
+		const int32 Region = Regions.Num();
+		const bool bStairs = CellStairs[Seed];
+		FRegion& NewRegion = Regions.AddDefaulted_GetRef();
+		NewRegion.bStairs = bStairs;
+		NewRegion.Deck = CellDecks[Seed];
+
+		CellRegions[Seed] = Region;
+		Stack.Add(Seed);
+		while (Stack.Num() > 0)
+		{
+			const int32 Cell = Stack.Pop(EAllowShrinking::No);
+			NavMeta->GetCellNeighbours(Cell, Neighbours);
+
+			for (const int32 Neighbour : Neighbours)
+			{
+				if (CellRegions[Neighbour] == INDEX_NONE && CellStairs[Neighbour] == bStairs
+					&& (bStairs || CellDecks[Neighbour] == CellDecks[Seed]))
+				{
+					CellRegions[Neighbour] = Region;
+					Stack.Add(Neighbour);
+				}
+			}
+		}
+	}
+}
+
+void UDeckGraphSubsystem::BuildPortals()
+{
+	struct FContact
+	{
+		FVector Sum = FVector::ZeroVector;
+		TArray<int32> Cells;
+	};
+
+	// Where two regions meet, keyed by (lower region, higher region)
+	TMap<FIntPoint, FContact> Contacts;
+	TArray<int32> Neighbours;
+	for (int32 Cell = 0; Cell < CellRegions.Num(); ++Cell)
+	{
+		const int32 Region = CellRegions[Cell];
+		NavMeta->GetCellNeighbours(Cell, Neighbours);
+
+		for (const int32 Neighbour : Neighbours)
+		{
+			const int32 Other = CellRegions[Neighbour];
+			if (Other <= Region) continue;
+
+			// Portals sit on the landing, not on the first step
+			const int32 Landing = Regions[Region].bStairs ? Neighbour : Cell;
+			FContact& Contact = Contacts.FindOrAdd(FIntPoint(Region, Other));
+			Contact.Sum += NavMeta->GetCellLocation(Landing);
+			Contact.Cells.Add(Landing);
+		}
+	}
+
+	TArray<int32> NumPartners;
+	NumPartners.SetNumZeroed(Regions.Num());
+	for (const TPair<FIntPoint, FContact>& Contact : Contacts)
+	{
+		NumPartners[Contact.Key.X]++;
+		NumPartners[Contact.Key.Y]++;
+	}
+
+	for (const TPair<FIntPoint, FContact>& Contact : Contacts)
+	{
+		// Stair cells touching a single region are ramps or steep floor, not stairwells
+		const int32 A = Contact.Key.X;
+		const int32 B = Contact.Key.Y;
+		if ((Regions[A].bStairs && NumPartners[A] < 2) || (Regions[B].bStairs && NumPartners[B] < 2)) continue;
+
+		// The contact cell nearest the middle of the contact
+		const FVector Centroid = Contact.Value.Sum / Contact.Value.Cells.Num();
+		FVector Location = FVector::ZeroVector;
+		double BestDistance = MAX_dbl;
+		for (const int32 Cell : Contact.Value.Cells)
+		{
+			const FVector CellLocation = NavMeta->GetCellLocation(Cell);
+			const double Distance = FVector::DistSquared(CellLocation, Centroid);
+			if (Distance < BestDistance)
+			{
+				Location = CellLocation;
+				BestDistance = Distance;
+			}
+		}
+
+		const int32 Index = Portals.Num();
+		FPortal& Portal = Portals.AddDefaulted_GetRef();
+		Portal.Location = Location;
+		Portal.RegionA = A;
+		Portal.RegionB = B;
+		Regions[A].Portals.Add(Index);
+		Regions[B].Portals.Add(Index);
+	}
+
+	// One edge for every pair of portals sharing a region
+	for (int32 RegionIndex = 0; RegionIndex < Regions.Num(); ++RegionIndex)
+	{
+		const FRegion& Region = Regions[RegionIndex];
+		for (int32 i = 0; i < Region.Portals.Num(); ++i)
+		{
+			for (int32 j = i + 1; j < Region.Portals.Num(); ++j)
+			{
+				const int32 Index = Edges.Num();
+				FEdge& Edge = Edges.AddDefaulted_GetRef();
+				Edge.PortalA = Region.Portals[i];
+				Edge.PortalB = Region.Portals[j];
+				Edge.Region = RegionIndex;
+				Edge.Cost = float(FVector::Dist(Portals[Edge.PortalA].Location, Portals[Edge.PortalB].Location));
+
+				Portals[Edge.PortalA].Edges.Add(Index);
+				Portals[Edge.PortalB].Edges.Add(Index);
+			}
+		}
+	}
+	NumStaleEdges = Edges.Num();
+}
+
+int32 UDeckGraphSubsystem::GetRegionAt(const FVector& Location) const
+{
+	const int32 Cell = NavMeta ? NavMeta->FindCellIndex(Location) : INDEX_NONE;
+	return CellRegions.IsValidIndex(Cell) ? CellRegions[Cell] : INDEX_NONE;
+}
+
+// Portal costs
+void UDeckGraphSubsystem::Tick(float DeltaTime)
+{
+	if (NumStaleEdges == 0) return;
+
+	// Costs read now would reflect areas the navmesh has not rebuilt yet
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSys || NavSys->HasDirtyAreasQueued() || NavSys->GetNumRemainingBuildTasks() > 0) return;
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Visited = 0; Visited < Edges.Num() && NumStaleEdges > 0; ++Visited)
+	{
+		FEdge& Edge = Edges[RefreshCursor];
+		RefreshCursor = (RefreshCursor + 1) % Edges.Num();
+		if (!Edge.bStale) continue;
+
+		RefreshEdge(Edge);
+		NumStaleEdges--;
+
+		if ((FPlatformTime::Seconds() - StartTime) * 1000.0 > RefreshBudgetMs) break;
+	}
+}
+
+void UDeckGraphSubsystem::RefreshEdge(FEdge& Edge)
+{
+	Edge.bStale = false;
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+	if (!NavData) return;
+
+	const FPathFindingQuery Query(this, *NavData, Portals[Edge.PortalA].Location, Portals[Edge.PortalB].Location, NavData->GetDefaultQueryFilter());
+	const FPathFindingResult Result = NavSys->FindPathSync(Query);
+
+	Edge.PathPoints.Reset();
+	if (Result.IsSuccessful() && !Result.IsPartial())
+	{
+		Edge.Cost = float(Result.Path->GetCost());
+		for (const FNavPathPoint& Point : Result.Path->GetPathPoints())
+		{
+			Edge.PathPoints.Add(Point.Location);
+		}
+	}
+	else
+	{
+		Edge.Cost = MAX_flt;
+	}
+}
+
+void UDeckGraphSubsystem::OnAreaSubmitted(const AActor* Owner, const FBox& Bounds, TSubclassOf<UNavArea> AreaClass)
+{
+	if (!Owner) return;
+
+	FBox Region = Bounds;
+	if (const FBox* Previous = ModifierBounds.Find(Owner))
+	{
+		Region += *Previous;
+	}
+	ModifierBounds.Add(Owner, Bounds);
+
+	// Paths run along the floor under the modifier
+	Region.Min.Z -= NavMeta ? NavMeta->MaxLayerDistance : 0.f;
+
+	// A modifier going away can reconnect portals that had no path, anywhere on its decks
+	TSet<int32> TouchedDecks;
+	if (NavMeta)
+	{
+		NavMeta->ForEachCellInBox(Region, [this, &TouchedDecks](int32 Cell)
+		{
+			if (CellRegions.IsValidIndex(Cell) && CellRegions[Cell] != INDEX_NONE)
+			{
+				TouchedDecks.Add(Regions[CellRegions[Cell]].Deck);
+			}
+		});
+	}
+
+	for (FEdge& Edge : Edges)
+	{
+		if (Edge.bStale) continue;
+
+		// Edges without a path, or not refreshed yet, have no points to test
+		bool bStale = Edge.Cost == MAX_flt ? TouchedDecks.Contains(Regions[Edge.Region].Deck)
+			: FBox(Portals[Edge.PortalA].Location, Portals[Edge.PortalB].Location).Intersect(Region);
+
+		for (int32 i = 1; i < Edge.PathPoints.Num() && !bStale; ++i)
+		{
+			const FVector& From = Edge.PathPoints[i - 1];
+			const FVector& To = Edge.PathPoints[i];
+			bStale = FMath::LineBoxIntersection(Region, From, To, To - From);
+		}
+
+		if (bStale)
+		{
+			Edge.bStale = true;
+			NumStaleEdges++;
+		}
+	}
+}
+
+// Queries
+bool UDeckGraphSubsystem::PlanRoute(const FVector& Start, const FVector& End, TArray<FVector>& OutWaypoints) const
+{
+	OutWaypoints.Reset();
+
+	const int32 StartRegion = GetRegionAt(Start);
+	const int32 EndRegion = GetRegionAt(End);
+	if (StartRegion == INDEX_NONE || EndRegion == INDEX_NONE) return false;
+
+	if (StartRegion == EndRegion)
+	{
+		OutWaypoints.Add(End);
+		return true;
+	}
+
+	struct FQueueEntry
+	{
+		float Cost;
+		int32 Portal;
+	};
+	const auto Less = [](const FQueueEntry& A, const FQueueEntry& B) { return A.Cost < B.Cost; };
+
+	TArray<float> Cost;
+	TArray<int32> Previous;
+	Cost.Init(MAX_flt, Portals.Num());
+	Previous.Init(INDEX_NONE, Portals.Num());
+	TArray<FQueueEntry> Queue;
+
+	// The legs inside the start and end regions are estimated by distance; the navmesh refines them when walked
+	for (const int32 Portal : Regions[StartRegion].Portals)
+	{
+		Cost[Portal] = float(FVector::Dist(Start, Portals[Portal].Location));
+		Queue.HeapPush({ Cost[Portal], Portal }, Less);
+	}
+
+	int32 Last = INDEX_NONE;
+	float BestCost = MAX_flt;
+	while (Queue.Num() > 0)
+	{
+		FQueueEntry Entry;
+		Queue.HeapPop(Entry, Less, EAllowShrinking::No);
+		if (Entry.Cost > Cost[Entry.Portal]) continue;
+		if (Entry.Cost >= BestCost) break;
+
+		const FPortal& Portal = Portals[Entry.Portal];
+		if (Portal.RegionA == EndRegion || Portal.RegionB == EndRegion)
+		{
+			const float Total = Entry.Cost + float(FVector::Dist(Portal.Location, End));
+			if (Total < BestCost)
+			{
+				BestCost = Total;
+				Last = Entry.Portal;
+			}
+		}
+
+		for (const int32 EdgeIndex : Portal.Edges)
+		{
+			const FEdge& Edge = Edges[EdgeIndex];
+			if (Edge.Cost == MAX_flt) continue;
+
+			const int32 Other = Edge.PortalA == Entry.Portal ? Edge.PortalB : Edge.PortalA;
+			const float NewCost = Entry.Cost + Edge.Cost;
+			if (NewCost < Cost[Other])
+			{
+				Cost[Other] = NewCost;
+				Previous[Other] = Entry.Portal;
+				Queue.HeapPush({ NewCost, Other }, Less);
+			}
+		}
+	}
+
+	if (Last == INDEX_NONE) return false;
+
+	for (int32 Portal = Last; Portal != INDEX_NONE; Portal = Previous[Portal])
+	{
+		OutWaypoints.Add(Portals[Portal].Location);
+	}
+	Algo::Reverse(OutWaypoints);
+	OutWaypoints.Add(End);
+	return true;
+}
+
+FVector UDeckGraphSubsystem::GetNextWaypoint(const FVector& Start, const FVector& End) const
+{
+	TArray<FVector> Waypoints;
+	if (!PlanRoute(Start, End, Waypoints)) return End;
+
+	// The agent stands on a portal of both regions it joins, so the route may still lead through it
+	for (const FVector& Waypoint : Waypoints)
+	{
+		if (FVector::Dist(Start, Waypoint) > PortalRadius)
+		{
+			return Waypoint;
+		}
+	}
+	return End;
+}
@@ -0,0 +1,606 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/FlowFieldSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Navigation/NavUpdateSchedulerSubsystem.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformTime.h"
+#include "NavAreas/NavArea.h"
+#include "NavAreas/NavArea_Default.h"
+#include "NavAreas/NavArea_Null.h"
+#include "NavigationSystem.h"
+
+struct FFlowFieldGraph
+{
+	TArray<FVector3f> Locations;
+
+	// Neighbours of cell i are Neighbours[NeighbourStart[i], NeighbourStart[i + 1])
+	TArray<int32> NeighbourStart;
+	TArray<int32> Neighbours;
+
+	TConstArrayView<int32> GetNeighbours(int32 Cell) const
+	{
+		return MakeArrayView(Neighbours.GetData() + NeighbourStart[Cell], NeighbourStart[Cell + 1] - NeighbourStart[Cell]);
+	}
+};
+
+namespace FlowField
+{
+	static constexpr float Unreached = MAX_flt;
+
+	// Negative Cost marks an area agents cannot cross
+	struct FAreaCost
+	{
+		float Cost = 1.f;
+		float EnterCost = 0.f;
+	};
+
+	struct FQueueEntry
+	{
+		float Cost;
+		int32 Cell;
+	};
+
+	static FAreaCost GetAreaCost(TSubclassOf<UNavArea> AreaClass)
+	{
+		FAreaCost AreaCost;
+		if (!AreaClass) return AreaCost;
+
+		if (AreaClass->IsChildOf(UNavArea_Null::StaticClass()))
+		{
+			AreaCost.Cost = -1.f;
+			return AreaCost;
+		}
+
+		const UNavArea* Area = AreaClass->GetDefaultObject<UNavArea>();
+		AreaCost.Cost = Area->DefaultCost;
+		AreaCost.EnterCost = Area->GetFixedAreaEnteringCost();
+		return AreaCost;
+	}
+
+	static TArray<FAreaCost> GetAreaCosts(const TArray<TSubclassOf<UNavArea>>& AreaClasses)
+	{
+		TArray<FAreaCost> Costs;
+		for (const TSubclassOf<UNavArea>& AreaClass : AreaClasses)
+		{
+			Costs.Add(GetAreaCost(AreaClass));
+		}
+		return Costs;
+	}
+
+	// Where modifiers overlap, the area a path would avoid most wins
+	static bool IsHeavier(const FAreaCost& A, const FAreaCost& B)
+	{
+		if (B.Cost < 0.f) return false;
+		return A.Cost < 0.f || A.Cost > B.Cost;
+	}
+
+	// Cost of stepping From -> To: distance weighted by both cells' areas, plus the fee for entering a new area
+	static float GetStepCost(const FFlowFieldGraph& Graph, const TArray<uint8>& Areas, const TArray<FAreaCost>& Costs, int32 From, int32 To)
+	{
+		const FAreaCost& FromCost = Costs[Areas[From]];
+		const FAreaCost& ToCost = Costs[Areas[To]];
+		if (FromCost.Cost < 0.f || ToCost.Cost < 0.f) return -1.f;
+
+		float Step = FVector3f::Dist(Graph.Locations[From], Graph.Locations[To]) * 0.5f * (FromCost.Cost + ToCost.Cost);
+		if (Areas[From] != Areas[To])
+		{
+			Step += ToCost.EnterCost;
+		}
+		return Step;
+	}
+
+	/**
+	 * Dijkstra outwards from the goal cells. With an existing field, only the dirty
+	 * cells and the cells whose route ran through them are cleared; they refill from
+	 * the intact cells around them, and cheaper dirty cells propagate their savings
+	 * outwards through the normal relaxation.
+	 */
+	static void Solve(const FFlowFieldGraph& Graph, const TArray<uint8>& Areas, const TArray<FAreaCost>& Costs,
+		const TArray<int32>& Goals, const TArray<int32>& Dirty, TArray<float>& Cost, TArray<int32>& Next)
+	{
+		const int32 NumCells = Graph.Locations.Num();
+		const auto Less = [](const FQueueEntry& A, const FQueueEntry& B) { return A.Cost < B.Cost; };
+
+		TArray<FQueueEntry> Queue;
+
+		TBitArray<> IsGoal(false, NumCells);
+		for (const int32 Goal : Goals)
+		{
+			IsGoal[Goal] = true;
+		}
+
+		if (Cost.Num() != NumCells || Next.Num() != NumCells)
+		{
+			Cost.Init(Unreached, NumCells);
+			Next.Init(INDEX_NONE, NumCells);
+			for (const int32 Goal : Goals)
+			{
+				Cost[Goal] = 0.f;
+				Queue.HeapPush({ 0.f, Goal }, Less);
+			}
+		}
+		else
+		{
+			TBitArray<> Invalid(false, NumCells);
+			TArray<int32> Cleared;
+			for (const int32 Cell : Dirty)
+			{
+				if (!Invalid[Cell])
+				{
+					Invalid[Cell] = true;
+					Cleared.Add(Cell);
+				}
+			}
+
+			// Cells routed through a cleared cell lose their cost too
+			for (int32 i = 0; i < Cleared.Num(); ++i)
+			{
+				for (const int32 Neighbour : Graph.GetNeighbours(Cleared[i]))
+				{
+					if (!Invalid[Neighbour] && Next[Neighbour] == Cleared[i])
+					{
+						Invalid[Neighbour] = true;
+						Cleared.Add(Neighbour);
+					}
+				}
+			}
+
+			for (const int32 Cell : Cleared)
+			{
+				Cost[Cell] = IsGoal[Cell] ? 0.f : Unreached;
+				Next[Cell] = INDEX_NONE;
+			}
+
+			// Refill from the goals and the intact border of the cleared region
+			for (const int32 Cell : Cleared)
+			{
+				if (IsGoal[Cell])
+				{
+					Queue.HeapPush({ 0.f, Cell }, Less);
+				}
+
+				for (const int32 Neighbour : Graph.GetNeighbours(Cell))
+				{
+					if (!Invalid[Neighbour] && Cost[Neighbour] != Unreached)
+					{
+						Queue.HeapPush({ Cost[Neighbour], Neighbour }, Less);
+					}
+				}
+			}
+		}
+
+		while (Queue.Num() > 0)
+		{
+			FQueueEntry Entry;
+			Queue.HeapPop(Entry, Less, EAllowShrinking::No);
+
+			// Stale entry, the cell was reached more cheaply since
+			if (Entry.Cost > Cost[Entry.Cell]) continue;
+
+			for (const int32 Neighbour : Graph.GetNeighbours(Entry.Cell))
+			{
+				const float Step = GetStepCost(Graph, Areas, Costs, Neighbour, Entry.Cell);
+				if (Step < 0.f) continue;
+
+				const float NewCost = Entry.Cost + Step;
+				if (NewCost < Cost[Neighbour])
+				{
+					Cost[Neighbour] = NewCost;
+					Next[Neighbour] = Entry.Cell;
+					Queue.HeapPush({ NewCost, Neighbour }, Less);
+				}
+			}
+		}
+	}
+}
+
+bool UFlowFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UFlowFieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Index 0 is the default area
+	AreaClasses.Add(nullptr);
+
+	NavMeta = Collection.InitializeDependency<UNavMetadataSubsystem>();
+	if (NavMeta)
+	{
+		BakedHandle = NavMeta->OnBaked.AddUObject(this, &UFlowFieldSubsystem::RebuildGraph);
+	}
+
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = Collection.InitializeDependency<UNavUpdateSchedulerSubsystem>())
+	{
+		AreaHandle = NavUpdates->OnAreaSubmitted.AddUObject(this, &UFlowFieldSubsystem::OnAreaSubmitted);
+	}
+}
+
+void UFlowFieldSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	CollectStations();
+
+	// The metadata may have loaded before or after this point
+	if (Graph.IsValid())
+	{
+		for (FField& Field : Fields)
+		{
+			FindGoalCells(Field);
+		}
+		bNeedsFullSolve = true;
+	}
+	else if (NavMeta && NavMeta->IsBaked())
+	{
+		RebuildGraph();
+	}
+}
+
+void UFlowFieldSubsystem::Deinitialize()
+{
+	WaitForSolves();
+
+	if (NavMeta)
+	{
+		NavMeta->OnBaked.Remove(BakedHandle);
+	}
+
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = GetWorld()->GetSubsystem<UNavUpdateSchedulerSubsystem>())
+	{
+		NavUpdates->OnAreaSubmitted.Remove(AreaHandle);
+	}
+
+	Fields.Empty();
+	Graph.Reset();
+	CellAreas.Empty();
+	Modifiers.Empty();
+	DirtyCells.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFlowFieldSubsystem, STATGROUP_Tickables);
+}
+
+// Stations and graph
+void UFlowFieldSubsystem::CollectStations()
+{
+	Fields.Reset();
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (It->ActorHasTag(MusterStationTag) || It->GetClass()->GetName().StartsWith(MusterStationClassPrefix))
+		{
+			Fields.AddDefaulted_GetRef().Station = *It;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("FlowField: %d muster stations"), Fields.Num());
+}
+
+void UFlowFieldSubsystem::RebuildGraph()
+{
+	WaitForSolves();
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumCells = NavMeta->GetNumCells();
+
+	TSharedRef<FFlowFieldGraph> NewGraph = MakeShared<FFlowFieldGraph>();
+	NewGraph->Locations.SetNumUninitialized(NumCells);
+	NewGraph->NeighbourStart.SetNumUninitialized(NumCells + 1);
+	NewGraph->Neighbours.Reserve(NumCells * 8);
+
+	TArray<int32> CellNeighbours;
+	for (int32 i = 0; i < NumCells; ++i)
+	{
+		NewGraph->Locations[i] = FVector3f(NavMeta->GetCellLocation(i));
+		NewGraph->NeighbourStart[i] = NewGraph->Neighbours.Num();
+
+		NavMeta->GetCellNeighbours(i, CellNeighbours);
+		NewGraph->Neighbours.Append(CellNeighbours);
+	}
+	NewGraph->NeighbourStart[NumCells] = NewGraph->Neighbours.Num();
+	Graph = NewGraph;
+
+	// Re-apply the areas submitted so far; the full solve below covers every cell anyway
+	CellAreas.Init(0, NumCells);
+	TArray<FBox> ModifierBounds;
+	for (const TPair<TWeakObjectPtr<const AActor>, FAreaModifier>& Modifier : Modifiers)
+	{
+		ModifierBounds.Add(Modifier.Value.Bounds);
+	}
+	for (const FBox& Bounds : ModifierBounds)
+	{
+		UpdateCellAreas(Bounds);
+	}
+	DirtyCells.Reset();
+
+	for (FField& Field : Fields)
+	{
+		FindGoalCells(Field);
+		Field.Cost.Reset();
+		Field.Next.Reset();
+	}
+	bNeedsFullSolve = true;
+
+	UE_LOG(LogTemp, Log, TEXT("FlowField: built graph of %d cells, %d links in %.2f s"),
+		NumCells, NewGraph->Neighbours.Num(), FPlatformTime::Seconds() - StartTime);
+}
+
+void UFlowFieldSubsystem::FindGoalCells(FField& Field) const
+{
+	Field.GoalCells.Reset();
+
+	const AActor* Station = Field.Station.Get();
+	if (!Station || !Graph.IsValid()) return;
+
+	Field.GoalLocation = Station->GetActorLocation();
+	NavMeta->ForEachCellInBox(GetModifierBox(Station->GetComponentsBoundingBox(true)), [&Field](int32 Cell)
+	{
+		Field.GoalCells.Add(Cell);
+	});
+
+	// Station smaller than a cell, or floating above the floor
+	if (Field.GoalCells.Num() == 0)
+	{
+		UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		FNavLocation NavLocation;
+		const FVector Extent(NavMeta->CellSize * 2.f, NavMeta->CellSize * 2.f, 500.f);
+		if (NavSys && NavSys->ProjectPointToNavigation(Field.GoalLocation, NavLocation, Extent))
+		{
+			const int32 Cell = NavMeta->FindCellIndex(NavLocation.Location);
+			if (Cell != INDEX_NONE)
+			{
+				Field.GoalCells.Add(Cell);
+			}
+		}
+	}
+
+	if (Field.GoalCells.Num() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FlowField: %s is not on the navigation grid"), *Station->GetName());
+	}
+}
+
+// Areas
+uint8 UFlowFieldSubsystem::GetAreaIndex(TSubclassOf<UNavArea> AreaClass)
+{
+	if (!AreaClass || AreaClass->IsChildOf(UNavArea_Default::StaticClass())) return 0;
+
+	const int32 Index = AreaClasses.AddUnique(AreaClass);
+	if (Index > MAX_uint8)
+	{
+		AreaClasses.RemoveAt(Index);
+		return 0;
+	}
+	return uint8(Index);
+}
+
+FBox UFlowFieldSubsystem::GetModifierBox(const FBox& Bounds) const
+{
+	// Modifiers mark the navmesh under them, like the obstacles in the metadata
+	return FBox(Bounds.Min - FVector(0.f, 0.f, NavMeta->MaxLayerDistance), Bounds.Max);
+}
+
+void UFlowFieldSubsystem::UpdateCellAreas(const FBox& Region)
+{
+	if (!Graph.IsValid()) return;
+
+	const FBox RegionBox = GetModifierBox(Region);
+	const TArray<FlowField::FAreaCost> Costs = FlowField::GetAreaCosts(AreaClasses);
+
+	TArray<TPair<FBox, uint8>> Covering;
+	for (auto It = Modifiers.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const FBox Box = GetModifierBox(It->Value.Bounds);
+		if (Box.Intersect(RegionBox))
+		{
+			Covering.Emplace(Box, It->Value.Area);
+		}
+	}
+
+	NavMeta->ForEachCellInBox(RegionBox, [this, &Covering, &Costs](int32 Cell)
+	{
+		const FVector Location(Graph->Locations[Cell]);
+
+		uint8 Area = 0;
+		for (const TPair<FBox, uint8>& Modifier : Covering)
+		{
+			if (Modifier.Key.IsInsideOrOn(Location) && FlowField::IsHeavier(Costs[Modifier.Value], Costs[Area]))
+			{
+				Area = Modifier.Value;
+			}
+		}
+
+		if (CellAreas[Cell] != Area)
+		{
+			CellAreas[Cell] = Area;
+			DirtyCells.Add(Cell);
+		}
+	});
+}
+
+void UFlowFieldSubsystem::OnAreaSubmitted(const AActor* Owner, const FBox& Bounds, TSubclassOf<UNavArea> AreaClass)
+{
+	if (!Owner) return;
+
+	const uint8 Area = GetAreaIndex(AreaClass);
+
+	FBox Region = Bounds;
+	if (const FAreaModifier* Previous = Modifiers.Find(Owner))
+	{
+		if (Previous->Area == Area && Previous->Bounds.Equals(Bounds, 1.0)) return;
+		Region += Previous->Bounds;
+	}
+	else if (Area == 0)
+	{
+		return;
+	}
+
+	if (Area == 0)
+	{
+		Modifiers.Remove(Owner);
+	}
+	else
+	{
+		Modifiers.Add(Owner, { Bounds, Area });
+	}
+
+	UpdateCellAreas(Region);
+}
+
+// Solving
+void UFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	if (bSolving)
+	{
+		for (const FField& Field : Fields)
+		{
+			if (!Field.Solve.IsCompleted()) return;
+		}
+
+		// Swap every field at once so agents never mix old and new costs
+		for (FField& Field : Fields)
+		{
+			if (!Field.Solve.IsValid()) continue;
+
+			FSolveResult& Result = Field.Solve.GetResult();
+			Field.Cost = MoveTemp(Result.Cost);
+			Field.Next = MoveTemp(Result.Next);
+			Field.Solve = {};
+		}
+		bSolving = false;
+
+		LastSolveMs = float((FPlatformTime::Seconds() - SolveStartTime) * 1000.0);
+		if (bFullSolveInFlight)
+		{
+			UE_LOG(LogTemp, Log, TEXT("FlowField: solved %d fields in %.1f ms"), Fields.Num(), LastSolveMs);
+		}
+	}
+
+	if (Graph.IsValid() && Fields.Num() > 0 && (bNeedsFullSolve || DirtyCells.Num() > 0))
+	{
+		LaunchSolves();
+	}
+}
+
+void UFlowFieldSubsystem::LaunchSolves()
+{
+	const TSharedRef<const TArray<uint8>> Areas = MakeShared<TArray<uint8>>(CellAreas);
+	const TSharedRef<const TArray<int32>> Dirty = MakeShared<TArray<int32>>(bNeedsFullSolve ? TArray<int32>() : DirtyCells.Array());
+	const TArray<FlowField::FAreaCost> Costs = FlowField::GetAreaCosts(AreaClasses);
+
+	for (FField& Field : Fields)
+	{
+		if (Field.GoalCells.Num() == 0) continue;
+
+		// A repair starts from the field agents are sampling now
+		FSolveResult Input;
+		if (!bNeedsFullSolve)
+		{
+			Input.Cost = Field.Cost;
+			Input.Next = Field.Next;
+		}
+
+		Field.Solve = UE::Tasks::Launch(TEXT("FlowFieldSolve"),
+			[Graph = Graph, Areas, Dirty, Costs, Goals = Field.GoalCells, Result = MoveTemp(Input)]() mutable
+			{
+				FlowField::Solve(*Graph, *Areas, Costs, Goals, *Dirty, Result.Cost, Result.Next);
+				return MoveTemp(Result);
+			});
+	}
+
+	bFullSolveInFlight = bNeedsFullSolve;
+	bNeedsFullSolve = false;
+	DirtyCells.Reset();
+
+	bSolving = true;
+	SolveStartTime = FPlatformTime::Seconds();
+}
+
+void UFlowFieldSubsystem::WaitForSolves()
+{
+	// Results are dropped; callers are about to replace the fields
+	for (FField& Field : Fields)
+	{
+		if (Field.Solve.IsValid())
+		{
+			Field.Solve.Wait();
+		}
+		Field.Solve = {};
+	}
+	bSolving = false;
+}
+
+// Queries
+int32 UFlowFieldSubsystem::FindGoal(const AActor* MusterStation) const
+{
+	return Fields.IndexOfByPredicate([MusterStation](const FField& Field) { return Field.Station.Get() == MusterStation; });
+}
+
+bool UFlowFieldSubsystem::IsGoalReady(int32 Goal) const
+{
+	return Graph.IsValid() && Fields.IsValidIndex(Goal) && Fields[Goal].Cost.Num() == Graph->Locations.Num();
+}
+
+int32 UFlowFieldSubsystem::FindNearestGoal(const FVector& Location) const
+{
+	const int32 Cell = NavMeta ? NavMeta->FindCellIndex(Location) : INDEX_NONE;
+	if (Cell == INDEX_NONE) return INDEX_NONE;
+
+	int32 Best = INDEX_NONE;
+	float BestCost = FlowField::Unreached;
+	for (int32 Goal = 0; Goal < Fields.Num(); ++Goal)
+	{
+		if (IsGoalReady(Goal) && Fields[Goal].Cost[Cell] < BestCost)
+		{
+			Best = Goal;
+			BestCost = Fields[Goal].Cost[Cell];
+		}
+	}
+	return Best;
+}
+
+float UFlowFieldSubsystem::GetCostToGo(int32 Goal, const FVector& Location) const
+{
+	if (!IsGoalReady(Goal)) return -1.f;
+
+	const int32 Cell = NavMeta->FindCellIndex(Location);
+	if (Cell == INDEX_NONE || Fields[Goal].Cost[Cell] == FlowField::Unreached) return -1.f;
+
+	return Fields[Goal].Cost[Cell];
+}
+
+bool UFlowFieldSubsystem::SampleDirection(int32 Goal, const FVector& Location, FVector& OutDirection) const
+{
+	if (!IsGoalReady(Goal)) return false;
+
+	const FField& Field = Fields[Goal];
+	const int32 Cell = NavMeta->FindCellIndex(Location);
+	if (Cell == INDEX_NONE || Field.Cost[Cell] == FlowField::Unreached) return false;
+
+	// Aim two cells ahead so the eight grid directions blend into smoother headings
+	FVector Target = Field.GoalLocation;
+	const int32 Ahead = Field.Next[Cell];
+	if (Ahead != INDEX_NONE)
+	{
+		const int32 FurtherAhead = Field.Next[Ahead];
+		Target = FVector(Graph->Locations[FurtherAhead != INDEX_NONE ? FurtherAhead : Ahead]);
+	}
+
+	OutDirection = (Target - Location).GetSafeNormal2D();
+	return !OutDirection.IsNearlyZero();
+}
@@ -0,0 +1,627 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Algo/BinarySearch.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Detour/DetourNavMesh.h"
+
+namespace NavMetadata
+{
+	static constexpr uint32 Magic = 0x4154454D;	// "META"
+	static constexpr uint32 Version = 2;
+
+	static FAutoConsoleCommandWithWorld BakeCommand(
+		TEXT("Nav.BakeMetadata"),
+		TEXT("Rebakes the navigation metadata grid from the current navmesh and rewrites the cache."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UNavMetadataSubsystem* NavMeta = World ? World->GetSubsystem<UNavMetadataSubsystem>() : nullptr)
+			{
+				NavMeta->Bake();
+			}
+		}));
+}
+
+bool UNavMetadataSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNavMetadataSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	ARecastNavMesh* NavMesh = GetNavMesh();
+	if (NavMesh && NavMesh->GetNavMeshTilesCount() > 0)
+	{
+		UpdateCacheKey(*NavMesh);
+
+		// A bake on this machine is newer than the copy shipped with the map; both must match the navmesh to be used
+		const FString CacheName = GetCacheName();
+		if (LoadCache(FPaths::ProjectSavedDir() / CacheName) || LoadCache(FPaths::ProjectContentDir() / CacheName))
+		{
+			bBaked = true;
+			OnBaked.Broadcast();
+		}
+		else
+		{
+			bBaked = Bake();
+		}
+	}
+
+	// Navmesh built at runtime; bake once it exists
+	if (!bBaked)
+	{
+		if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld))
+		{
+			NavSys->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &UNavMetadataSubsystem::OnNavigationGenerationFinished);
+		}
+	}
+}
+
+void UNavMetadataSubsystem::Deinitialize()
+{
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UNavMetadataSubsystem::OnNavigationGenerationFinished);
+	}
+
+	Columns.Empty();
+	Cells.Empty();
+	CellColumns.Empty();
+	Obstacles.Empty();
+	OnBaked.Clear();
+
+	Super::Deinitialize();
+}
+
+void UNavMetadataSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	if (!bBaked && Bake())
+	{
+		if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+		{
+			NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UNavMetadataSubsystem::OnNavigationGenerationFinished);
+		}
+	}
+}
+
+ARecastNavMesh* UNavMetadataSubsystem::GetNavMesh() const
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	return NavSys ? Cast<ARecastNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate)) : nullptr;
+}
+
+// Lookup
+FIntPoint UNavMetadataSubsystem::GetColumn(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+int32 UNavMetadataSubsystem::FindCellIndex(const FVector& Location) const
+{
+	const FIntPoint* Range = Columns.Find(GetColumn(Location));
+	if (!Range) return INDEX_NONE;
+
+	// Columns rarely hold more than a few layers (decks and stairs)
+	int32 Best = INDEX_NONE;
+	float BestDistance = MaxLayerDistance;
+	for (int32 i = Range->X; i < Range->X + Range->Y; ++i)
+	{
+		const float Distance = FMath::Abs(Cells[i].Height - float(Location.Z));
+		if (Distance <= BestDistance)
+		{
+			Best = i;
+			BestDistance = Distance;
+		}
+	}
+	return Best;
+}
+
+bool UNavMetadataSubsystem::Lookup(const FVector& Location, FNavMetadataSample& OutSample) const
+{
+	const int32 Index = FindCellIndex(Location);
+	if (Index == INDEX_NONE) return false;
+
+	GetCellSample(Index, OutSample);
+	return true;
+}
+
+void UNavMetadataSubsystem::GetCellSample(int32 Index, FNavMetadataSample& OutSample) const
+{
+	const FCell& Cell = Cells[Index];
+	OutSample.ClearWidth = Cell.ClearWidth;
+	OutSample.SlopeDegrees = Cell.SlopeDegrees;
+	OutSample.bStairs = (Cell.Flags & Cell_Stairs) != 0;
+	OutSample.bBlocked = (Cell.Flags & Cell_Blocked) != 0;
+	OutSample.Deck = Cell.Deck;
+}
+
+// Cell graph
+FVector UNavMetadataSubsystem::GetCellLocation(int32 Index) const
+{
+	const FIntPoint& Column = CellColumns[Index];
+	return FVector((Column.X + 0.5f) * CellSize, (Column.Y + 0.5f) * CellSize, Cells[Index].Height);
+}
+
+void UNavMetadataSubsystem::GetCellNeighbours(int32 Index, TArray<int32>& OutNeighbours) const
+{
+	OutNeighbours.Reset();
+	if (!CellColumns.IsValidIndex(Index)) return;
+
+	const FIntPoint Offsets[] = {
+		FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1),
+		FIntPoint(1, 1), FIntPoint(1, -1), FIntPoint(-1, 1), FIntPoint(-1, -1),
+	};
+	const float MaxRise = CellSize * FMath::Tan(FMath::DegreesToRadians(StairMaxSlope + 10.f));
+	const FIntPoint& Column = CellColumns[Index];
+	const float Height = Cells[Index].Height;
+
+	for (const FIntPoint& Offset : Offsets)
+	{
+		const bool bDiagonal = Offset.X != 0 && Offset.Y != 0;
+
+		// No cutting across wall corners
+		if (bDiagonal && (!Columns.Contains(Column + FIntPoint(Offset.X, 0)) || !Columns.Contains(Column + FIntPoint(0, Offset.Y))))
+		{
+			continue;
+		}
+
+		const FIntPoint* Range = Columns.Find(Column + Offset);
+		if (!Range) continue;
+
+		// Same matching as BakeSlopes: the closest layer within a stair's rise is the same floor
+		int32 Best = INDEX_NONE;
+		float BestRise = bDiagonal ? MaxRise * UE_SQRT_2 : MaxRise;
+		for (int32 n = Range->X; n < Range->X + Range->Y; ++n)
+		{
+			const float Rise = FMath::Abs(Cells[n].Height - Height);
+			if (Rise < BestRise)
+			{
+				Best = n;
+				BestRise = Rise;
+			}
+		}
+
+		if (Best != INDEX_NONE)
+		{
+			OutNeighbours.Add(Best);
+		}
+	}
+}
+
+void UNavMetadataSubsystem::ForEachCellInBox(const FBox& Box, TFunctionRef<void(int32)> Callback) const
+{
+	const FIntPoint Min = GetColumn(Box.Min);
+	const FIntPoint Max = GetColumn(Box.Max);
+
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			const FIntPoint* Range = Columns.Find(FIntPoint(X, Y));
+			if (!Range) continue;
+
+			for (int32 i = Range->X; i < Range->X + Range->Y; ++i)
+			{
+				if (Cells[i].Height >= Box.Min.Z && Cells[i].Height <= Box.Max.Z)
+				{
+					Callback(i);
+				}
+			}
+		}
+	}
+}
+
+void UNavMetadataSubsystem::IndexColumns()
+{
+	CellColumns.SetNumUninitialized(Cells.Num());
+	for (const TPair<FIntPoint, FIntPoint>& Column : Columns)
+	{
+		for (int32 i = Column.Value.X; i < Column.Value.X + Column.Value.Y; ++i)
+		{
+			CellColumns[i] = Column.Key;
+		}
+	}
+}
+
+// Bake
+bool UNavMetadataSubsystem::Bake()
+{
+	ARecastNavMesh* NavMesh = GetNavMesh();
+	if (!NavMesh || NavMesh->GetNavMeshTilesCount() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("NavMetadata: no navmesh to bake from"));
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	UpdateCacheKey(*NavMesh);
+	Columns.Reset();
+	Cells.Reset();
+	CellColumns.Reset();
+	DeckFloors.Reset();
+
+	BakeColumns(*NavMesh);
+	IndexColumns();
+	BakeSlopes();
+	BakeDecks();
+
+	for (FCell& Cell : Cells)
+	{
+		Cell.ClearWidth = Cell.BakedWidth;
+	}
+	bBaked = Cells.Num() > 0;
+
+	// The cache holds the static bake only; obstacles are patched in at runtime
+	SaveCache(FPaths::ProjectSavedDir() / GetCacheName());
+
+	// Re-apply obstacles registered before the bake
+	FBox ObstacleRegion(ForceInit);
+	for (const TPair<TWeakObjectPtr<const UObject>, FBox>& Obstacle : Obstacles)
+	{
+		ObstacleRegion += Obstacle.Value;
+	}
+	if (ObstacleRegion.IsValid)
+	{
+		PatchRegion(ObstacleRegion.ExpandBy(FVector(MaxClearWidth * 0.5f, MaxClearWidth * 0.5f, 0.f)));
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("NavMetadata: baked %d columns, %d layers, %d decks in %.2f s"),
+		Columns.Num(), Cells.Num(), DeckFloors.Num(), FPlatformTime::Seconds() - StartTime);
+
+	if (bBaked)
+	{
+		OnBaked.Broadcast();
+	}
+	return bBaked;
+}
+
+void UNavMetadataSubsystem::BakeColumns(ARecastNavMesh& NavMesh)
+{
+	const FSharedConstNavQueryFilter Filter = NavMesh.GetDefaultQueryFilter();
+	const FIntPoint Min = GetColumn(NavBounds.Min);
+	const FIntPoint Max = GetColumn(NavBounds.Max);
+	const FVector ProjectExtent(CellSize * 0.25f, CellSize * 0.25f, 0.f);
+	const float HalfWidth = MaxClearWidth * 0.5f;
+
+	// Width is the narrowest of four crossings through the point, so corridors at 45 degrees are measured too
+	const FVector Axes[] = {
+		FVector(1.f, 0.f, 0.f),
+		FVector(0.f, 1.f, 0.f),
+		FVector(UE_INV_SQRT_2, UE_INV_SQRT_2, 0.f),
+		FVector(UE_INV_SQRT_2, -UE_INV_SQRT_2, 0.f),
+	};
+
+	TArray<FNavLocation> Locations;
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			const FVector Center((X + 0.5f) * CellSize, (Y + 0.5f) * CellSize, NavBounds.GetCenter().Z);
+
+			Locations.Reset();
+			if (!NavMesh.ProjectPointMulti(Center, Locations, ProjectExtent, NavBounds.Min.Z, NavBounds.Max.Z, Filter))
+			{
+				continue;
+			}
+
+			Locations.Sort([](const FNavLocation& A, const FNavLocation& B) { return A.Location.Z < B.Location.Z; });
+
+			const int32 FirstLayer = Cells.Num();
+			for (const FNavLocation& NavLocation : Locations)
+			{
+				// Neighbouring polys on the same floor project to nearly the same height
+				if (Cells.Num() > FirstLayer && NavLocation.Location.Z - Cells.Last().Height < 30.f)
+				{
+					continue;
+				}
+
+				float Width = MaxClearWidth;
+				for (const FVector& Axis : Axes)
+				{
+					float Across = 0.f;
+					for (const float Sign : { 1.f, -1.f })
+					{
+						FVector Hit;
+						const FVector End = NavLocation.Location + Axis * Sign * HalfWidth;
+						Across += NavMesh.Raycast(NavLocation.Location, End, Hit, Filter)
+							? FVector::Dist2D(NavLocation.Location, Hit)
+							: HalfWidth;
+					}
+					Width = FMath::Min(Width, Across);
+				}
+
+				FCell& Cell = Cells.AddDefaulted_GetRef();
+				Cell.Height = NavLocation.Location.Z;
+				Cell.BakedWidth = uint16(FMath::RoundToInt32(Width));
+			}
+
+			if (Cells.Num() > FirstLayer)
+			{
+				Columns.Add(FIntPoint(X, Y), FIntPoint(FirstLayer, Cells.Num() - FirstLayer));
+			}
+		}
+	}
+}
+
+void UNavMetadataSubsystem::BakeSlopes()
+{
+	// The navmesh over stairs is a ramp, so slope comes from the height change to the neighbouring columns
+	const FIntPoint Offsets[] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+	const float MaxRise = CellSize * FMath::Tan(FMath::DegreesToRadians(StairMaxSlope + 10.f));
+
+	for (const TPair<FIntPoint, FIntPoint>& Column : Columns)
+	{
+		for (int32 i = Column.Value.X; i < Column.Value.X + Column.Value.Y; ++i)
+		{
+			FCell& Cell = Cells[i];
+
+			float Rise = 0.f;
+			for (const FIntPoint& Offset : Offsets)
+			{
+				const FIntPoint* Neighbour = Columns.Find(Column.Key + Offset);
+				if (!Neighbour) continue;
+
+				// The neighbour's closest layer is the same floor; anything further is another deck
+				float Closest = MaxRise;
+				for (int32 n = Neighbour->X; n < Neighbour->X + Neighbour->Y; ++n)
+				{
+					Closest = FMath::Min(Closest, FMath::Abs(Cells[n].Height - Cell.Height));
+				}
+				if (Closest < MaxRise)
+				{
+					Rise = FMath::Max(Rise, Closest);
+				}
+			}
+
+			const float Slope = FMath::RadiansToDegrees(FMath::Atan(Rise / CellSize));
+			Cell.SlopeDegrees = uint8(FMath::Clamp(FMath::RoundToInt32(Slope), 0, 90));
+			if (Slope > StairMinSlope && Slope < StairMaxSlope)
+			{
+				Cell.Flags |= Cell_Stairs;
+			}
+		}
+	}
+}
+
+void UNavMetadataSubsystem::BakeDecks()
+{
+	TArray<float> FlatHeights;
+	for (const FCell& Cell : Cells)
+	{
+		if ((Cell.Flags & Cell_Stairs) == 0)
+		{
+			FlatHeights.Add(Cell.Height);
+		}
+	}
+	FlatHeights.Sort();
+
+	// Flat layers cluster by height; small clusters are furniture or landings, not decks
+	const int32 MinDeckCells = 100;
+	int32 ClusterStart = 0;
+	for (int32 i = 1; i <= FlatHeights.Num(); ++i)
+	{
+		if (i == FlatHeights.Num() || FlatHeights[i] - FlatHeights[i - 1] > MinDeckSeparation)
+		{
+			if (i - ClusterStart >= MinDeckCells)
+			{
+				DeckFloors.Add(FlatHeights[ClusterStart]);
+			}
+			ClusterStart = i;
+		}
+	}
+
+	for (FCell& Cell : Cells)
+	{
+		Cell.Deck = int16(GetDeckAt(Cell.Height));
+	}
+}
+
+int32 UNavMetadataSubsystem::GetDeckAt(float Height) const
+{
+	// Highest deck floor at or below the height; stairs belong to the deck they leave from
+	const int32 Index = Algo::UpperBound(DeckFloors, Height + MinDeckSeparation * 0.5f) - 1;
+	return FMath::Max(Index, 0);
+}
+
+// Dynamic obstacles
+void UNavMetadataSubsystem::UpdateObstacle(const UObject* Owner, const FBox& Bounds)
+{
+	FBox Region = Bounds;
+	if (const FBox* Previous = Obstacles.Find(Owner))
+	{
+		if (Previous->Equals(Bounds, 1.0)) return;
+		Region += *Previous;
+	}
+
+	Obstacles.Add(Owner, Bounds);
+	PatchRegion(Region.ExpandBy(FVector(MaxClearWidth * 0.5f, MaxClearWidth * 0.5f, 0.f)));
+}
+
+void UNavMetadataSubsystem::RemoveObstacle(const UObject* Owner)
+{
+	FBox Previous;
+	if (Obstacles.RemoveAndCopyValue(Owner, Previous))
+	{
+		PatchRegion(Previous.ExpandBy(FVector(MaxClearWidth * 0.5f, MaxClearWidth * 0.5f, 0.f)));
+	}
+}
+
+void UNavMetadataSubsystem::PatchRegion(const FBox& Region)
+{
+	if (!bBaked) return;
+
+	TArray<FBox2D> Footprints;
+	TArray<FVector2D> HeightRanges;
+	for (auto It = Obstacles.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		Footprints.Emplace(FVector2D(It->Value.Min), FVector2D(It->Value.Max));
+		HeightRanges.Emplace(It->Value.Min.Z - MaxLayerDistance, It->Value.Max.Z);
+	}
+
+	const float Reach = MaxClearWidth * 0.5f;
+	const FIntPoint Min = GetColumn(Region.Min);
+	const FIntPoint Max = GetColumn(Region.Max);
+
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			const FIntPoint* Range = Columns.Find(FIntPoint(X, Y));
+			if (!Range) continue;
+
+			const FVector2D Center((X + 0.5f) * CellSize, (Y + 0.5f) * CellSize);
+
+			for (int32 i = Range->X; i < Range->X + Range->Y; ++i)
+			{
+				FCell& Cell = Cells[i];
+				Cell.ClearWidth = Cell.BakedWidth;
+				Cell.Flags &= uint8(~Cell_Blocked);
+
+				for (int32 o = 0; o < Footprints.Num(); ++o)
+				{
+					if (Cell.Height < HeightRanges[o].X || Cell.Height > HeightRanges[o].Y) continue;
+
+					// Treat the obstacle as one wall of the passage: width shrinks to twice the distance to it
+					const float Distance = FMath::Sqrt(Footprints[o].ComputeSquaredDistanceToPoint(Center));
+					if (Distance <= 0.f)
+					{
+						Cell.Flags |= Cell_Blocked;
+						Cell.ClearWidth = 0;
+					}
+					else if (Distance < Reach)
+					{
+						Cell.ClearWidth = FMath::Min(Cell.ClearWidth, uint16(Distance * 2.f));
+					}
+				}
+			}
+		}
+	}
+}
+
+// Cache
+void UNavMetadataSubsystem::UpdateCacheKey(const ARecastNavMesh& NavMesh)
+{
+	NavBounds = NavMesh.GetNavMeshBounds();
+	NavTileCount = NavMesh.GetNavMeshTilesCount();
+
+	// Tiles sit in pool slots in the order they were added, so the per-tile CRCs are sorted before combining
+	TArray<uint32> TileCrcs;
+	if (const dtNavMesh* DetourMesh = NavMesh.GetRecastMesh())
+	{
+		for (int32 i = 0; i < DetourMesh->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* Tile = DetourMesh->getTile(i);
+			if (Tile && Tile->header && Tile->data && Tile->dataSize > 0)
+			{
+				TileCrcs.Add(FCrc::MemCrc32(Tile->data, Tile->dataSize));
+			}
+		}
+	}
+	TileCrcs.Sort();
+	NavDataCrc = FCrc::MemCrc32(TileCrcs.GetData(), TileCrcs.Num() * TileCrcs.GetTypeSize());
+}
+
+FString UNavMetadataSubsystem::GetCacheName() const
+{
+	return FString::Printf(TEXT("NavMetadata/%s.navmeta"), *UWorld::RemovePIEPrefix(GetWorld()->GetMapName()));
+}
+
+bool UNavMetadataSubsystem::LoadCache(const FString& FilePath)
+{
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Archive.IsValid()) return false;
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	float FileCellSize = 0.f;
+	float FileMaxWidth = 0.f;
+	float FileStairMinSlope = 0.f;
+	float FileStairMaxSlope = 0.f;
+	float FileDeckSeparation = 0.f;
+	float FileLayerDistance = 0.f;
+	FBox FileBounds(ForceInit);
+	int32 FileTileCount = 0;
+	uint32 FileNavDataCrc = 0;
+	*Archive << FileMagic << FileVersion;
+	if (Archive->IsError() || FileMagic != NavMetadata::Magic || FileVersion != NavMetadata::Version) return false;
+
+	*Archive << FileCellSize << FileMaxWidth << FileStairMinSlope << FileStairMaxSlope << FileDeckSeparation << FileLayerDistance;
+	*Archive << FileBounds << FileTileCount << FileNavDataCrc;
+
+	// Stale when the navmesh or the bake settings changed
+	if (Archive->IsError()
+		|| FileCellSize != CellSize || FileMaxWidth != MaxClearWidth
+		|| FileStairMinSlope != StairMinSlope || FileStairMaxSlope != StairMaxSlope
+		|| FileDeckSeparation != MinDeckSeparation || FileLayerDistance != MaxLayerDistance
+		|| FileTileCount != NavTileCount || !FileBounds.Equals(NavBounds, 1.0) || FileNavDataCrc != NavDataCrc)
+	{
+		UE_LOG(LogTemp, Log, TEXT("NavMetadata: %s does not match the navmesh or bake settings"), *FilePath);
+		return false;
+	}
+
+	*Archive << Columns << Cells << DeckFloors;
+	if (Archive->IsError())
+	{
+		Columns.Reset();
+		Cells.Reset();
+		DeckFloors.Reset();
+		return false;
+	}
+
+	// Only the static bake is stored; obstacles are patched in at runtime
+	for (FCell& Cell : Cells)
+	{
+		Cell.ClearWidth = Cell.BakedWidth;
+		Cell.Flags &= uint8(~Cell_Blocked);
+	}
+	IndexColumns();
+
+	UE_LOG(LogTemp, Log, TEXT("NavMetadata: loaded %d columns from %s"), Columns.Num(), *FilePath);
+	return Cells.Num() > 0;
+}
+
+bool UNavMetadataSubsystem::SaveCache(const FString& FilePath) const
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(FilePath), true);
+
+	TUniquePtr<FArchive> Archive(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Archive.IsValid()) return false;
+
+	uint32 FileMagic = NavMetadata::Magic;
+	uint32 FileVersion = NavMetadata::Version;
+	float FileCellSize = CellSize;
+	float FileMaxWidth = MaxClearWidth;
+	float FileStairMinSlope = StairMinSlope;
+	float FileStairMaxSlope = StairMaxSlope;
+	float FileDeckSeparation = MinDeckSeparation;
+	float FileLayerDistance = MaxLayerDistance;
+	FBox FileBounds = NavBounds;
+	int32 FileTileCount = NavTileCount;
+	uint32 FileNavDataCrc = NavDataCrc;
+	*Archive << FileMagic << FileVersion;
+	*Archive << FileCellSize << FileMaxWidth << FileStairMinSlope << FileStairMaxSlope << FileDeckSeparation << FileLayerDistance;
+	*Archive << FileBounds << FileTileCount << FileNavDataCrc;
+
+	TMap<FIntPoint, FIntPoint> ColumnsCopy = Columns;
+	TArray<FCell> CellsCopy = Cells;
+	TArray<float> DecksCopy = DeckFloors;
+	*Archive << ColumnsCopy << CellsCopy << DecksCopy;
+
+	return Archive->Close();
+}
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/NavQuerySubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+#include "Tasks/Task.h"
+
+bool UNavQuerySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNavQuerySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldTickHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UNavQuerySubsystem::OnWorldTickStart);
+}
+
+void UNavQuerySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(WorldTickHandle);
+
+	// Owners are going away with the world; finish reading but drop the callbacks
+	if (Batch.IsValid())
+	{
+		Batch.Wait();
+		Batch = {};
+	}
+	InFlight.Empty();
+	Queued.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UNavQuerySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNavQuerySubsystem, STATGROUP_Tickables);
+}
+
+// Requests
+void UNavQuerySubsystem::ProjectPoint(const UObject* Owner, const FVector& Point, const FVector& Extent, FNavQueryCallback&& Callback)
+{
+	SimulationPerf::AddCount(ESimPerfCounter::NavQueries);
+
+	FQuery& Query = Queued.AddDefaulted_GetRef();
+	Query.Owner = Owner;
+	Query.Callback = MoveTemp(Callback);
+	Query.Start = Point;
+	Query.End = Extent;
+}
+
+void UNavQuerySubsystem::Raycast(const UObject* Owner, const FVector& Start, const FVector& End, FNavQueryCallback&& Callback)
+{
+	SimulationPerf::AddCount(ESimPerfCounter::NavQueries);
+
+	FQuery& Query = Queued.AddDefaulted_GetRef();
+	Query.Owner = Owner;
+	Query.Callback = MoveTemp(Callback);
+	Query.bRaycast = true;
+	Query.Start = Start;
+	Query.End = End;
+}
+
+// Batches
+void UNavQuerySubsystem::Tick(float DeltaTime)
+{
+	// Normally already joined at the start of this world tick
+	CompleteBatch();
+	LaunchBatch();
+}
+
+void UNavQuerySubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime)
+{
+	if (World == GetWorld())
+	{
+		CompleteBatch();
+	}
+}
+
+void UNavQuerySubsystem::LaunchBatch()
+{
+	if (Queued.Num() == 0) return;
+
+	InFlight = MoveTemp(Queued);
+	Queued.Reset();
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance() : nullptr;
+	FSharedConstNavQueryFilter Filter = NavData ? NavData->GetDefaultQueryFilter() : nullptr;
+	const FVector DefaultExtent = NavData ? NavData->GetConfig().DefaultQueryExtent : FVector::ZeroVector;
+	const int32 BlockSize = FMath::Max(BatchSize, 1);
+
+	Batch = UE::Tasks::Launch(TEXT("NavQueryBatch"), [this, NavData, Filter, DefaultExtent, BlockSize]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		if (!NavData) return 0.0;
+
+		const int32 NumBlocks = FMath::DivideAndRoundUp(InFlight.Num(), BlockSize);
+		ParallelFor(TEXT("NavQueryBlock"), NumBlocks, 1, [this, NavData, &Filter, &DefaultExtent, BlockSize](int32 Block)
+		{
+			const int32 End = FMath::Min((Block + 1) * BlockSize, InFlight.Num());
+			for (int32 i = Block * BlockSize; i < End; ++i)
+			{
+				FQuery& Query = InFlight[i];
+				if (Query.bRaycast)
+				{
+					// Raycast returns true when the ray is blocked before its end
+					Query.Result.bSuccess = NavData->Raycast(Query.Start, Query.End, Query.Result.Location, Filter);
+					if (!Query.Result.bSuccess)
+					{
+						Query.Result.Location = Query.End;
+					}
+				}
+				else
+				{
+					FNavLocation Projected;
+					const FVector Extent = FNavigationSystem::IsValidExtent(Query.End) ? Query.End : DefaultExtent;
+					Query.Result.bSuccess = NavData->ProjectPoint(Query.Start, Projected, Extent, Filter);
+					Query.Result.Location = Projected.Location;
+				}
+			}
+		});
+
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	});
+}
+
+void UNavQuerySubsystem::CompleteBatch()
+{
+	if (!Batch.IsValid()) return;
+
+	Batch.Wait();
+	LastBatchMs = float(Batch.GetResult());
+	LastBatchSize = InFlight.Num();
+	Batch = {};
+
+	// Callbacks may queue follow-up queries for the next batch
+	TArray<FQuery> Completed = MoveTemp(InFlight);
+	InFlight.Reset();
+
+	SIM_SCOPE_CYCLE_COUNTER(NavQueryCallbacks);
+	for (FQuery& Query : Completed)
+	{
+		if (Query.Owner.IsValid() && Query.Callback)
+		{
+			Query.Callback(Query.Result);
+		}
+	}
+}
@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Navigation/NavUpdateSchedulerSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/PlatformTime.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "NavModifierComponent.h"
+
+DECLARE_STATS_GROUP(TEXT("NavUpdates"), STATGROUP_NavUpdates, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued requests"), STAT_NavUpdates_QueueDepth, STATGROUP_NavUpdates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending tile builds"), STAT_NavUpdates_TileBuilds, STATGROUP_NavUpdates);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Submitted"), STAT_NavUpdates_Submitted, STATGROUP_NavUpdates);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dropped"), STAT_NavUpdates_Dropped, STATGROUP_NavUpdates);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Submit time (ms)"), STAT_NavUpdates_SubmitMs, STATGROUP_NavUpdates);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last rebuild (ms)"), STAT_NavUpdates_RebuildMs, STATGROUP_NavUpdates);
+
+bool UNavUpdateSchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UNavUpdateSchedulerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld))
+	{
+		NavSys->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &UNavUpdateSchedulerSubsystem::OnNavigationGenerationFinished);
+	}
+}
+
+void UNavUpdateSchedulerSubsystem::Deinitialize()
+{
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UNavUpdateSchedulerSubsystem::OnNavigationGenerationFinished);
+	}
+
+	Pending.Empty();
+	Deferred.Empty();
+	SubmittedBounds.Empty();
+	AppliedAreas.Empty();
+	OnAreaSubmitted.Clear();
+
+	Super::Deinitialize();
+}
+
+TStatId UNavUpdateSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNavUpdateSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+// Requests
+void UNavUpdateSchedulerSubsystem::RequestBoundsUpdate(UPrimitiveComponent* Component, bool bForce)
+{
+	if (!Component) return;
+
+	const FBox NewBounds = Component->Bounds.GetBox();
+	const FBox* Submitted = SubmittedBounds.Find(Component);
+
+	if (Submitted && !bForce)
+	{
+		const FVector MinDelta = (NewBounds.Min - Submitted->Min).GetAbs();
+		const FVector MaxDelta = (NewBounds.Max - Submitted->Max).GetAbs();
+		if (FMath::Max(MinDelta.GetMax(), MaxDelta.GetMax()) < MinBoundsChange)
+		{
+			// Counted once per deferral; the latest bounds are read when it is submitted
+			const double Now = GetWorld()->GetTimeSeconds();
+			if (FVector2D* Times = Deferred.Find(Component))
+			{
+				Times->Y = Now;
+			}
+			else
+			{
+				Deferred.Add(Component, FVector2D(Now, Now));
+				NumDropped++;
+				INC_DWORD_STAT(STAT_NavUpdates_Dropped);
+			}
+			return;
+		}
+	}
+
+	Deferred.Remove(Component);
+	QueueBoundsUpdate(Component);
+}
+
+void UNavUpdateSchedulerSubsystem::QueueBoundsUpdate(UPrimitiveComponent* Component)
+{
+	const FBox NewBounds = Component->Bounds.GetBox();
+	const FBox* Submitted = SubmittedBounds.Find(Component);
+
+	// Old and new bounds are both dirty
+	FRequest& Request = Pending.FindOrAdd(Component);
+	Request.Component = Component;
+	Request.DirtyBounds = Submitted ? *Submitted + NewBounds : NewBounds;
+}
+
+void UNavUpdateSchedulerSubsystem::PromoteDeferred()
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (auto It = Deferred.CreateIterator(); It; ++It)
+	{
+		UPrimitiveComponent* Component = It->Key.Get();
+		if (!Component)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const FVector2D& Times = It->Value;
+		if (Now - Times.Y >= BoundsSettleTime || Now - Times.X >= MaxBoundsDelay)
+		{
+			QueueBoundsUpdate(Component);
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UNavUpdateSchedulerSubsystem::RequestAreaChange(UNavModifierComponent* Modifier, TSubclassOf<UNavArea> AreaClass)
+{
+	if (!Modifier) return;
+
+	const TSubclassOf<UNavArea>* Applied = AppliedAreas.Find(Modifier);
+	const TSubclassOf<UNavArea> CurrentArea = Applied ? *Applied : Modifier->AreaClass;
+
+	// Flipped back before it was submitted
+	if (CurrentArea == AreaClass)
+	{
+		if (Pending.Remove(Modifier) > 0)
+		{
+			NumDropped++;
+			INC_DWORD_STAT(STAT_NavUpdates_Dropped);
+		}
+		return;
+	}
+
+	FRequest& Request = Pending.FindOrAdd(Modifier);
+	Request.Component = Modifier;
+	Request.bAreaChange = true;
+	Request.AreaClass = AreaClass;
+	if (const AActor* Owner = Modifier->GetOwner())
+	{
+		Request.DirtyBounds = Owner->GetComponentsBoundingBox(true);
+	}
+}
+
+// Tick
+void UNavUpdateSchedulerSubsystem::Tick(float DeltaTime)
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const int32 TileBuilds = NavSys ? NavSys->GetNumRemainingBuildTasks() : 0;
+
+	PromoteDeferred();
+
+	SET_DWORD_STAT(STAT_NavUpdates_QueueDepth, Pending.Num());
+	SET_DWORD_STAT(STAT_NavUpdates_TileBuilds, TileBuilds);
+
+	if (!NavSys || Pending.Num() == 0) return;
+
+	// Let the worker threads catch up before dirtying more tiles
+	if (TileBuilds > MaxPendingTileBuilds) return;
+
+	SIM_SCOPE_CYCLE_COUNTER(NavUpdateSubmit);
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<FRequest> Requests;
+	Requests.Reserve(Pending.Num());
+	for (const TPair<TWeakObjectPtr<UActorComponent>, FRequest>& Pair : Pending)
+	{
+		if (Pair.Key.IsValid())
+		{
+			Requests.Add(Pair.Value);
+		}
+	}
+	Pending.Reset();
+
+	// Group requests whose tile-aligned dirty areas overlap
+	const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate));
+	const float TileSize = NavMesh ? NavMesh->GetTileSizeUU() : 1000.f;
+
+	TArray<FBox2D> TileBounds;
+	TArray<int32> Group;
+	for (int32 i = 0; i < Requests.Num(); ++i)
+	{
+		// Inset slightly so neighbouring tiles that only share an edge do not merge
+		const FBox& Dirty = Requests[i].DirtyBounds;
+		TileBounds.Add(FBox2D(
+			FVector2D(FMath::FloorToDouble(Dirty.Min.X / TileSize), FMath::FloorToDouble(Dirty.Min.Y / TileSize)) * TileSize,
+			FVector2D(FMath::CeilToDouble(Dirty.Max.X / TileSize), FMath::CeilToDouble(Dirty.Max.Y / TileSize)) * TileSize).ExpandBy(-1.0));
+		Group.Add(i);
+	}
+
+	auto FindRoot = [&Group](int32 i)
+	{
+		while (Group[i] != i)
+		{
+			i = Group[i] = Group[Group[i]];
+		}
+		return i;
+	};
+
+	for (int32 i = 0; i < Requests.Num(); ++i)
+	{
+		for (int32 j = i + 1; j < Requests.Num(); ++j)
+		{
+			if (TileBounds[i].Intersect(TileBounds[j]))
+			{
+				const int32 A = FindRoot(i);
+				const int32 B = FindRoot(j);
+				Group[FMath::Max(A, B)] = FMath::Min(A, B);
+			}
+		}
+	}
+
+	for (int32 i = 0; i < Requests.Num(); ++i)
+	{
+		Group[i] = FindRoot(i);
+	}
+
+	// Submit whole groups until the budget is spent; the rest waits for the next frame
+	bool bBudgetSpent = false;
+	for (int32 Root = 0; Root < Requests.Num(); ++Root)
+	{
+		if (Group[Root] != Root) continue;
+
+		for (int32 i = Root; i < Requests.Num(); ++i)
+		{
+			if (Group[i] != Root) continue;
+
+			if (bBudgetSpent)
+			{
+				Pending.Add(Requests[i].Component, Requests[i]);
+			}
+			else
+			{
+				Submit(Requests[i]);
+			}
+		}
+
+		bBudgetSpent = bBudgetSpent || (FPlatformTime::Seconds() - StartTime) * 1000.0 > FrameBudgetMs;
+	}
+
+	if (RebuildStartTime == 0.0)
+	{
+		RebuildStartTime = StartTime;
+	}
+
+	LastSubmitMs = float((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	SET_FLOAT_STAT(STAT_NavUpdates_SubmitMs, LastSubmitMs);
+}
+
+void UNavUpdateSchedulerSubsystem::Submit(const FRequest& Request)
+{
+	UActorComponent* Component = Request.Component.Get();
+	if (!Component) return;
+
+	const AActor* Owner = Component->GetOwner();
+
+	if (Request.bAreaChange)
+	{
+		UNavModifierComponent* Modifier = CastChecked<UNavModifierComponent>(Component);
+		Modifier->SetAreaClass(Request.AreaClass);
+		AppliedAreas.Add(Component, Request.AreaClass);
+
+		OnAreaSubmitted.Broadcast(Owner, Request.DirtyBounds, Request.AreaClass);
+	}
+	else if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		NavSys->UpdateComponentInNavOctree(*Component);
+
+		const FBox Bounds = CastChecked<UPrimitiveComponent>(Component)->Bounds.GetBox();
+		SubmittedBounds.Add(Component, Bounds);
+
+		// Moving volumes such as fires carry their area with them
+		if (UNavModifierComponent* Modifier = Owner ? Owner->FindComponentByClass<UNavModifierComponent>() : nullptr)
+		{
+			const TSubclassOf<UNavArea>* Applied = AppliedAreas.Find(Modifier);
+			OnAreaSubmitted.Broadcast(Owner, Bounds, Applied ? *Applied : Modifier->AreaClass);
+		}
+	}
+
+	NumSubmitted++;
+	INC_DWORD_STAT(STAT_NavUpdates_Submitted);
+	SimulationPerf::AddCount(ESimPerfCounter::RebuildsRequested);
+}
+
+void UNavUpdateSchedulerSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	if (RebuildStartTime == 0.0) return;
+
+	LastRebuildMs = float((FPlatformTime::Seconds() - RebuildStartTime) * 1000.0);
+	RebuildStartTime = 0.0;
+	SET_FLOAT_STAT(STAT_NavUpdates_RebuildMs, LastRebuildMs);
+}
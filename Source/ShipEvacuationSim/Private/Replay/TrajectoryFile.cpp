@@ -0,0 +1,432 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/TrajectoryFile.h"
+#include "Algo/BinarySearch.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	// Magic, Version, SampleInterval
+	constexpr int64 FileHeaderSize = 12;
+
+	// ChunkMagic, NumFrames, StartTime, EndTime, UncompressedSize, CompressedSize
+	constexpr int64 ChunkHeaderSize = 32;
+
+	// NumChunks, IndexOffset, FooterMagic
+	constexpr int64 FooterSize = 16;
+
+	// Offset, NumFrames, StartTime, EndTime
+	constexpr int64 IndexEntrySize = 28;
+
+	struct FQuantizedSample
+	{
+		int32 X = 0;
+		int32 Y = 0;
+		int32 Z = 0;
+		int32 Speed = 0;
+		int32 Deck = 0;
+	};
+
+	void WriteVarUInt(TArray<uint8>& Out, uint64 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(uint8(Value) | 0x80);
+			Value >>= 7;
+		}
+		Out.Add(uint8(Value));
+	}
+
+	void WriteVarInt(TArray<uint8>& Out, int64 Value)
+	{
+		WriteVarUInt(Out, (uint64(Value) << 1) ^ uint64(Value >> 63));
+	}
+
+	bool ReadVarUInt(const uint8*& Cursor, const uint8* End, uint64& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 64 && Cursor < End; Shift += 7)
+		{
+			const uint8 Byte = *Cursor++;
+			OutValue |= uint64(Byte & 0x7F) << Shift;
+			if ((Byte & 0x80) == 0) return true;
+		}
+		return false;
+	}
+
+	bool ReadVarInt(const uint8*& Cursor, const uint8* End, int64& OutValue)
+	{
+		uint64 Encoded = 0;
+		if (!ReadVarUInt(Cursor, End, Encoded)) return false;
+		OutValue = int64(Encoded >> 1) ^ -int64(Encoded & 1);
+		return true;
+	}
+}
+
+// Encoding
+void TrajectoryFile::EncodeFrames(const TArray<FTrajectoryFrame>& Frames, double StartTime, TArray<uint8>& OutPayload)
+{
+	OutPayload.Reset();
+
+	// Deltas restart in every chunk so chunks decode on their own
+	TMap<int32, FQuantizedSample> Previous;
+	int64 PreviousMs = 0;
+
+	for (const FTrajectoryFrame& Frame : Frames)
+	{
+		const int64 Ms = FMath::RoundToInt64((Frame.Time - StartTime) * 1000.0);
+		WriteVarInt(OutPayload, Ms - PreviousMs);
+		PreviousMs = Ms;
+
+		WriteVarUInt(OutPayload, Frame.Samples.Num());
+
+		int32 PreviousId = 0;
+		for (const FTrajectorySample& Sample : Frame.Samples)
+		{
+			FQuantizedSample Quantized;
+			Quantized.X = FMath::RoundToInt32(Sample.Location.X);
+			Quantized.Y = FMath::RoundToInt32(Sample.Location.Y);
+			Quantized.Z = FMath::RoundToInt32(Sample.Location.Z);
+			Quantized.Speed = FMath::RoundToInt32(Sample.Speed);
+			Quantized.Deck = Sample.Deck;
+
+			FQuantizedSample& Last = Previous.FindOrAdd(Sample.AgentId);
+
+			WriteVarInt(OutPayload, int64(Sample.AgentId) - PreviousId);
+			WriteVarInt(OutPayload, Quantized.X - Last.X);
+			WriteVarInt(OutPayload, Quantized.Y - Last.Y);
+			WriteVarInt(OutPayload, Quantized.Z - Last.Z);
+			WriteVarInt(OutPayload, Quantized.Speed - Last.Speed);
+			WriteVarInt(OutPayload, Quantized.Deck - Last.Deck);
+			OutPayload.Add(uint8(Sample.State));
+
+			Last = Quantized;
+			PreviousId = Sample.AgentId;
+		}
+	}
+}
+
+bool TrajectoryFile::DecodeFrames(const TArray<uint8>& Payload, int32 NumFrames, double StartTime, TArray<FTrajectoryFrame>& OutFrames)
+{
+	OutFrames.Reset(NumFrames);
+
+	const uint8* Cursor = Payload.GetData();
+	const uint8* End = Cursor + Payload.Num();
+
+	TMap<int32, FQuantizedSample> Previous;
+	int64 Ms = 0;
+
+	for (int32 f = 0; f < NumFrames; ++f)
+	{
+		int64 DeltaMs = 0;
+		uint64 NumSamples = 0;
+		if (!ReadVarInt(Cursor, End, DeltaMs) || !ReadVarUInt(Cursor, End, NumSamples)) return false;
+
+		Ms += DeltaMs;
+
+		FTrajectoryFrame& Frame = OutFrames.AddDefaulted_GetRef();
+		Frame.Time = StartTime + Ms / 1000.0;
+		Frame.Samples.SetNum(int32(NumSamples));
+
+		int64 Id = 0;
+		for (FTrajectorySample& Sample : Frame.Samples)
+		{
+			int64 DeltaId, DX, DY, DZ, DSpeed, DDeck;
+			if (!ReadVarInt(Cursor, End, DeltaId) || !ReadVarInt(Cursor, End, DX) || !ReadVarInt(Cursor, End, DY)
+				|| !ReadVarInt(Cursor, End, DZ) || !ReadVarInt(Cursor, End, DSpeed) || !ReadVarInt(Cursor, End, DDeck)
+				|| Cursor >= End)
+			{
+				return false;
+			}
+
+			Id += DeltaId;
+			FQuantizedSample& Last = Previous.FindOrAdd(int32(Id));
+			Last.X += int32(DX);
+			Last.Y += int32(DY);
+			Last.Z += int32(DZ);
+			Last.Speed += int32(DSpeed);
+			Last.Deck += int32(DDeck);
+
+			Sample.AgentId = int32(Id);
+			Sample.Location = FVector3f(Last.X, Last.Y, Last.Z);
+			Sample.Speed = Last.Speed;
+			Sample.Deck = Last.Deck;
+			Sample.State = ETrajectoryAgentState(*Cursor++);
+		}
+	}
+
+	return true;
+}
+
+// Writer
+FTrajectoryWriter::~FTrajectoryWriter()
+{
+	Close();
+}
+
+bool FTrajectoryWriter::Open(const FString& FilePath, float SampleInterval)
+{
+	Close();
+
+	Handle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FilePath));
+	if (!Handle.IsValid())
+	{
+		return false;
+	}
+
+	TArray<uint8> Header;
+	FMemoryWriter Ar(Header);
+	uint32 Magic = TrajectoryFile::Magic;
+	uint32 Version = TrajectoryFile::Version;
+	Ar << Magic << Version << SampleInterval;
+	return Handle->Write(Header.GetData(), Header.Num());
+}
+
+void FTrajectoryWriter::Close()
+{
+	if (!Handle.IsValid()) return;
+
+	TArray<uint8> Footer;
+	FMemoryWriter Ar(Footer);
+	int64 IndexOffset = Handle->Tell();
+	for (TrajectoryFile::FChunkInfo& Chunk : Chunks)
+	{
+		Ar << Chunk.Offset << Chunk.NumFrames << Chunk.StartTime << Chunk.EndTime;
+	}
+	int32 NumChunks = Chunks.Num();
+	uint32 FooterMagic = TrajectoryFile::FooterMagic;
+	Ar << NumChunks << IndexOffset << FooterMagic;
+
+	Handle->Write(Footer.GetData(), Footer.Num());
+	Handle->Flush();
+	Handle.Reset();
+	Chunks.Reset();
+}
+
+void FTrajectoryWriter::WriteChunk(const TArray<FTrajectoryFrame>& Frames)
+{
+	if (!Handle.IsValid() || Frames.Num() == 0) return;
+
+	TrajectoryFile::FChunkInfo Info;
+	Info.Offset = Handle->Tell();
+	Info.NumFrames = Frames.Num();
+	Info.StartTime = Frames[0].Time;
+	Info.EndTime = Frames.Last().Time;
+
+	TArray<uint8> Payload;
+	TrajectoryFile::EncodeFrames(Frames, Info.StartTime, Payload);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Payload.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Payload.GetData(), Payload.Num()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("TrajectoryWriter: failed to compress a chunk of %d frames"), Frames.Num());
+		return;
+	}
+
+	TArray<uint8> Header;
+	FMemoryWriter Ar(Header);
+	uint32 ChunkMagic = TrajectoryFile::ChunkMagic;
+	int32 UncompressedSize = Payload.Num();
+	Ar << ChunkMagic << Info.NumFrames << Info.StartTime << Info.EndTime << UncompressedSize << CompressedSize;
+
+	Handle->Write(Header.GetData(), Header.Num());
+	Handle->Write(Compressed.GetData(), CompressedSize);
+	Chunks.Add(Info);
+}
+
+// Reader
+FTrajectoryReader::~FTrajectoryReader()
+{
+	Close();
+}
+
+bool FTrajectoryReader::Open(const FString& FilePath)
+{
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FileSize = PlatformFile.FileSize(*FilePath);
+	if (FileSize < FileHeaderSize)
+	{
+		return false;
+	}
+
+	MappedHandle.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (MappedHandle.IsValid())
+	{
+		MappedRegion.Reset(MappedHandle->MapRegion(0, FileSize));
+	}
+	if (!MappedRegion.IsValid())
+	{
+		MappedHandle.Reset();
+		Handle.Reset(PlatformFile.OpenRead(*FilePath));
+		if (!Handle.IsValid())
+		{
+			return false;
+		}
+	}
+
+	TArray<uint8> Header;
+	Header.SetNumUninitialized(FileHeaderSize);
+	if (!ReadBytes(0, Header.GetData(), FileHeaderSize))
+	{
+		Close();
+		return false;
+	}
+
+	FMemoryReader Ar(Header);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Ar << Magic << Version << SampleInterval;
+	if (Magic != TrajectoryFile::Magic || Version != TrajectoryFile::Version)
+	{
+		Close();
+		return false;
+	}
+
+	if (!ReadIndex())
+	{
+		ScanChunks(FileHeaderSize);
+	}
+	return true;
+}
+
+void FTrajectoryReader::Close()
+{
+	MappedRegion.Reset();
+	MappedHandle.Reset();
+	Handle.Reset();
+	FileSize = 0;
+	Chunks.Reset();
+}
+
+bool FTrajectoryReader::ReadBytes(int64 Offset, void* Dest, int64 Size) const
+{
+	if (Offset < 0 || Size < 0 || Offset + Size > FileSize) return false;
+
+	if (MappedRegion.IsValid())
+	{
+		FMemory::Memcpy(Dest, MappedRegion->GetMappedPtr() + Offset, Size);
+		return true;
+	}
+
+	return Handle.IsValid() && Handle->Seek(Offset) && Handle->Read(static_cast<uint8*>(Dest), Size);
+}
+
+bool FTrajectoryReader::ReadIndex()
+{
+	if (FileSize < FileHeaderSize + FooterSize) return false;
+
+	TArray<uint8> Footer;
+	Footer.SetNumUninitialized(FooterSize);
+	if (!ReadBytes(FileSize - FooterSize, Footer.GetData(), FooterSize)) return false;
+
+	FMemoryReader FooterAr(Footer);
+	int32 NumChunks = 0;
+	int64 IndexOffset = 0;
+	uint32 FooterMagic = 0;
+	FooterAr << NumChunks << IndexOffset << FooterMagic;
+	if (FooterMagic != TrajectoryFile::FooterMagic || NumChunks < 0
+		|| IndexOffset + NumChunks * IndexEntrySize != FileSize - FooterSize)
+	{
+		return false;
+	}
+
+	TArray<uint8> Index;
+	Index.SetNumUninitialized(NumChunks * IndexEntrySize);
+	if (!ReadBytes(IndexOffset, Index.GetData(), Index.Num())) return false;
+
+	FMemoryReader IndexAr(Index);
+	Chunks.SetNum(NumChunks);
+	for (TrajectoryFile::FChunkInfo& Chunk : Chunks)
+	{
+		IndexAr << Chunk.Offset << Chunk.NumFrames << Chunk.StartTime << Chunk.EndTime;
+	}
+	return true;
+}
+
+void FTrajectoryReader::ScanChunks(int64 Offset)
+{
+	// No footer: walk the chunk headers and stop at the first incomplete chunk
+	TArray<uint8> Header;
+	Header.SetNumUninitialized(ChunkHeaderSize);
+
+	while (ReadBytes(Offset, Header.GetData(), ChunkHeaderSize))
+	{
+		FMemoryReader Ar(Header);
+		uint32 ChunkMagic = 0;
+		int32 UncompressedSize = 0;
+		int32 CompressedSize = 0;
+		TrajectoryFile::FChunkInfo Chunk;
+		Ar << ChunkMagic << Chunk.NumFrames << Chunk.StartTime << Chunk.EndTime << UncompressedSize << CompressedSize;
+
+		if (ChunkMagic != TrajectoryFile::ChunkMagic || CompressedSize < 0 || Offset + ChunkHeaderSize + CompressedSize > FileSize)
+		{
+			break;
+		}
+
+		Chunk.Offset = Offset;
+		Chunks.Add(Chunk);
+		Offset += ChunkHeaderSize + CompressedSize;
+	}
+}
+
+double FTrajectoryReader::GetStartTime() const
+{
+	return Chunks.Num() > 0 ? Chunks[0].StartTime : 0.0;
+}
+
+double FTrajectoryReader::GetEndTime() const
+{
+	return Chunks.Num() > 0 ? Chunks.Last().EndTime : 0.0;
+}
+
+int32 FTrajectoryReader::FindChunk(double Time) const
+{
+	if (Chunks.Num() == 0) return INDEX_NONE;
+
+	// Last chunk starting at or before Time
+	const int32 Index = Algo::UpperBoundBy(Chunks, Time, &TrajectoryFile::FChunkInfo::StartTime) - 1;
+	return FMath::Clamp(Index, 0, Chunks.Num() - 1);
+}
+
+bool FTrajectoryReader::ReadChunk(int32 Index, TArray<FTrajectoryFrame>& OutFrames) const
+{
+	if (!Chunks.IsValidIndex(Index)) return false;
+
+	const TrajectoryFile::FChunkInfo& Chunk = Chunks[Index];
+
+	TArray<uint8> Header;
+	Header.SetNumUninitialized(ChunkHeaderSize);
+	if (!ReadBytes(Chunk.Offset, Header.GetData(), ChunkHeaderSize)) return false;
+
+	FMemoryReader Ar(Header);
+	uint32 ChunkMagic = 0;
+	int32 NumFrames = 0;
+	double StartTime = 0.0;
+	double EndTime = 0.0;
+	int32 UncompressedSize = 0;
+	int32 CompressedSize = 0;
+	Ar << ChunkMagic << NumFrames << StartTime << EndTime << UncompressedSize << CompressedSize;
+	if (ChunkMagic != TrajectoryFile::ChunkMagic || UncompressedSize < 0 || CompressedSize < 0) return false;
+
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!ReadBytes(Chunk.Offset + ChunkHeaderSize, Compressed.GetData(), CompressedSize)) return false;
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(NAME_Zlib, Payload.GetData(), UncompressedSize, Compressed.GetData(), CompressedSize))
+	{
+		return false;
+	}
+
+	return TrajectoryFile::DecodeFrames(Payload, NumFrames, StartTime, OutFrames);
+}
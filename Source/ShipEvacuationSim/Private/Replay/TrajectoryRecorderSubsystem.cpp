@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/TrajectoryRecorderSubsystem.h"
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Crowd/ProxyCrowdSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "AICharacter.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "TimerManager.h"
+
+void UTrajectoryRecorderSubsystem::Deinitialize()
+{
+	EndRecording();
+	Super::Deinitialize();
+}
+
+void UTrajectoryRecorderSubsystem::BeginRecording(const FString& FilePath)
+{
+	EndRecording();
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(FilePath), true);
+
+	const float SampleInterval = 1.0f / FMath::Max(SampleRate, 0.01f);
+
+	Writer = MakeShared<FTrajectoryWriter>();
+	if (!Writer->Open(FilePath, SampleInterval))
+	{
+		UE_LOG(LogTemp, Error, TEXT("TrajectoryRecorder: could not open %s"), *FilePath);
+		Writer.Reset();
+		return;
+	}
+
+	RecordingStartTime = GetWorld()->GetTimeSeconds();
+	PendingFrames.Reset();
+
+	Sample();
+	GetWorld()->GetTimerManager().SetTimer(SampleTimer, this, &UTrajectoryRecorderSubsystem::Sample, SampleInterval, true);
+}
+
+void UTrajectoryRecorderSubsystem::EndRecording()
+{
+	if (!Writer.IsValid()) return;
+
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(SampleTimer);
+	}
+
+	FlushChunk();
+
+	LastWrite = WritePipe.Launch(TEXT("CloseTrajectory"), [Writer = MoveTemp(Writer)]()
+	{
+		Writer->Close();
+	});
+	LastWrite.Wait();
+	LastWrite = {};
+}
+
+void UTrajectoryRecorderSubsystem::Sample()
+{
+	const UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>();
+	if (!Crowd) return;
+
+	FTrajectoryFrame& Frame = PendingFrames.AddDefaulted_GetRef();
+	Frame.Time = GetWorld()->GetTimeSeconds() - RecordingStartTime;
+	Frame.Samples.Reserve(Crowd->GetNumAgents());
+
+	const UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>();
+
+	Crowd->ForEachAgent([this, &Frame, NavMeta](const AAiCharacter* Agent)
+	{
+		FTrajectorySample& Sample = Frame.Samples.AddDefaulted_GetRef();
+		const FVector Location = Agent->GetActorLocation();
+
+		Sample.AgentId = Agent->GetUniqueID();
+		Sample.Location = FVector3f(Location);
+		Sample.Speed = Agent->GetVelocity().Size();
+
+		// Baked deck ids when the map has them, height bands otherwise
+		FNavMetadataSample Meta;
+		Sample.Deck = NavMeta && NavMeta->Lookup(Agent->GetNavAgentLocation(), Meta)
+			? Meta.Deck
+			: FMath::FloorToInt32((Location.Z - DeckBaseZ) / DeckHeight);
+
+		if (Agent->bHasMustered) Sample.State |= ETrajectoryAgentState::Mustered;
+		if (Agent->IsCapsuleShrunk()) Sample.State |= ETrajectoryAgentState::Stuck;
+		if (Agent->IsRecovering()) Sample.State |= ETrajectoryAgentState::Recovering;
+		if (Agent->IsOnStairs()) Sample.State |= ETrajectoryAgentState::OnStairs;
+	});
+
+	if (const UProxyCrowdSubsystem* Proxies = GetWorld()->GetSubsystem<UProxyCrowdSubsystem>())
+	{
+		const FProxyAgents& Agents = Proxies->GetAgents();
+		for (int32 i = 0; i < Agents.Num(); ++i)
+		{
+			FTrajectorySample& Sample = Frame.Samples.AddDefaulted_GetRef();
+			const FVector Location = Agents.Location[i] + FVector(0.f, 0.f, Proxies->AgentHalfHeight);
+
+			Sample.AgentId = UProxyCrowdSubsystem::FirstAgentId + i;
+			Sample.Location = FVector3f(Location);
+			Sample.Speed = Agents.Velocity[i].Size();
+			Sample.State = Agents.State[i];
+
+			FNavMetadataSample Meta;
+			Sample.Deck = NavMeta && NavMeta->Lookup(Agents.Location[i], Meta)
+				? Meta.Deck
+				: FMath::FloorToInt32((Location.Z - DeckBaseZ) / DeckHeight);
+		}
+	}
+
+	// Sorted ids keep the id deltas small and let replay merge frames in one pass
+	Frame.Samples.Sort([](const FTrajectorySample& A, const FTrajectorySample& B) { return A.AgentId < B.AgentId; });
+
+	if (PendingFrames.Num() >= FramesPerChunk)
+	{
+		FlushChunk();
+	}
+}
+
+void UTrajectoryRecorderSubsystem::FlushChunk()
+{
+	if (PendingFrames.Num() == 0) return;
+
+	LastWrite = WritePipe.Launch(TEXT("WriteTrajectoryChunk"), [Writer = Writer, Frames = MoveTemp(PendingFrames)]()
+	{
+		Writer->WriteChunk(Frames);
+	});
+	PendingFrames.Reset();
+}
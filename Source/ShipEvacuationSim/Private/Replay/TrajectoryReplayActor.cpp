@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/TrajectoryReplayActor.h"
+#include "Algo/BinarySearch.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "UObject/ConstructorHelpers.h"
+
+ATrajectoryReplayActor::ATrajectoryReplayActor()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	Instances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Instances"));
+	SetRootComponent(Instances);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->NumCustomDataFloats = 2;
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> CylinderMesh(TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+	if (CylinderMesh.Succeeded())
+	{
+		Instances->SetStaticMesh(CylinderMesh.Object);
+	}
+}
+
+void ATrajectoryReplayActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!FilePath.IsEmpty())
+	{
+		LoadRecording(FilePath);
+	}
+}
+
+bool ATrajectoryReplayActor::LoadRecording(const FString& InFilePath)
+{
+	Instances->ClearInstances();
+	AgentInstances.Reset();
+	Transforms.Reset();
+	Frames.Reset();
+	NextFrames.Reset();
+	LoadedChunk = INDEX_NONE;
+	bPlaying = false;
+
+	if (!Reader.Open(InFilePath) || Reader.GetNumChunks() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("TrajectoryReplay: could not read %s"), *InFilePath);
+		return false;
+	}
+
+	FilePath = InFilePath;
+	PlaybackTime = Reader.GetStartTime();
+	bPlaying = true;
+
+	UE_LOG(LogTemp, Log, TEXT("TrajectoryReplay: %s, %d chunks, %.1f s"), *FilePath, Reader.GetNumChunks(), GetDuration());
+
+	UpdateInstances();
+	return true;
+}
+
+float ATrajectoryReplayActor::GetDuration() const
+{
+	return Reader.GetEndTime() - Reader.GetStartTime();
+}
+
+void ATrajectoryReplayActor::SetPlaybackTime(float Time)
+{
+	PlaybackTime = FMath::Clamp<double>(Time, Reader.GetStartTime(), Reader.GetEndTime());
+	bPlaying = Reader.GetNumChunks() > 0;
+	UpdateInstances();
+}
+
+void ATrajectoryReplayActor::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bPlaying) return;
+
+	PlaybackTime += DeltaSeconds * PlaybackRate;
+	if (PlaybackTime > Reader.GetEndTime())
+	{
+		if (bLoop)
+		{
+			PlaybackTime = Reader.GetStartTime();
+		}
+		else
+		{
+			PlaybackTime = Reader.GetEndTime();
+			bPlaying = false;
+		}
+	}
+
+	UpdateInstances();
+}
+
+void ATrajectoryReplayActor::LoadChunkAt(double Time)
+{
+	const int32 Chunk = Reader.FindChunk(Time);
+	if (Chunk == LoadedChunk || Chunk == INDEX_NONE) return;
+
+	// Playing forwards reuses the chunk decoded as "next" last time
+	if (Chunk == LoadedChunk + 1 && NextFrames.Num() > 0)
+	{
+		Frames = MoveTemp(NextFrames);
+	}
+	else if (!Reader.ReadChunk(Chunk, Frames))
+	{
+		Frames.Reset();
+	}
+
+	if (!Reader.ReadChunk(Chunk + 1, NextFrames))
+	{
+		NextFrames.Reset();
+	}
+
+	LoadedChunk = Chunk;
+}
+
+void ATrajectoryReplayActor::UpdateInstances()
+{
+	LoadChunkAt(PlaybackTime);
+	if (Frames.Num() == 0) return;
+
+	// Frame at or before the playback time, and the one after it (possibly the next chunk's first)
+	const int32 FromIndex = FMath::Max(Algo::UpperBoundBy(Frames, PlaybackTime, &FTrajectoryFrame::Time) - 1, 0);
+	const FTrajectoryFrame& From = Frames[FromIndex];
+	const FTrajectoryFrame& To = Frames.IsValidIndex(FromIndex + 1) ? Frames[FromIndex + 1]
+		: NextFrames.Num() > 0 ? NextFrames[0] : From;
+
+	const double Span = To.Time - From.Time;
+	const float Alpha = Span > 0.0 ? float(FMath::Clamp((PlaybackTime - From.Time) / Span, 0.0, 1.0)) : 0.f;
+
+	// Agents missing from the frame are hidden by a zero scale
+	for (FTransform& Transform : Transforms)
+	{
+		Transform.SetScale3D(FVector::ZeroVector);
+	}
+
+	// Both frames are sorted by agent id
+	int32 ToIndex = 0;
+	for (const FTrajectorySample& Sample : From.Samples)
+	{
+		while (ToIndex < To.Samples.Num() && To.Samples[ToIndex].AgentId < Sample.AgentId)
+		{
+			++ToIndex;
+		}
+
+		FVector3f Location = Sample.Location;
+		if (To.Samples.IsValidIndex(ToIndex) && To.Samples[ToIndex].AgentId == Sample.AgentId)
+		{
+			Location = FMath::Lerp(Sample.Location, To.Samples[ToIndex].Location, Alpha);
+		}
+
+		const int32 Instance = GetOrAddInstance(Sample.AgentId);
+		Transforms[Instance] = FTransform(FQuat::Identity, FVector(Location), AgentScale);
+		Instances->SetCustomDataValue(Instance, 0, float(uint8(Sample.State)), false);
+		Instances->SetCustomDataValue(Instance, 1, Sample.Speed, false);
+	}
+
+	if (Transforms.Num() > 0)
+	{
+		Instances->BatchUpdateInstancesTransforms(0, Transforms, true, true, true);
+	}
+}
+
+int32 ATrajectoryReplayActor::GetOrAddInstance(int32 AgentId)
+{
+	if (const int32* Existing = AgentInstances.Find(AgentId))
+	{
+		return *Existing;
+	}
+
+	const int32 Instance = Instances->AddInstance(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), true);
+	AgentInstances.Add(AgentId, Instance);
+	Transforms.SetNum(FMath::Max(Transforms.Num(), Instance + 1));
+	return Instance;
+}
@@ -2,4 +2,81 @@
 
 
 #include "SimulationInstance.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
 
+void USimulationInstance::Init()
+{
+	Super::Init();
+
+	ParseBatchSettings();
+	PersistentRunIndex = BatchSettings.FirstRun;
+
+	// Fixed steps let the engine run the simulation as fast as the CPU allows
+	if (BatchSettings.FixedTimeStep > 0.f)
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(BatchSettings.FixedTimeStep);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("SimulationInstance: %d runs, seed %d, map '%s', step %.3f s, headless %s"),
+		BatchSettings.NumRuns,
+		BatchSettings.Seed,
+		*BatchSettings.MapName,
+		BatchSettings.FixedTimeStep,
+		BatchSettings.bHeadless ? TEXT("yes") : TEXT("no")
+	);
+}
+
+void USimulationInstance::OnStart()
+{
+	Super::OnStart();
+
+	// Switch to the requested map if the game started somewhere else
+	if (!BatchSettings.MapName.IsEmpty() && UGameplayStatics::GetCurrentLevelName(GetWorld(), true) != BatchSettings.MapName)
+	{
+		UGameplayStatics::OpenLevel(GetWorld(), FName(*BatchSettings.MapName));
+	}
+}
+
+void USimulationInstance::ParseBatchSettings()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	BatchSettings.bHeadless = !FApp::CanEverRender();
+
+	FParse::Value(CommandLine, TEXT("SimRuns="), BatchSettings.NumRuns);
+	FParse::Value(CommandLine, TEXT("SimSeed="), BatchSettings.Seed);
+	FParse::Value(CommandLine, TEXT("SimMap="), BatchSettings.MapName);
+	FParse::Value(CommandLine, TEXT("SimRunStart="), BatchSettings.FirstRun);
+
+	BatchSettings.LogDirectory = FPaths::ProjectSavedDir() + TEXT("SimulationLogs/");
+	if (FParse::Value(CommandLine, TEXT("SimLogDir="), BatchSettings.LogDirectory))
+	{
+		FPaths::NormalizeDirectoryName(BatchSettings.LogDirectory);
+		BatchSettings.LogDirectory += TEXT("/");
+	}
+
+	BatchSettings.bRecordTrajectories = FParse::Param(CommandLine, TEXT("SimRecord"))
+		|| FParse::Value(CommandLine, TEXT("SimRecord="), BatchSettings.TrajectorySampleRate);
+	FParse::Value(CommandLine, TEXT("SimReplay="), BatchSettings.ReplayFile);
+	BatchSettings.bSimulationLod = FParse::Param(CommandLine, TEXT("SimLod"));
+	BatchSettings.bNavMeshWalking = FParse::Param(CommandLine, TEXT("SimNavMeshWalk"));
+	BatchSettings.bResetInPlace = !FParse::Param(CommandLine, TEXT("SimReload"));
+	FParse::Value(CommandLine, TEXT("SimParams="), BatchSettings.Parameters, false);
+
+	// Headless runs default to the character movement's max sub-step
+	if (BatchSettings.bHeadless)
+	{
+		BatchSettings.FixedTimeStep = 0.05f;
+	}
+	FParse::Value(CommandLine, TEXT("SimFixedStep="), BatchSettings.FixedTimeStep);
+
+	BatchSettings.NumRuns = FMath::Max(BatchSettings.NumRuns, 1);
+	BatchSettings.FirstRun = FMath::Max(BatchSettings.FirstRun, 0);
+	BatchSettings.FixedTimeStep = FMath::Max(BatchSettings.FixedTimeStep, 0.f);
+	BatchSettings.TrajectorySampleRate = FMath::Max(BatchSettings.TrajectorySampleRate, 0.f);
+}
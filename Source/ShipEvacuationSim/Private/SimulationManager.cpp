@@ -3,9 +3,21 @@
 #include "SimulationManager.h"
 
 #include "SimulationInstance.h"
+#include "SimulationResettable.h"
+#include "AICharacter.h"
+#include "AIController.h"
+#include "Crowd/AgentPoolSubsystem.h"
+#include "Crowd/AgentSpawner.h"
+#include "Crowd/CrowdUpdateSubsystem.h"
+#include "Crowd/ProxyCrowdSpawner.h"
+#include "Crowd/ProxyCrowdSubsystem.h"
+#include "Logging/SimulationLogSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Replay/TrajectoryRecorderSubsystem.h"
+#include "Replay/TrajectoryReplayActor.h"
+#include "EngineUtils.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
-#include "Misc/FileHelper.h"
 #include "HAL/PlatformFilemanager.h"
 #include "Misc/Paths.h"
 #include "TimerManager.h"
@@ -28,36 +40,248 @@ void ASimulationManager::BeginPlay()
     }
 
     RunIndex = GameInstance->PersistentRunIndex;
+    FirstRunIndex = GameInstance->BatchSettings.FirstRun;
+    TotalSimulations = GameInstance->BatchSettings.NumRuns;
 
-    LogDirectoryPath = FPaths::ProjectSavedDir() + TEXT("SimulationLogs/");
+    // Replays draw a recording instead of running the simulation
+    if (GameInstance->IsReplaying())
+    {
+        ATrajectoryReplayActor* Replay = GetWorld()->SpawnActor<ATrajectoryReplayActor>();
+        if (Replay)
+        {
+            Replay->LoadRecording(GameInstance->BatchSettings.ReplayFile);
+        }
+        return;
+    }
+
+    LogDirectoryPath = GameInstance->BatchSettings.LogDirectory;
     IFileManager::Get().MakeDirectory(*LogDirectoryPath, true);
 
-    CurrentSimFilePath = FString::Printf(TEXT("%sRun_%d.csv"), *LogDirectoryPath, RunIndex);
+    bRecordTrajectories |= GameInstance->BatchSettings.bRecordTrajectories;
+    bResetInPlace &= GameInstance->BatchSettings.bResetInPlace;
+
+    Parameters = FSimulationParameters::Parse(GameInstance->BatchSettings.Parameters);
+    if (!Parameters.IsEmpty())
+    {
+        ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ASimulationManager::OnActorSpawned));
+
+        // Pooled agents are not spawned again, and spawners set their speeds after spawning
+        if (UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+        {
+            AgentActivatedHandle = Pool->OnAgentActivated.AddUObject(this, &ASimulationManager::OnPooledAgentActivated);
+        }
+    }
 
-    FString Header = TEXT("Minute | AgentsMustered\n");
-    FFileHelper::SaveStringToFile(Header, *CurrentSimFilePath);
+    SeedRun();
+    StartRun();
+}
 
-    SimulationStartTime = FPlatformTime::Seconds();
+void ASimulationManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
 
-    GetWorldTimerManager().SetTimer(MinuteLogTimer, this, &ASimulationManager::LogMinuteProgress, 60.0f, true);
-    GetWorldTimerManager().SetTimer(SimulationTimeoutTimer, this, &ASimulationManager::EndCurrentSimulation, 1800.0f, false);
+    if (UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+    {
+        Pool->OnAgentActivated.Remove(AgentActivatedHandle);
+    }
+
+    Super::EndPlay(EndPlayReason);
 }
 
-void ASimulationManager::LogMinuteProgress()
+void ASimulationManager::OnActorSpawned(AActor* Actor)
 {
-    int32 Mustered = CountMusteredAgents();
-    FString Line = FString::Printf(TEXT("Minute: %d | Agents Mustered: %d\n"), MinutesElapsed++, Mustered);
-    FFileHelper::SaveStringToFile(Line, *CurrentSimFilePath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+    Parameters.ApplyTo(Actor);
+}
+
+void ASimulationManager::OnPooledAgentActivated(AAiCharacter* Agent)
+{
+    Parameters.ApplyTo(Agent);
+}
+
+void ASimulationManager::SeedRun()
+{
+    // Seed every run so batches are reproducible
+    const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+    const int32 RunSeed = (GameInstance ? GameInstance->BatchSettings.Seed : 0) + RunIndex;
+    FMath::RandInit(RunSeed);
+    FMath::SRandInit(RunSeed);
+}
+
+void ASimulationManager::StartRun()
+{
+    bSimulationEnded = false;
+    LastMusteredCount = 0;
+
+    SimulationStartTime = GetWorld()->GetTimeSeconds();
+    WallStartTime = FPlatformTime::Seconds();
+
+    // Actors placed in the level, and the population spawned by the reset
+    if (!Parameters.IsEmpty())
+    {
+        int32 NumSet = 0;
+        for (FActorIterator It(GetWorld()); It; ++It)
+        {
+            NumSet += Parameters.ApplyTo(*It);
+        }
+        UE_LOG(LogTemp, Log, TEXT("SimulationManager: run %d parameters %s (%d properties set)."), RunIndex, *Parameters.ToString(), NumSet);
+    }
+
+    if (UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Crowd->ResetLodStats();
+    }
+
+    if (USimulationPerfSubsystem* Perf = GetWorld()->GetSubsystem<USimulationPerfSubsystem>())
+    {
+        Perf->BeginRun();
+    }
+
+    if (USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>())
+    {
+        Log->BeginRun(LogDirectoryPath, RunIndex);
+    }
+
+    UTrajectoryRecorderSubsystem* Recorder = GetWorld()->GetSubsystem<UTrajectoryRecorderSubsystem>();
+    if (Recorder && bRecordTrajectories)
+    {
+        const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+        if (GameInstance && GameInstance->BatchSettings.TrajectorySampleRate > 0.f)
+        {
+            Recorder->SampleRate = GameInstance->BatchSettings.TrajectorySampleRate;
+        }
+        Recorder->BeginRecording(FString::Printf(TEXT("%sRun_%d.simtraj"), *LogDirectoryPath, RunIndex));
+    }
+
+    GetWorldTimerManager().SetTimer(SimulationTimeoutTimer, this, &ASimulationManager::OnSimulationTimeout, SimulationTimeout, false);
+
+    LastProgressTime = SimulationStartTime;
+    GetWorldTimerManager().SetTimer(ProgressCheckTimer, this, &ASimulationManager::CheckRunProgress, ProgressCheckInterval, true);
 }
 
-void ASimulationManager::EndCurrentSimulation()
+void ASimulationManager::CheckRunProgress()
 {
-    GetWorldTimerManager().ClearTimer(MinuteLogTimer);
+    const double Now = GetWorld()->GetTimeSeconds();
+
+    // Mustered agents stay registered, so the peak registration count covers spawners that
+    // create everyone at once. The pool counts everything queued this run, spawned or not, and
+    // staggered Blueprint spawners declare their total.
+    int32 Registered = 0;
+    bool bSpawning = false;
+    if (const UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+    {
+        Registered += Crowd->GetNumAgents();
+        LastProgressTime = FMath::Max(LastProgressTime, Crowd->GetLastProgressTime());
+    }
+    if (const UProxyCrowdSubsystem* Proxies = GetWorld()->GetSubsystem<UProxyCrowdSubsystem>())
+    {
+        Registered += Proxies->GetNumAgents();
+    }
+    if (const UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+    {
+        // Active pool agents are registered with the crowd; count them once, through the request total
+        Registered += Pool->GetStats().Requested - FMath::Min(Pool->GetNumActive(), Registered);
+        bSpawning = Pool->GetNumQueued() > 0;
+    }
+    Population = FMath::Max3(Population, Registered, DeclaredPopulation);
+
+    const int32 Mustered = CountMusteredAgents();
+    if (USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>())
+    {
+        Log->LogProgress(Mustered, FMath::Max(Population - Mustered, 0));
+    }
+
+    if (Mustered != LastMusteredCount)
+    {
+        LastMusteredCount = Mustered;
+        LastProgressTime = Now;
+    }
+
+    if (Population > 0 && Mustered >= Population && !bSpawning)
+    {
+        EndCurrentSimulation(TEXT("AllMustered"));
+    }
+    else if (StallTimeout > 0.f && Now - LastProgressTime > StallTimeout)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("SimulationManager: no progress for %.0f s, %d/%d mustered."), Now - LastProgressTime, Mustered, Population);
+        EndCurrentSimulation(TEXT("Stalled"));
+    }
+}
+
+void ASimulationManager::OnSimulationTimeout()
+{
+    EndCurrentSimulation(TEXT("Timeout"));
+}
+
+void ASimulationManager::EndCurrentSimulation(const TCHAR* Reason)
+{
+    if (bSimulationEnded) return;
+    bSimulationEnded = true;
+
     GetWorldTimerManager().ClearTimer(SimulationTimeoutTimer);
+    GetWorldTimerManager().ClearTimer(ProgressCheckTimer);
+
+    UE_LOG(LogTemp, Log, TEXT("SimulationManager: run %d ended (%s)."), RunIndex, Reason);
+
+    const double ElapsedSeconds = GetWorld()->GetTimeSeconds() - SimulationStartTime;
+    const double WallSeconds = FPlatformTime::Seconds() - WallStartTime;
+    if (USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>())
+    {
+        const int32 Mustered = CountMusteredAgents();
+        Log->LogProgress(Mustered, FMath::Max(Population - Mustered, 0));
+        Log->SetSummary(TEXT("EndReason"), Reason);
+        Log->SetSummary(TEXT("Map"), UGameplayStatics::GetCurrentLevelName(this, true));
+        // Batch seed, run N used Seed + N; the run farm only reuses runs with its own
+        const USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
+        Log->SetSummary(TEXT("Seed"), FString::FromInt(GameInstance ? GameInstance->BatchSettings.Seed : 0));
+        Log->SetSummary(TEXT("AgentsMustered"), FString::FromInt(Mustered));
+        Log->SetSummary(TEXT("Population"), FString::FromInt(Population));
+        Log->SetSummary(TEXT("TotalTimeSeconds"), FString::Printf(TEXT("%.2f"), ElapsedSeconds));
+        Log->SetSummary(TEXT("WallTimeSeconds"), FString::Printf(TEXT("%.2f"), WallSeconds));
 
-    double ElapsedSeconds = FPlatformTime::Seconds() - SimulationStartTime;
-    FString Footer = FString::Printf(TEXT("TotalTimeSeconds,%.2f\n"), ElapsedSeconds);
-    FFileHelper::SaveStringToFile(Footer, *CurrentSimFilePath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+        // One column per swept parameter, so merged summaries group by parameter point
+        for (const FSimulationParameter& Parameter : Parameters.Entries)
+        {
+            Log->SetSummary(FString::Printf(TEXT("Param_%s.%s"), *Parameter.ClassName, *Parameter.PropertyName), Parameter.Value);
+        }
+
+        if (const UCrowdUpdateSubsystem* Crowd = GetWorld()->GetSubsystem<UCrowdUpdateSubsystem>())
+        {
+            // Compare muster times of a -SimLod batch against one without it to check the LOD stays within tolerance
+            const FCrowdLodStats& Lod = Crowd->GetLodStats();
+            const double AgentSeconds = Lod.FullAgentSeconds + Lod.ReducedAgentSeconds;
+            Log->SetSummary(TEXT("LodDemotions"), FString::FromInt(Lod.Demotions));
+            Log->SetSummary(TEXT("LodPromotions"), FString::FromInt(Lod.Promotions));
+            Log->SetSummary(TEXT("LodReducedShare"), FString::Printf(TEXT("%.3f"), AgentSeconds > 0.0 ? Lod.ReducedAgentSeconds / AgentSeconds : 0.0));
+            Log->SetSummary(TEXT("LodMovementSecondsSaved"), FString::Printf(TEXT("%.3f"), Lod.GetMovementSecondsSaved()));
+
+            // Per-agent movement tick cost; compare a -SimNavMeshWalk batch against one without it
+            const FAgentMovementCost& Cost = Crowd->GetMovementCost();
+            Log->SetSummary(TEXT("MoveUsWalking"), FString::Printf(TEXT("%.2f"), Cost.GetMicroseconds(EAgentMovementKind::Walking)));
+            Log->SetSummary(TEXT("MoveUsNavMeshWalking"), FString::Printf(TEXT("%.2f"), Cost.GetMicroseconds(EAgentMovementKind::NavMeshWalking)));
+            Log->SetSummary(TEXT("MoveUsReduced"), FString::Printf(TEXT("%.2f"), Cost.GetMicroseconds(EAgentMovementKind::Reduced)));
+        }
+
+        if (const UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+        {
+            // Allocations and reuses are in PerfCountAgentsAllocated / PerfCountAgentsReused
+            const FAgentPoolStats& Spawn = Pool->GetStats();
+            Log->SetSummary(TEXT("SpawnMsTotal"), FString::Printf(TEXT("%.2f"), Spawn.SpawnSeconds * 1000.0));
+            Log->SetSummary(TEXT("SpawnMsMaxFrame"), FString::Printf(TEXT("%.2f"), Spawn.MaxFrameSeconds * 1000.0));
+            Log->SetSummary(TEXT("SpawnFrames"), FString::FromInt(Spawn.SpawnFrames));
+            Log->SetSummary(TEXT("AgentsReleasedOnMuster"), FString::FromInt(Spawn.ReleasedOnMuster));
+        }
+
+        if (const USimulationPerfSubsystem* Perf = GetWorld()->GetSubsystem<USimulationPerfSubsystem>())
+        {
+            Perf->WriteSummary(*Log);
+        }
+        Log->EndRun();
+    }
+
+    if (UTrajectoryRecorderSubsystem* Recorder = GetWorld()->GetSubsystem<UTrajectoryRecorderSubsystem>())
+    {
+        Recorder->EndRecording();
+    }
 
     USimulationInstance* GameInstance = Cast<USimulationInstance>(GetGameInstance());
     if (GameInstance)
@@ -65,9 +289,19 @@ void ASimulationManager::EndCurrentSimulation()
         GameInstance->PersistentRunIndex++;
     }
 
-    if (RunIndex + 1 < TotalSimulations)
+    const bool bMoreRuns = RunIndex + 1 < FirstRunIndex + TotalSimulations;
+    if (bMoreRuns && bResetInPlace && CanResetInPlace())
+    {
+        RunIndex++;
+        SeedRun();
+        ResetWorldForNextRun();
+        StartRun();
+    }
+    else if (bMoreRuns)
     {
-        FString NextLevel = UGameplayStatics::GetCurrentLevelName(this, true);
+        FString NextLevel = GameInstance && !GameInstance->BatchSettings.MapName.IsEmpty()
+            ? GameInstance->BatchSettings.MapName
+            : UGameplayStatics::GetCurrentLevelName(this, true);
         UGameplayStatics::OpenLevel(this, FName(*NextLevel)); // No need to pass SimIndex anymore
     }
     else
@@ -77,8 +311,84 @@ void ASimulationManager::EndCurrentSimulation()
     }
 }
 
+bool ASimulationManager::CanResetInPlace() const
+{
+    // The reset removes every agent, so something has to spawn the next population
+    for (FActorIterator It(GetWorld()); It; ++It)
+    {
+        if (It->IsA<AAgentSpawner>() || It->IsA<AProxyCrowdSpawner>())
+        {
+            return true;
+        }
+
+        // Blueprint spawners add the interface themselves; native volumes only reset their own state
+        for (const UClass* Class = It->GetClass(); Class && !Class->IsNative(); Class = Class->GetSuperClass())
+        {
+            const bool bSpawner = Class->Interfaces.ContainsByPredicate([](const FImplementedInterface& Interface)
+            {
+                return Interface.bImplementedByK2 && Interface.Class == USimulationResettable::StaticClass();
+            });
+            if (bSpawner) return true;
+        }
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("SimulationManager: nothing in the level respawns agents, reloading it for the next run."));
+    return false;
+}
+
+void ASimulationManager::ResetWorldForNextRun()
+{
+    const double ResetStart = FPlatformTime::Seconds();
+
+    // Park the pooled population and remove the rest; spawners create the next one in ResetForNewRun
+    if (UAgentPoolSubsystem* Pool = GetWorld()->GetSubsystem<UAgentPoolSubsystem>())
+    {
+        Pool->ReleaseAll();
+        Pool->ResetStats();
+    }
+
+    for (TActorIterator<AAiCharacter> It(GetWorld()); It; ++It)
+    {
+        AAiCharacter* Agent = *It;
+        if (!Agent->IsInAgentPool())
+        {
+            Agent->DestroyForReset();
+        }
+    }
+
+    if (UProxyCrowdSubsystem* Proxies = GetWorld()->GetSubsystem<UProxyCrowdSubsystem>())
+    {
+        Proxies->ResetAgents();
+    }
+
+    MusteredAgents = 0;
+    Population = 0;
+    DeclaredPopulation = 0;
+
+    // Fire extents, congestion state and anything else that implements the interface.
+    // The level and its built navmesh stay resident.
+    for (FActorIterator It(GetWorld()); It; ++It)
+    {
+        if (It->Implements<USimulationResettable>())
+        {
+            ISimulationResettable::Execute_ResetForNewRun(*It);
+        }
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("SimulationManager: world reset for run %d in %.1f ms."), RunIndex, (FPlatformTime::Seconds() - ResetStart) * 1000.0);
+}
+
+void ASimulationManager::DeclarePopulation(int32 NumAgents)
+{
+    DeclaredPopulation += FMath::Max(NumAgents, 0);
+}
+
 int32 ASimulationManager::CountMusteredAgents()
 {
+    if (const UProxyCrowdSubsystem* Proxies = GetWorld()->GetSubsystem<UProxyCrowdSubsystem>())
+    {
+        return MusteredAgents + Proxies->GetNumMustered();
+    }
     return MusteredAgents;
 }
 
@@ -3,7 +3,11 @@
 #include "NavModifierComponent.h"
 #include "NavAreas/NavArea_Default.h"
 #include "Volumes/CrowdedArea_NavArea.h"
-#include "GameFramework/Character.h"
+#include "Crowd/AgentSpatialGridSubsystem.h"
+#include "Logging/SimulationLogSubsystem.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Navigation/NavUpdateSchedulerSubsystem.h"
+#include "AICharacter.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Engine/World.h"
 
@@ -15,9 +19,12 @@ ACrowdDensityVolume::ACrowdDensityVolume()
 	Volume = CreateDefaultSubobject<UBoxComponent>(TEXT("Volume"));
 	RootComponent = Volume;
 	Volume->SetBoxExtent(FVector(200.f, 200.f, 110.f));
+
+	// Agents are found through the spatial grid, so the box needs no overlap tracking.
+	// Collision stays query-enabled so the nav modifier still picks up the box bounds.
 	Volume->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
 	Volume->SetCollisionResponseToAllChannels(ECR_Ignore);
-	Volume->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	Volume->SetGenerateOverlapEvents(false);
 
 	// Create nav modifier and set default area
 	NavModifier = CreateDefaultSubobject<UNavModifierComponent>(TEXT("NavModifier"));
@@ -40,14 +47,42 @@ void ACrowdDensityVolume::BeginPlay()
 	);
 }
 
+void ACrowdDensityVolume::ResetForNewRun_Implementation()
+{
+	if (bIsCongested)
+	{
+		bIsCongested = false;
+		UpdateNavModifier(false);
+	}
+
+	// Restart the check phase so every run samples at the same offsets
+	GetWorld()->GetTimerManager().SetTimer(
+		DensityCheckTimerHandle,
+		this,
+		&ACrowdDensityVolume::CheckCongestion,
+		CheckInterval,
+		true
+	);
+}
+
 void ACrowdDensityVolume::CheckCongestion()
 {
-	TArray<AActor*> OverlappingActors;
-	Volume->GetOverlappingActors(OverlappingActors, ACharacter::StaticClass());
+	SIM_SCOPE_CYCLE_COUNTER(CongestionCheck);
+
+	const UAgentSpatialGridSubsystem* Grid = GetWorld()->GetSubsystem<UAgentSpatialGridSubsystem>();
+	if (!Grid) return;
+
+	TArray<AAiCharacter*> OverlappingAgents;
+	SimulationPerf::AddCount(ESimPerfCounter::OverlapsQueried);
+	Grid->QueryBox(Volume->GetComponentTransform(), Volume->GetUnscaledBoxExtent(), OverlappingAgents);
 
-	const int32 AgentCount = OverlappingActors.Num();
+	USimulationLogSubsystem* Log = GetWorld()->GetSubsystem<USimulationLogSubsystem>();
+
+	const int32 AgentCount = OverlappingAgents.Num();
 	if (AgentCount == 0)
 	{
+		if (Log) Log->LogZoneDensity(this, 0, 0.f, 0.f, false);
+
 		if (bIsCongested)
 		{
 			bIsCongested = false;
@@ -69,9 +104,8 @@ void ACrowdDensityVolume::CheckCongestion()
 
 	// Movement check
 	int32 SlowAgents = 0;
-	for (AActor* Actor : OverlappingActors)
+	for (AAiCharacter* Character : OverlappingAgents)
 	{
-		ACharacter* Character = Cast<ACharacter>(Actor);
 		if (!Character || !Character->GetCharacterMovement()) continue;
 
 		const float CurrentSpeed = Character->GetVelocity().Size();
@@ -90,6 +124,8 @@ void ACrowdDensityVolume::CheckCongestion()
 	const bool bNowCongested = bDenseEnough && bSlowedEnough;
 
 	DisplayDebugStats(AreaUsage, SlowRatio, AgentCount);
+
+	if (Log) Log->LogZoneDensity(this, AgentCount, AreaUsage, SlowRatio, bNowCongested);
 	
 	if (bNowCongested != bIsCongested)
 	{
@@ -108,15 +144,18 @@ void ACrowdDensityVolume::CheckCongestion()
 
 void ACrowdDensityVolume::UpdateNavModifier(bool bCongested)
 {
+	UNavUpdateSchedulerSubsystem* NavUpdates = GetWorld()->GetSubsystem<UNavUpdateSchedulerSubsystem>();
+	if (!NavUpdates) return;
+
 	if (bCongested)
 	{
 		// Apply high-cost area to discourage pathfinding through this volume
-		NavModifier->SetAreaClass(UCrowdedArea_NavArea::StaticClass());
+		NavUpdates->RequestAreaChange(NavModifier, UCrowdedArea_NavArea::StaticClass());
 	}
 	else
 	{
 		// Reset to normal navigation area
-		NavModifier->SetAreaClass(UNavArea_Default::StaticClass());
+		NavUpdates->RequestAreaChange(NavModifier, UNavArea_Default::StaticClass());
 	}
 }
 
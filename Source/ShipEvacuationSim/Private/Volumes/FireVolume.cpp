@@ -1,8 +1,10 @@
 #include "Volumes/FireVolume.h"
-#include "NavigationSystem.h"
 #include "Components/BoxComponent.h"
 #include "NavModifierComponent.h"
 #include "Volumes/FireArea_NavArea.h"
+#include "Logging/SimulationPerfSubsystem.h"
+#include "Navigation/NavMetadataSubsystem.h"
+#include "Navigation/NavUpdateSchedulerSubsystem.h"
 
 AFireVolume::AFireVolume()
 {
@@ -55,14 +57,29 @@ void AFireVolume::BeginPlay()
 	);
 
 	// Force initial nav update
-	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = GetWorld()->GetSubsystem<UNavUpdateSchedulerSubsystem>())
 	{
-		NavSys->UpdateComponentInNavOctree(*FireBox);
+		NavUpdates->RequestBoundsUpdate(FireBox, true);
 	}
 }
 
+void AFireVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetTimerManager().ClearTimer(ExpansionTimerHandle);
+
+	// Give the corridor widths around the fire back to the agents
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
+	{
+		NavMeta->RemoveObstacle(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AFireVolume::ExpandVolumeStep()
 {
+	SIM_SCOPE_CYCLE_COUNTER(FireExpansion);
+
 	if (ElapsedTime >= ExpansionDuration)
 	{
 		GetWorld()->GetTimerManager().ClearTimer(ExpansionTimerHandle);
@@ -76,19 +93,42 @@ void AFireVolume::ExpandVolumeStep()
 	// ✅ Exponential growth curve: grows very slowly at first, then rapidly
 	const float ExpFactor = FMath::Pow(Alpha, 4.0f); // Try 3.0–5.0 for tuning
 
-	const FVector NewExtent = FVector(
+	ApplyExtent(FVector(
 		FMath::Lerp(InitialExtent.X, MaxXYSize.X / 2.f, ExpFactor),
 		FMath::Lerp(InitialExtent.Y, MaxXYSize.Y / 2.f, ExpFactor),
 		InitialExtent.Z
+	));
+}
+
+void AFireVolume::ResetForNewRun_Implementation()
+{
+	ElapsedTime = 0.0f;
+	ApplyExtent(InitialExtent);
+
+	GetWorld()->GetTimerManager().SetTimer(
+		ExpansionTimerHandle,
+		this,
+		&AFireVolume::ExpandVolumeStep,
+		UpdateInterval,
+		true
 	);
+}
 
+void AFireVolume::ApplyExtent(const FVector& NewExtent)
+{
 	FireBox->SetBoxExtent(NewExtent);
 	SmokeVisualBox->SetWorldScale3D((NewExtent * 2.0f) / 100.0f);
 	FireBox->UpdateBounds();
 
-	// Force navmesh update
-	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	// Rebuilds are coalesced; early in the growth curve most steps are below the threshold
+	if (UNavUpdateSchedulerSubsystem* NavUpdates = GetWorld()->GetSubsystem<UNavUpdateSchedulerSubsystem>())
+	{
+		NavUpdates->RequestBoundsUpdate(FireBox);
+	}
+
+	// Narrow the baked corridor widths around the fire
+	if (UNavMetadataSubsystem* NavMeta = GetWorld()->GetSubsystem<UNavMetadataSubsystem>())
 	{
-		NavSys->UpdateComponentInNavOctree(*FireBox);
+		NavMeta->UpdateObstacle(this, FireBox->Bounds.GetBox());
 	}
 }
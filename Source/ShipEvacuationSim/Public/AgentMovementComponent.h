@@ -6,12 +6,89 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "AgentMovementComponent.generated.h"
 
+class UCrowdUpdateSubsystem;
+class UNavMetadataSubsystem;
 
-UCLASS()
+// CustomMovementMode values under MOVE_Custom
+UENUM()
+enum class EAgentMovementMode : uint8
+{
+	None,
+	NavMeshWalking,
+};
+
+/**
+ * Agent movement. Walking agents switch to navmesh walking while they are on a walkable
+ * floor and clear of dynamic obstacles: each move is a navmesh raycast and projection
+ * instead of capsule sweeps, floor finds and step-ups, with a floor find only every
+ * FloorCheckInterval. Stairs take their vertical reach from the baked slope. Near a
+ * dynamic obstacle or another pawn, when the swept step hits something, or when the
+ * floor check fails, the agent falls back to full walking.
+ */
+UCLASS(config = Game)
 class SHIPEVACUATIONSIM_API UAgentMovementComponent : public UCharacterMovementComponent
 {
 	GENERATED_BODY()
 
+public:
+	// Off by default so existing scenarios keep their results; -SimNavMeshWalk turns it on for a batch
+	UPROPERTY(Config)
+	bool bNavMeshWalking = false;
+
+	// Seconds between floor and obstacle checks, in either walking mode
+	UPROPERTY(Config)
+	float FloorCheckInterval = 0.5f;
+
+	// Movable blocking geometry closer than this to the capsule keeps the agent at full walking (cm)
+	UPROPERTY(Config)
+	float DynamicObstacleMargin = 50.f;
+
+	// Vertical reach of the navmesh projection on flat floor (cm)
+	UPROPERTY(Config)
+	float FlatProjectionHeight = 30.f;
+
+	bool IsNavMeshWalking() const { return MovementMode == MOVE_Custom && CustomMovementMode == uint8(EAgentMovementMode::NavMeshWalking); }
+
+	// Local avoidance from the crowd manager's ORCA solver instead of the engine's RVO
+	void SetOrcaAvoidance(bool bEnable);
+	bool UsesOrcaAvoidance() const { return bOrcaAvoidance; }
+
+	// Velocity from the last movement update before avoidance was applied
+	const FVector& GetPreferredVelocity() const { return PreferredVelocity; }
+
+	// Horizontal velocity to walk at from the next movement update on; unset walks at the preferred velocity
+	void SetAvoidanceVelocity(const TOptional<FVector2f>& InVelocity) { AvoidanceVelocity = InVelocity; }
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual bool IsMovingOnGround() const override;
+	virtual float GetMaxSpeed() const override;
+	virtual float GetMaxBrakingDeceleration() const override;
+
 protected:
+	virtual void BeginPlay() override;
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
 	virtual void PhysWalking(float DeltaTime, int32 Iterations) override;
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+private:
+	// Receives tick times for the movement cost report
+	UPROPERTY(Transient)
+	TObjectPtr<UCrowdUpdateSubsystem> Crowd;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UNavMetadataSubsystem> NavMetadata;
+
+	float TimeToFloorCheck = 0.f;
+
+	void PhysNavMeshWalking(float DeltaTime, int32 Iterations);
+	void ClampHorizontalSpeed();
+
+	// Walkable floor under the capsule and nothing the navmesh does not know about nearby
+	bool CanNavMeshWalk();
+	bool IsNearDynamicObstacle() const;
+
+	bool bOrcaAvoidance = false;
+	FVector PreferredVelocity = FVector::ZeroVector;
+	TOptional<FVector2f> AvoidanceVelocity;
 };
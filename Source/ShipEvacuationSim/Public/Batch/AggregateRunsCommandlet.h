@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AggregateRunsCommandlet.generated.h"
+
+/**
+ * Folds completed run logs into a streaming aggregate (see FRunAggregator).
+ *
+ * UnrealEditor-Cmd ShipEvacuationSim.uproject -run=AggregateRuns -Dir=Saved/SimulationLogs/Sweep [-Watch] [-Interval=10] [-IdleTimeout=600]
+ *
+ * Reads Run_N.simlog files in Dir and its immediate subdirectories, such as the sweep's
+ * Point_N folders. Only runs not already in Aggregate.simagg are read, and the aggregate
+ * and Aggregate_Summary.csv are rewritten after every pass. With -Watch it keeps polling
+ * for newly completed runs until none have arrived for IdleTimeout seconds.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API UAggregateRunsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAggregateRunsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ParameterSweepCommandlet.generated.h"
+
+/**
+ * Expands a sweep definition into parameter points and runs each until the confidence
+ * interval on its mean total muster time is tight enough.
+ *
+ * UnrealEditor-Cmd ShipEvacuationSim.uproject -run=ParameterSweep -Sweep=Sweeps/FireSpeed.json -Workers=8
+ *
+ * {
+ *   "Map": "M_TestFull",
+ *   "Design": "Grid",                // or "LatinHypercube" with "Samples": N
+ *   "Seed": 7,
+ *   "Parameters": [
+ *     { "Name": "AiCharacter.WalkSpeedOnFlat", "Values": [120, 150, 180] },
+ *     { "Name": "FireVolume.ExpansionDuration", "Min": 240, "Max": 600, "Steps": 4 }
+ *   ],
+ *   "Stopping": { "MinRuns": 5, "MaxRuns": 50, "Confidence": 0.95, "RelativeHalfWidth": 0.05 }
+ * }
+ *
+ * Each point runs in rounds of worker processes with -SimParams, under
+ * Saved/SimulationLogs/Sweep/Point_N, reloading the map between runs. It stops once at
+ * least MinRuns have ended with everyone mustered and the Student-t half-width is within
+ * RelativeHalfWidth of the mean, or once it reaches MaxRuns. Runs that time out or stall
+ * are left out of the statistics and reported in the Unfinished column. Run N uses seed Seed + N at every point, so points are compared on
+ * common random numbers. Points that already have complete runs resume where they
+ * left off; runs left under Point_N by a sweep with other values, seed or map are rerun. Sweep_Summary.csv lists each point with its mean, spread and whether it
+ * converged; Aggregate.simagg / Aggregate_Summary.csv hold the full cross-run statistics.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API UParameterSweepCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UParameterSweepCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
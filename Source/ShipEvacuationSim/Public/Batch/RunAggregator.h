@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Batch/RunStatistics.h"
+#include "Batch/TDigest.h"
+
+struct FRunLog;
+
+/**
+ * Streaming cross-run statistics over Run_N.simlog files. Each run is folded in
+ * once, grouped by map and parameter point (its Map and Param_* summary fields). Per group, every
+ * numeric summary field and the agents mustered at the end of each simulated minute
+ * keep a running mean/variance and a t-digest for percentiles. Memory depends on the
+ * number of groups, fields and minutes, not on the number of runs.
+ *
+ * The state is saved to one compact .simagg file that Load picks up again, so
+ * aggregation can resume as more runs complete. ExportCsv writes a readable table.
+ */
+struct SHIPEVACUATIONSIM_API FRunAggregator
+{
+	struct FMetric
+	{
+		FRunningStats Stats;
+		FTDigest Digest;
+
+		void Add(double Value);
+
+		friend FArchive& operator<<(FArchive& Ar, FMetric& Metric);
+	};
+
+	struct FGroup
+	{
+		int32 Runs = 0;
+		TMap<FString, FMetric> Summary;
+
+		// Agents mustered at the end of minute i + 1
+		TArray<FMetric> Minutes;
+
+		friend FArchive& operator<<(FArchive& Ar, FGroup& Group);
+	};
+
+	// Minutes tracked per run; runs that end earlier carry their final count forward
+	int32 MaxMinutes = 30;
+
+	bool Load(const FString& FilePath);
+	bool Save(const FString& FilePath);
+
+	// Folds in complete runs of Directory not seen before. Returns how many were added.
+	int32 ConsumeDirectory(const FString& Directory);
+
+	// Source (the run's directory) stands in for the map in logs written before runs recorded it
+	void AddRun(const FRunLog& Log, const FString& Source = FString());
+
+	// One row per group and metric: count, mean, standard deviation, min, percentiles, max
+	bool ExportCsv(const FString& FilePath) const;
+
+	const TMap<FString, FGroup>& GetGroups() const { return Groups; }
+	int32 GetNumRuns() const;
+
+private:
+	TMap<FString, FGroup> Groups;
+
+	// Consumed run indices per directory as sorted [First, Last] ranges; runs finish
+	// roughly in order, so this stays a handful of ranges
+	TMap<FString, TArray<FIntPoint>> Consumed;
+
+	bool IsConsumed(const FString& Directory, int32 RunIndex) const;
+	void MarkConsumed(const FString& Directory, int32 RunIndex);
+
+	static FString GetGroupKey(const FRunLog& Log, const FString& Source);
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RunFarmCommandlet.generated.h"
+
+/**
+ * Runs a batch as N headless worker processes on this machine.
+ *
+ * UnrealEditor-Cmd ShipEvacuationSim.uproject -run=RunFarm -Runs=50 -Workers=16 -Seed=7 -Map=M_TestFull
+ *
+ * Each worker gets a contiguous run range, the shared seed and its own log
+ * directory under Saved/SimulationLogs/Farm/. Workers that exit before their
+ * range is complete are restarted from the first unfinished run. Logs already in
+ * a worker directory are only reused if they were written with the same seed and
+ * map and fall in the worker's range; otherwise the directory is cleared. When all
+ * workers are done the per-run logs are merged into Saved/SimulationLogs/Farm/.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API URunFarmCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	URunFarmCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Progress and summary of one Run_N.simlog written by USimulationLogSubsystem. */
+struct SHIPEVACUATIONSIM_API FRunLog
+{
+	int32 RunIndex = INDEX_NONE;
+
+	// (Time, AgentsMustered) samples
+	TArray<TPair<double, int32>> Progress;
+
+	// Summary fields such as EndReason and TotalTimeSeconds
+	TMap<FString, FString> Summary;
+
+	// True once the run summary has been written
+	bool IsComplete() const { return Summary.Contains(TEXT("EndReason")); }
+
+	// Complete with every agent mustered; timed out and stalled runs are complete but did not finish
+	bool IsAllMustered() const
+	{
+		const FString* EndReason = Summary.Find(TEXT("EndReason"));
+		return EndReason && *EndReason == TEXT("AllMustered");
+	}
+
+	// Every expected summary field is present with the same value, e.g. the Seed and Map a batch was run with
+	bool MatchesSummary(const TMap<FString, FString>& Expected) const
+	{
+		for (const TPair<FString, FString>& Pair : Expected)
+		{
+			const FString* Value = Summary.Find(Pair.Key);
+			if (!Value || *Value != Pair.Value) return false;
+		}
+		return true;
+	}
+
+	FString GetEndReason() const
+	{
+		const FString* EndReason = Summary.Find(TEXT("EndReason"));
+		return EndReason ? *EndReason : TEXT("Incomplete");
+	}
+};
+
+/** Reads per-run logs and merges shards from several worker directories. */
+struct SHIPEVACUATIONSIM_API FRunLogMerger
+{
+	static FString GetRunLogPath(const FString& Directory, int32 RunIndex);
+
+	static bool ParseRunLog(const FString& FilePath, FRunLog& OutLog);
+	// Complete, and written with the Expected summary fields (see FRunLog::MatchesSummary)
+	static bool IsRunComplete(const FString& Directory, int32 RunIndex, const TMap<FString, FString>& Expected = {});
+
+	// Writes Merged_Progress.csv and Merged_Summary.csv into OutputDirectory. Returns the number of runs merged.
+	static int32 MergeDirectories(const TArray<FString>& Directories, const FString& OutputDirectory);
+};
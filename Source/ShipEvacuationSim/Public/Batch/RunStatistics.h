@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Streaming mean and variance (Welford), for stopping rules and cross-run summaries. */
+struct SHIPEVACUATIONSIM_API FRunningStats
+{
+	int64 Count = 0;
+	double Mean = 0.0;
+	double M2 = 0.0;
+	double Min = TNumericLimits<double>::Max();
+	double Max = TNumericLimits<double>::Lowest();
+
+	void Add(double Value);
+
+	// Combines two independent streams (Chan et al.)
+	void Merge(const FRunningStats& Other);
+
+	// Sample variance; 0 with fewer than two values
+	double GetVariance() const;
+	double GetStdDev() const { return FMath::Sqrt(GetVariance()); }
+
+	// Half-width of the Student-t confidence interval on the mean, e.g. Confidence = 0.95
+	double GetConfidenceHalfWidth(double Confidence) const;
+
+	// Two-sided Student-t critical value for DegreesOfFreedom >= 1
+	static double GetStudentT(double Confidence, int64 DegreesOfFreedom);
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ScenarioBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs every test map headless for a fixed number of seeds and compares the results
+ * against a baseline file.
+ *
+ * UnrealEditor-Cmd ShipEvacuationSim.uproject -run=ScenarioBenchmark -Seeds=3 [-Maps=M_Test1,M_Test8_2]
+ *     [-Baseline=<file.json>] [-Threshold=0.1] [-UpdateBaseline]
+ *
+ * Maps default to every map in Content/Maps/Tests. They run one at a time, each in
+ * its own process, so timings do not compete for cores; the level is reloaded between
+ * seeds. Only runs that end with every agent mustered count. Per scenario, the results
+ * record simulated completion time, wall time, agents mustered per wall second, peak
+ * memory and frame time mean/p95/p99, all averaged over the seeds. They are written to
+ * Saved/Benchmarks/Results.json.
+ *
+ * Returns non-zero if a scenario failed to complete, or if a metric got worse than the
+ * baseline by more than Threshold (a fraction). -UpdateBaseline writes the results as the
+ * new baseline instead.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API UScenarioBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UScenarioBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
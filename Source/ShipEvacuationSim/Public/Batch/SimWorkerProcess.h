@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformProcess.h"
+
+/** Launches headless simulation processes for the batch commandlets. */
+struct SHIPEVACUATIONSIM_API FSimWorkerProcess
+{
+	/**
+	 * Starts Executable on Map with -nullrhi and the given -Sim* arguments, logging to LogFile.
+	 * The editor executable also gets the project and -game. The handle is invalid on failure.
+	 */
+	static FProcHandle Launch(const FString& Executable, const FString& Map, const FString& SimArgs, const FString& LogFile, const FString& ExtraArgs);
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FSimulationParameter
+{
+	// Native or Blueprint class name without prefix, e.g. AiCharacter or FireVolume; subclasses match too
+	FString ClassName;
+	FString PropertyName;
+
+	// In property text form, as in the editor's copy/paste
+	FString Value;
+};
+
+/**
+ * Property overrides for a run, given as -SimParams="AiCharacter.WalkSpeedOnFlat=140,FireVolume.ExpansionDuration=300".
+ * The simulation manager applies them to every matching actor at the start of each run and
+ * to actors spawned during it, so parameter sweeps need no per-instance editing.
+ */
+struct SHIPEVACUATIONSIM_API FSimulationParameters
+{
+	TArray<FSimulationParameter> Entries;
+
+	static FSimulationParameters Parse(const FString& Text);
+	FString ToString() const;
+
+	bool IsEmpty() const { return Entries.Num() == 0; }
+
+	// Returns the number of properties set
+	int32 ApplyTo(UObject* Object) const;
+};
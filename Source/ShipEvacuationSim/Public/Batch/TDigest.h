@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Merging t-digest (Dunning & Ertl) for streaming quantile estimates in bounded memory.
+ * Centroids are sized by the arcsine scale function, so the tails stay accurate. The
+ * digest holds fewer than Compression centroids however many values it has seen.
+ */
+struct SHIPEVACUATIONSIM_API FTDigest
+{
+	struct FCentroid
+	{
+		double Mean = 0.0;
+		double Weight = 0.0;
+
+		friend FArchive& operator<<(FArchive& Ar, FCentroid& Centroid)
+		{
+			return Ar << Centroid.Mean << Centroid.Weight;
+		}
+	};
+
+	explicit FTDigest(double InCompression = 100.0)
+		: Compression(InCompression)
+	{
+	}
+
+	void Add(double Value, double Weight = 1.0);
+	void Merge(const FTDigest& Other);
+
+	// Q in [0, 1]; 0 when empty
+	double GetQuantile(double Q) const;
+
+	double GetTotalWeight() const { return TotalWeight + BufferWeight; }
+	int32 GetNumCentroids() const { return Centroids.Num(); }
+
+	// Folds buffered values into the centroids
+	void Compress();
+
+	friend FArchive& operator<<(FArchive& Ar, FTDigest& Digest);
+
+private:
+	double Compression = 100.0;
+
+	// Sorted by mean
+	TArray<FCentroid> Centroids;
+	double TotalWeight = 0.0;
+
+	// Values not yet merged
+	TArray<FCentroid> Buffer;
+	double BufferWeight = 0.0;
+
+	double Min = TNumericLimits<double>::Max();
+	double Max = TNumericLimits<double>::Lowest();
+
+	double ScaleK(double Q) const;
+};
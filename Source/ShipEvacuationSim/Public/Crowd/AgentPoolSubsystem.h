@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "Crowd/PopulationGenerator.h"
+#include "AgentPoolSubsystem.generated.h"
+
+class AAiCharacter;
+
+struct FAgentSpawnRequest
+{
+	TSubclassOf<AAiCharacter> AgentClass;
+
+	// Point on the navmesh; the agent stands on it
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	float WalkSpeedOnFlat = 150.f;
+	float WalkSpeedOnStairs = 100.f;
+
+	FAgentDemographics Demographics;
+
+	// None keeps the agent's own material
+	UMaterialInterface* Material = nullptr;
+};
+
+// Spawning activity since the last ResetStats
+struct FAgentPoolStats
+{
+	// New actors, and pooled agents activated again
+	int32 Allocated = 0;
+	int32 Reused = 0;
+
+	int32 ReleasedOnMuster = 0;
+
+	// Agents queued by spawners, whether or not they exist yet
+	int32 Requested = 0;
+
+	// Game-thread time spent spawning, the frames it was spread over and the longest of them
+	double SpawnSeconds = 0.0;
+	int32 SpawnFrames = 0;
+	double MaxFrameSeconds = 0.0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPooledAgentActivated, AAiCharacter*);
+
+/**
+ * Creates agents for spawners a few at a time, within SpawnBudgetMs of game-thread time
+ * per frame, so a large population does not stall one frame. Agents released at the end
+ * of a run (or on mustering) are parked instead of destroyed and activated again for the
+ * next spawn of their class, so repeated runs neither allocate actors nor leave garbage.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UAgentPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Game-thread time per frame for creating and activating agents (ms); at least one agent is spawned each frame
+	UPROPERTY(Config)
+	float SpawnBudgetMs = 4.f;
+
+	// Park agents from the pool once they muster instead of leaving them standing at the station
+	UPROPERTY(Config)
+	bool bReleaseMusteredAgents = true;
+
+	void QueueSpawn(const FAgentSpawnRequest& Request);
+
+	// Parks an agent spawned by the pool; other agents are left alone
+	void Release(AAiCharacter* Agent);
+
+	// Parks every agent from the pool and drops the queued spawns
+	void ReleaseAll();
+
+	// Called by the agent; released on the next tick, outside the muster station's callbacks
+	void NotifyMustered(AAiCharacter* Agent);
+
+	// Fired after a new or pooled agent is placed and has its speeds and demographics
+	FOnPooledAgentActivated OnAgentActivated;
+
+	int32 GetNumQueued() const { return Queue.Num() - QueueHead; }
+	int32 GetNumActive() const { return Active.Num(); }
+	int32 GetNumParked() const;
+
+	const FAgentPoolStats& GetStats() const { return Stats; }
+	void ResetStats() { Stats = FAgentPoolStats(); }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	// Consumed from QueueHead so spawning a batch does not shift the array
+	TArray<FAgentSpawnRequest> Queue;
+	int32 QueueHead = 0;
+
+	// The level keeps the actors alive
+	TSet<TWeakObjectPtr<AAiCharacter>> Active;
+	TMap<const UClass*, TArray<TWeakObjectPtr<AAiCharacter>>> Parked;
+	TArray<TWeakObjectPtr<AAiCharacter>> PendingRelease;
+
+	FAgentPoolStats Stats;
+
+	// Spawn work of the batch being drained, for its log line
+	FAgentPoolStats BatchStart;
+
+	AAiCharacter* SpawnAgent(const FAgentSpawnRequest& Request);
+	AAiCharacter* TakeParked(const UClass* AgentClass);
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AgentSpatialGridSubsystem.generated.h"
+
+class AAiCharacter;
+
+/**
+ * Uniform spatial hash of all registered agents, rebuilt once per frame.
+ * Replaces per-agent capsule overlap queries for neighbour lookups.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UAgentSpatialGridSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Cell size in cm. Z should be close to one deck so agents on different decks land in different cells.
+	UPROPERTY(Config, BlueprintReadOnly, Category = "Crowd|Spatial Grid")
+	FVector CellSize = FVector(100.f, 100.f, 250.f);
+
+	// Registration
+	void RegisterAgent(AAiCharacter* Agent);
+	void UnregisterAgent(AAiCharacter* Agent);
+
+	UFUNCTION(BlueprintPure, Category = "Crowd|Spatial Grid")
+	int32 GetNumAgents() const { return RegisteredAgents.Num(); }
+
+	// Rebuilds the hash unless it was already rebuilt this frame
+	void RebuildIfStale();
+
+	// Queries
+	UFUNCTION(BlueprintCallable, Category = "Crowd|Spatial Grid")
+	void QueryRadius(const FVector& Center, float Radius, TArray<AAiCharacter*>& OutAgents, bool bIgnoreHeight = false) const;
+
+	// Oriented box query; agents count when their capsule footprint touches the box.
+	// BoxExtent is local to BoxTransform, so a component's unscaled extent and transform can be passed as they are.
+	UFUNCTION(BlueprintCallable, Category = "Crowd|Spatial Grid")
+	void QueryBox(const FTransform& BoxTransform, const FVector& BoxExtent, TArray<AAiCharacter*>& OutAgents) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Crowd|Spatial Grid")
+	int32 CountInRadius(const FVector& Center, float Radius, bool bIgnoreHeight = false) const;
+
+	// Native iteration without building an output array. Callback receives the grid slot index.
+	void ForEachInRadius(const FVector& Center, float Radius, bool bIgnoreHeight, TFunctionRef<void(int32 Slot)> Callback) const;
+
+	AAiCharacter* GetAgentInSlot(int32 Slot) const { return SlotAgents[Slot]; }
+	const FVector& GetLocationInSlot(int32 Slot) const { return SlotLocations[Slot]; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FCellRange
+	{
+		int32 Start = 0;
+		int32 Count = 0;
+	};
+
+	TArray<TWeakObjectPtr<AAiCharacter>> RegisteredAgents;
+
+	// Per-frame snapshot, sorted so every cell is a contiguous range
+	TArray<AAiCharacter*> SlotAgents;
+	TArray<FVector> SlotLocations;
+	TArray<float> SlotRadii;
+	TMap<FIntVector, FCellRange> Cells;
+
+	float MaxAgentRadius = 0.f;
+	uint64 LastRebuildFrame = MAX_uint64;
+
+	FIntVector GetCell(const FVector& Location) const;
+	void Rebuild();
+
+	template <typename PredicateType>
+	void ForEachInBounds(const FVector& Min, const FVector& Max, PredicateType&& Predicate) const;
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "GameFramework/Actor.h"
+#include "SimulationResettable.h"
+#include "AgentSpawner.generated.h"
+
+class AAiCharacter;
+class UBoxComponent;
+
+// One group of agents in a spawn table
+USTRUCT(BlueprintType)
+struct FAgentSpawnRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	TSubclassOf<AAiCharacter> AgentClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (ClampMin = "0"))
+	int32 Count = 100;
+
+	// Agents stand inside the bounds of the actors with this tag; none uses the spawner's box
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	FName AreaTag;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	float WalkSpeedOnFlat = 150.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	float WalkSpeedOnStairs = 100.f;
+
+	// Each agent's speeds are scaled by a random factor in [1 - SpeedVariation, 1 + SpeedVariation]
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float SpeedVariation = 0.2f;
+
+	// Rows of FAgentDemographicRow (e.g. day or night passengers, officers). When set, speeds,
+	// age, gender and material are sampled from it in place of the speeds above.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (RequiredAssetDataTags = "RowStructure=/Script/ShipEvacuationSim.AgentDemographicRow"))
+	UDataTable* Demographics = nullptr;
+};
+
+/**
+ * Spawns the population in its spawn table at the start of every run, on random
+ * navigation metadata cells of each row's area. Agents come from UAgentPoolSubsystem,
+ * which spreads the work over several frames and reuses the previous run's agents.
+ * Positions, facings and demographics are drawn from a stream seeded with the run seed,
+ * so a run's population does not depend on anything else that uses random numbers before it.
+ * Nothing is spawned while replaying.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API AAgentSpawner : public AActor, public ISimulationResettable
+{
+	GENERATED_BODY()
+
+public:
+	AAgentSpawner();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Spawning")
+	UBoxComponent* SpawnArea;
+
+	// Rows of FAgentSpawnRow
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (RequiredAssetDataTags = "RowStructure=/Script/ShipEvacuationSim.AgentSpawnRow"))
+	UDataTable* SpawnTable;
+
+	UFUNCTION(BlueprintCallable, Category = "Spawning")
+	void SpawnAgents();
+
+	// The simulation manager returns the previous population to the pool; this queues the next one
+	virtual void ResetForNewRun_Implementation() override;
+
+private:
+	FDelegateHandle BakedHandle;
+
+	int32 QueueRow(const FAgentSpawnRow& Row, const FName& RowName, FRandomStream& Stream);
+};
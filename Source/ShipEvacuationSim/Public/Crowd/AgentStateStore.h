@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EAgentStateFlags : uint8
+{
+	None = 0,
+	Active = 1 << 0,			// Due for a crowd update this frame
+	Mustered = 1 << 1,
+	ResizingCapsule = 1 << 2,
+	Recovering = 1 << 3,
+};
+ENUM_CLASS_FLAGS(EAgentStateFlags);
+
+/**
+ * Structure-of-arrays agent state owned by the crowd simulation.
+ * After BuildCells() the arrays are sorted by cell, so every cell is one
+ * contiguous range that the repulsion kernel can stream through in blocks.
+ */
+struct SHIPEVACUATIONSIM_API FAgentStateStore
+{
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+	TArray<float> VelX;
+	TArray<float> VelY;
+	TArray<float> VelZ;
+	TArray<float> Radius;
+	TArray<EAgentStateFlags> Flags;
+
+	// Caller-defined id of each entry, carried through the cell sort
+	TArray<int32> SourceIndex;
+
+	int32 Num() const { return PosX.Num(); }
+
+	void Reset();
+	void Reserve(int32 Count);
+	int32 Add(const FVector& Position, const FVector& Velocity, float InRadius, EAgentStateFlags InFlags, int32 InSourceIndex);
+
+	FVector GetPosition(int32 Index) const { return FVector(PosX[Index], PosY[Index], PosZ[Index]); }
+	FVector GetVelocity(int32 Index) const { return FVector(VelX[Index], VelY[Index], VelZ[Index]); }
+	bool HasFlag(int32 Index, EAgentStateFlags Flag) const { return EnumHasAnyFlags(Flags[Index], Flag); }
+
+	// Sorts all arrays by cell and rebuilds the cell table. CellSize should be at least the query radius.
+	void BuildCells(float InCellSize);
+
+	// Calls Callback(Start, End) for every non-empty cell touching the box
+	template <typename CallbackType>
+	void ForEachCellRange(const FVector& Min, const FVector& Max, CallbackType&& Callback) const
+	{
+		const FIntVector MinCell = GetCell(Min.X, Min.Y, Min.Z);
+		const FIntVector MaxCell = GetCell(Max.X, Max.Y, Max.Z);
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+				{
+					if (const FIntPoint* Range = Cells.Find(FIntVector(X, Y, Z)))
+					{
+						Callback(Range->X, Range->Y);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	float CellSize = 100.f;
+
+	// Cell -> [Start, End) into the sorted arrays
+	TMap<FIntVector, FIntPoint> Cells;
+
+	FIntVector GetCell(float X, float Y, float Z) const
+	{
+		return FIntVector(FMath::FloorToInt(X / CellSize), FMath::FloorToInt(Y / CellSize), FMath::FloorToInt(Z / CellSize));
+	}
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FAgentStateStore;
+
+namespace CrowdKernels
+{
+	struct FRepulsionParams
+	{
+		// Neighbours further than this are ignored
+		float Radius = 80.f;
+
+		// Distance at which the push changes sign, as in the original per-actor repulsion
+		float FalloffDistance = 20.f;
+
+		// Only compute agents flagged Active; others get a zero result
+		bool bActiveOnly = true;
+	};
+
+	/**
+	 * Sums the repulsion for store entries [Begin, End) into Out (indexed like the store).
+	 * The store must have been sorted with BuildCells(CellSize >= Params.Radius).
+	 */
+	SHIPEVACUATIONSIM_API void ComputeRepulsion(const FAgentStateStore& Store, const FRepulsionParams& Params, int32 Begin, int32 End, FVector3f* Out);
+
+	// Scalar reference for the vectorised kernel above
+	SHIPEVACUATIONSIM_API void ComputeRepulsionScalar(const FAgentStateStore& Store, const FRepulsionParams& Params, int32 Begin, int32 End, FVector3f* Out);
+}
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CrowdSchedulerSubsystem.generated.h"
+
+class AAiCharacter;
+
+enum class ECrowdTask : uint8
+{
+	ThrottledUpdate,
+	StuckCheck,
+	NavMeshCheck,
+	RestoreCapsule,		// One-shot, after ShrinkCapsule
+};
+
+/**
+ * Periodic agent work (throttled update, stuck check, navmesh check, capsule restore)
+ * on a hashed time wheel instead of one world timer per agent and task.
+ *
+ * Due tasks move from the wheel to a ready queue, which is drained in batches until
+ * the frame budget is spent; whatever is left runs first next frame. Registration
+ * spreads each agent's phase evenly over the interval, so the load per frame stays
+ * flat without randomised intervals.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UCrowdSchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	float ThrottledUpdateInterval = 0.3f;
+
+	UPROPERTY(Config)
+	float StuckCheckInterval = 2.75f;
+
+	UPROPERTY(Config)
+	float NavMeshCheckInterval = 3.5f;
+
+	// Seconds per wheel slot; tasks run up to one slot late
+	UPROPERTY(Config)
+	float SlotDuration = 0.05f;
+
+	// Slots in the wheel; tasks further out than one turn wait out whole turns
+	UPROPERTY(Config)
+	int32 NumSlots = 128;
+
+	// Game-thread time per frame for running due tasks (ms). At least one batch runs every frame.
+	UPROPERTY(Config)
+	float BudgetMs = 1.0f;
+
+	// Tasks run between budget checks
+	UPROPERTY(Config)
+	int32 BatchSize = 32;
+
+	// Schedules the periodic tasks
+	void RegisterAgent(AAiCharacter* Agent);
+
+	// Drops every task of the agent, including pending one-shots
+	void UnregisterAgent(AAiCharacter* Agent);
+
+	void ScheduleOnce(AAiCharacter* Agent, ECrowdTask Task, float Delay);
+
+	// Due tasks waiting for budget
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	int32 GetBacklog() const { return Ready.Num() - ReadyHead; }
+
+	// How late the oldest task run last frame was (s)
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	float GetLastLateness() const { return LastLateness; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FAgentSlot
+	{
+		TWeakObjectPtr<AAiCharacter> Agent;
+
+		// Bumped on unregister so queued tasks of the previous occupant are dropped
+		uint32 Generation = 0;
+	};
+
+	struct FTask
+	{
+		int32 Handle = INDEX_NONE;
+		uint32 Generation = 0;
+		ECrowdTask Type = ECrowdTask::ThrottledUpdate;
+
+		// Whole wheel turns left before the task is due
+		int32 Rounds = 0;
+
+		int64 DueSlot = 0;
+	};
+
+	TArray<FAgentSlot> AgentSlots;
+	TArray<int32> FreeHandles;
+	uint32 NumRegistered = 0;
+
+	TArray<TArray<FTask>> Wheel;
+	int64 CurrentSlot = 0;
+
+	// FIFO of due tasks; entries before ReadyHead have run
+	TArray<FTask> Ready;
+	int32 ReadyHead = 0;
+	float LastLateness = 0.f;
+
+	int64 GetSlot(double Time) const;
+	float GetInterval(ECrowdTask Type) const;
+	void Schedule(int32 Handle, ECrowdTask Type, double DueTime);
+	void Advance(double Now);
+	void RunTask(const FTask& Task, double Now);
+};
@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Crowd/AgentStateStore.h"
+#include "Crowd/OrcaKernel.h"
+#include "CrowdUpdateSubsystem.generated.h"
+
+class AAiCharacter;
+class UAgentMovementComponent;
+
+// Simulation LOD activity for one run
+struct FCrowdLodStats
+{
+	int32 Demotions = 0;
+	int32 Promotions = 0;
+
+	// Unmustered agent time spent at each level
+	double FullAgentSeconds = 0.0;
+	double ReducedAgentSeconds = 0.0;
+
+	// Measured character movement tick time at each level
+	double FullMovementSeconds = 0.0;
+	double ReducedMovementSeconds = 0.0;
+
+	// Movement time the reduced agents would have cost at full simulation, minus what they did cost.
+	// RVO avoidance and the skipped timers are not included, so this is a lower bound.
+	double GetMovementSecondsSaved() const;
+};
+
+enum class EAgentMovementKind : uint8
+{
+	Walking,
+	NavMeshWalking,
+	Reduced,		// Engine nav walking under the simulation LOD
+	Num
+};
+
+// Measured character movement tick time per kind of movement, for one run
+struct FAgentMovementCost
+{
+	double Seconds[int32(EAgentMovementKind::Num)] = {};
+	int64 Ticks[int32(EAgentMovementKind::Num)] = {};
+
+	// Mean time per agent movement tick (microseconds)
+	double GetMicroseconds(EAgentMovementKind Kind) const;
+};
+
+/**
+ * Single tick for all agents. Gathers agents into a structure-of-arrays store,
+ * computes repulsion (vectorised), flow field steering, capsule resize and recovery
+ * steering in parallel, then writes the results back to the characters on the game thread.
+ *
+ * With bUseOrca, local avoidance is an ORCA solve for every walking agent each frame
+ * (CrowdKernels::ComputeOrcaVelocities) in place of the engine's RVO and the repulsion term.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UCrowdUpdateSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Per-agent update interval range, matching the old randomised actor tick interval
+	UPROPERTY(Config)
+	float MinUpdateInterval = 0.2f;
+
+	UPROPERTY(Config)
+	float MaxUpdateInterval = 0.5f;
+
+	// Agents per ParallelFor work item
+	UPROPERTY(Config)
+	int32 BatchSize = 64;
+
+	UPROPERTY(Config)
+	float RepulsionRadius = 80.f;
+
+	// ORCA local avoidance
+	UPROPERTY(Config)
+	bool bUseOrca = true;
+
+	UPROPERTY(Config)
+	float OrcaNeighbourDistance = 200.f;
+
+	UPROPERTY(Config)
+	int32 OrcaMaxNeighbours = 10;
+
+	UPROPERTY(Config)
+	float OrcaTimeHorizon = 1.5f;
+
+	// Fixed solver step and a total neighbour order, so fixed-step runs repeat exactly
+	UPROPERTY(Config)
+	bool bDeterministicOrca = false;
+
+	UPROPERTY(Config)
+	float OrcaFixedTimeStep = 0.05f;
+
+	// Simulation LOD: agents with nobody within LodDemoteRadius and no hazard within LodHazardRadius
+	// switch to nav walking without avoidance, and switch back once someone is within LodPromoteRadius.
+	// Off by default so existing experiments keep their results; -SimLod turns it on for a batch.
+	UPROPERTY(Config)
+	bool bSimulationLod = false;
+
+	UPROPERTY(Config)
+	float LodDemoteRadius = 400.f;
+
+	UPROPERTY(Config)
+	float LodPromoteRadius = 300.f;
+
+	// Distance to fire and congested areas within which agents stay at full simulation
+	UPROPERTY(Config)
+	float LodHazardRadius = 1000.f;
+
+	void RegisterAgent(AAiCharacter* Agent);
+	void UnregisterAgent(AAiCharacter* Agent);
+
+	// Mustered agents stop updating but stay in the store as neighbours
+	void MarkMustered(AAiCharacter* Agent);
+
+	const FAgentStateStore& GetStateStore() const { return Store; }
+
+	// Every registered agent, including mustered ones
+	void ForEachAgent(TFunctionRef<void(const AAiCharacter*)> Callback) const;
+
+	// Called when an agent has moved since its last stuck check
+	void NotifyAgentProgress();
+
+	// World time of the last NotifyAgentProgress
+	double GetLastProgressTime() const { return LastProgressTime; }
+
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	int32 GetNumAgents() const { return Agents.Num(); }
+
+	// Simulation LOD
+	const FCrowdLodStats& GetLodStats() const { return LodStats; }
+	void ResetLodStats() { LodStats = FCrowdLodStats(); MovementCost = FAgentMovementCost(); }
+
+	const FAgentMovementCost& GetMovementCost() const { return MovementCost; }
+
+	// Called by agent movement components with the duration of each tick
+	void AddMovementTime(EAgentMovementKind Kind, double Seconds);
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FAgentRecord
+	{
+		TWeakObjectPtr<AAiCharacter> Agent;
+		UAgentMovementComponent* Movement = nullptr;
+		float Interval = 0.f;
+		float Accumulated = 0.f;
+		bool bMustered = false;
+
+		// Flow field steering, sampled at the update interval and applied every frame
+		FVector FlowInput = FVector::ZeroVector;
+	};
+
+	// Per-agent data for the parallel pass that is not part of the shared store, plus its results
+	struct FAgentFrame
+	{
+		AAiCharacter* Agent = nullptr;
+		float DeltaTime = 0.f;
+		bool bActive = false;
+
+		bool bIsResizingCapsule = false;
+		float CapsuleRadius = 0.f;
+		float CapsuleHalfHeight = 0.f;
+		float TargetCapsuleRadius = 0.f;
+		float TargetCapsuleHalfHeight = 0.f;
+		float ResizeSpeed = 0.f;
+
+		bool bIsRecovering = false;
+		FVector RecoveryTargetLocation = FVector::ZeroVector;
+
+		int32 FlowFieldGoal = INDEX_NONE;
+		FVector FeetLocation = FVector::ZeroVector;
+
+		bool bReduced = false;
+		bool bLodEligible = false;
+
+		// Results
+		FVector MoveInput = FVector::ZeroVector;
+		FVector FlowInput = FVector::ZeroVector;
+		float NewCapsuleRadius = 0.f;
+		float NewCapsuleHalfHeight = 0.f;
+		bool bFinishedResizing = false;
+		FVector RecoveryStepLocation = FVector::ZeroVector;
+		bool bWantReduced = false;
+	};
+
+	TArray<FAgentRecord> Agents;
+
+	// Store entries point back at Agents/Frames through SourceIndex
+	FAgentStateStore Store;
+	TArray<FAgentFrame> Frames;
+	TArray<FVector3f> Repulsion;
+	int32 NumActive = 0;
+
+	// Indexed like Agents
+	TArray<CrowdKernels::FOrcaAgent> OrcaAgents;
+	TArray<FVector2f> OrcaVelocities;
+
+	// Fire and congested area bounds, gathered each frame for the LOD check
+	TArray<FBox> Hazards;
+	FCrowdLodStats LodStats;
+	FAgentMovementCost MovementCost;
+
+	double LastProgressTime = 0.0;
+
+	void GatherHazards();
+	void GatherFrames(float DeltaTime);
+	void ComputeFrames();
+	void SolveAvoidance(float DeltaTime);
+	void ApplyFrames();
+};
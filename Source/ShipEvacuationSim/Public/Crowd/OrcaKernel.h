@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FAgentStateStore;
+
+namespace CrowdKernels
+{
+	struct FOrcaParams
+	{
+		// Neighbours further than this (horizontally) are ignored
+		float NeighbourDistance = 200.f;
+
+		// Agents further apart in height are on different decks
+		float MaxHeightDifference = 100.f;
+
+		int32 MaxNeighbours = 10;
+
+		// How far ahead (s) collisions with other agents are avoided
+		float TimeHorizon = 1.5f;
+
+		// Step used to resolve agents that already overlap
+		float TimeStep = 0.05f;
+
+		// Break neighbour distance ties by source index instead of store order
+		bool bDeterministic = false;
+	};
+
+	// Per agent, indexed by the store's SourceIndex
+	struct FOrcaAgent
+	{
+		FVector2f PreferredVelocity = FVector2f::ZeroVector;
+		float MaxSpeed = 0.f;
+		bool bSolve = false;
+	};
+
+	/**
+	 * Optimal reciprocal collision avoidance (van den Berg et al.) in the horizontal plane.
+	 * Each agent in store entries [Begin, End) with bSolve gets the velocity closest to its
+	 * preferred one that avoids its nearest neighbours for TimeHorizon, assuming they take
+	 * half the avoidance. Mustered neighbours do not move, so the agent takes all of it.
+	 *
+	 * Agents read only the store and write only their own Out[SourceIndex], so any split
+	 * of the range over threads gives the same result. The store must have been sorted with
+	 * BuildCells(CellSize >= Params.NeighbourDistance).
+	 */
+	SHIPEVACUATIONSIM_API void ComputeOrcaVelocities(const FAgentStateStore& Store, const FOrcaParams& Params, const FOrcaAgent* Agents, int32 Begin, int32 End, FVector2f* Out);
+}
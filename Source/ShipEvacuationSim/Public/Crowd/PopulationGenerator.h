@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "PopulationGenerator.generated.h"
+
+class UMaterialInterface;
+
+/**
+ * One demographic group of a population, as in the IMO MSC.1/Circ.1533 population tables
+ * (e.g. "females 30-50 years", "males over 50, mobility impaired 1"). Same fields as the
+ * S_AgentAttributes Blueprint struct, so the Day/Night attribute tables carry over.
+ */
+USTRUCT(BlueprintType)
+struct FAgentDemographicRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics")
+	bool bMale = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics")
+	bool bMobilityImpaired = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0"))
+	int32 AgeMin = 18;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0"))
+	int32 AgeMax = 30;
+
+	// Share of the population in this group; shares are normalised over the table
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float SpawnPercentage = 10.f;
+
+	// Uniform speed ranges (cm/s)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float WalkSpeedOnFlatMin = 93.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float WalkSpeedOnFlatMax = 155.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float WalkSpeedOnStairsMin = 55.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float WalkSpeedOnStairsMax = 92.f;
+
+	// Response time range (s)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float AwarenessMin = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics", meta = (ClampMin = "0.0"))
+	float AwarenessMax = 0.f;
+
+	// Body material for this group (e.g. MI_FemalePassenger, MI_AgentOfficer); none keeps the class default
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Demographics")
+	UMaterialInterface* Material = nullptr;
+};
+
+// Sampled attributes of one agent
+USTRUCT(BlueprintType)
+struct FAgentDemographics
+{
+	GENERATED_BODY()
+
+	// Row of the demographic table the agent was drawn from
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Demographics")
+	FName Group;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Demographics")
+	int32 Age = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Demographics")
+	bool bMale = true;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Demographics")
+	bool bMobilityImpaired = false;
+
+	// Seconds before the agent responds to the alarm
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Demographics")
+	float Awareness = 0.f;
+};
+
+struct FAgentProfile
+{
+	FAgentDemographics Demographics;
+	float WalkSpeedOnFlat = 150.f;
+	float WalkSpeedOnStairs = 100.f;
+	UMaterialInterface* Material = nullptr;
+};
+
+namespace PopulationGenerator
+{
+	/**
+	 * Samples Count agents from a table of FAgentDemographicRow groups in one pass.
+	 * Group sizes follow SpawnPercentage exactly (largest remainder rounding) rather than
+	 * being drawn per agent, so small populations keep the table's composition. Age, speed
+	 * and response time are uniform within the group's ranges. One draw sets both speeds, so
+	 * a fast walker is also fast on stairs. The result is shuffled, so spawn order does not
+	 * follow the groups. The same stream state gives the same population.
+	 */
+	SHIPEVACUATIONSIM_API void Generate(const UDataTable& Table, int32 Count, FRandomStream& Stream, TArray<FAgentProfile>& OutProfiles);
+
+	// Sizes of the groups for Count agents, in row order
+	SHIPEVACUATIONSIM_API TArray<int32> AllocateGroups(TConstArrayView<const FAgentDemographicRow*> Groups, int32 Count);
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "SimulationResettable.h"
+#include "ProxyCrowdSpawner.generated.h"
+
+class UBoxComponent;
+class UDataTable;
+
+/**
+ * Places proxy passengers (UProxyCrowdSubsystem) on random navigation metadata cells
+ * inside its box at the start of every run. Everything random is drawn from a stream
+ * seeded with the run seed. Nothing is spawned while replaying.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API AProxyCrowdSpawner : public AActor, public ISimulationResettable
+{
+	GENERATED_BODY()
+
+public:
+	AProxyCrowdSpawner();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Spawning")
+	UBoxComponent* SpawnArea;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (ClampMin = "0"))
+	int32 NumAgents = 1000;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float OfficerRatio = 0.05f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	float WalkSpeedOnFlat = 150.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning")
+	float WalkSpeedOnStairs = 100.f;
+
+	// Each agent's speeds are scaled by a random factor in [1 - SpeedVariation, 1 + SpeedVariation]
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float SpeedVariation = 0.2f;
+
+	// Rows of FAgentDemographicRow; when set, speeds and response times are sampled from it in place of the speeds above
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawning", meta = (RequiredAssetDataTags = "RowStructure=/Script/ShipEvacuationSim.AgentDemographicRow"))
+	UDataTable* Demographics = nullptr;
+
+	UFUNCTION(BlueprintCallable, Category = "Spawning")
+	void SpawnAgents();
+
+	// The simulation manager clears all proxies; this places the next population
+	virtual void ResetForNewRun_Implementation() override;
+
+private:
+	FDelegateHandle BakedHandle;
+};
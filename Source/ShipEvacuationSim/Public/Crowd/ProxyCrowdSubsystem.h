@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Crowd/AgentStateStore.h"
+#include "Logging/AgentLogEvent.h"
+#include "Replay/TrajectoryFile.h"
+#include "ProxyCrowdSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+// Passengers without an actor: one entry per agent in every array
+struct SHIPEVACUATIONSIM_API FProxyAgents
+{
+	// At the feet, on a navigation metadata cell
+	TArray<FVector> Location;
+	TArray<FVector> Velocity;
+	TArray<float> WalkSpeedOnFlat;
+	TArray<float> WalkSpeedOnStairs;
+	TArray<float> Radius;
+	TArray<int32> Goal;
+	TArray<ETrajectoryAgentState> State;
+	TArray<uint8> bOfficer;
+
+	// World time the agent responds to the alarm and starts moving
+	TArray<double> ResponseTime;
+
+	// Stuck detection and recovery, as on AAiCharacter
+	TArray<FVector> LastMoveLocation;
+	TArray<float> TimeSinceLastMove;
+	TArray<double> NextStuckCheck;
+	TArray<double> RestoreRadiusTime;
+	TArray<FVector> RecoveryTarget;
+
+	int32 Num() const { return Location.Num(); }
+	void Reset();
+};
+
+/**
+ * Data-only passengers for populations too large for one ACharacter each. Agents
+ * follow the muster flow fields, push apart with the crowd repulsion kernel, stay on
+ * the navigation metadata cells instead of sweeping against geometry, and are drawn
+ * by a single instanced static mesh.
+ *
+ * Stuck detection (capsule shrink), off-navmesh recovery and mustering follow
+ * AAiCharacter, and events go to the same run log. Proxies and full agents do not
+ * push each other.
+ *
+ * Per-instance custom data: 0 = ETrajectoryAgentState flags, 1 = 1 for officers.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UProxyCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	FSoftObjectPath AgentMesh = FSoftObjectPath(TEXT("/Game/Assets/Agents/SM_Agent.SM_Agent"));
+
+	// Leave empty to keep the mesh's own material; a replacement should read the custom data above
+	UPROPERTY(Config)
+	FSoftObjectPath AgentMaterial;
+
+	// Agents per ParallelFor work item
+	UPROPERTY(Config)
+	int32 BatchSize = 256;
+
+	UPROPERTY(Config)
+	float RepulsionRadius = 80.f;
+
+	UPROPERTY(Config)
+	float AgentRadius = 34.f;
+
+	// Capsule half height of the actor agents; recordings store capsule centres for both
+	UPROPERTY(Config)
+	float AgentHalfHeight = 88.f;
+
+	// How quickly velocity turns towards the desired one (1/s)
+	UPROPERTY(Config)
+	float Acceleration = 8.f;
+
+	// Log and recording ids start here, clear of UObject unique ids
+	static constexpr int32 FirstAgentId = 0x40000000;
+
+	int32 SpawnAgent(const FVector& Location, float WalkSpeedOnFlat, float WalkSpeedOnStairs, bool bOfficer, float ResponseDelay = 0.f);
+
+	// Removes every agent, for the next run
+	void ResetAgents();
+
+	const FProxyAgents& GetAgents() const { return Agents; }
+
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	int32 GetNumAgents() const { return Agents.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	int32 GetNumMustered() const { return NumMustered; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	enum EStepEvent : uint8
+	{
+		Event_None = 0,
+		Event_OffGrid = 1 << 0,
+		Event_Progress = 1 << 1,
+		Event_Stuck = 1 << 2,
+		Event_Recovered = 1 << 3,
+		Event_Mustered = 1 << 4,
+		Event_StateChanged = 1 << 5,
+	};
+
+	FProxyAgents Agents;
+	int32 NumMustered = 0;
+
+	FAgentStateStore Store;
+	TArray<FVector3f> Repulsion;
+	TArray<uint8> Events;
+	TArray<FTransform> Transforms;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+	void EnsureInstances();
+	void Step(float DeltaTime);
+	void HandleEvents();
+	void UpdateInstances();
+
+	int32 FindNearbyCell(const FVector& Location, float Reach) const;
+	void LogEvent(int32 Agent, EAgentLogEvent Event) const;
+};
@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AgentLogEvent.generated.h"
+
+// Agent events in the run log (USimulationLogSubsystem::LogAgentEvent)
+UENUM(BlueprintType)
+enum class EAgentLogEvent : uint8
+{
+	Mustered,
+	Stuck,
+	OffNavMesh,
+	Recovered,
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Typed columnar run log (.simlog).
+ *
+ * The file is a header followed by self-contained chunks: table definitions,
+ * row blocks (each column stored contiguously) and a summary. Every flush
+ * appends whole chunks, so a run that dies mid-way still leaves a readable prefix.
+ */
+enum class ERunLogColumnType : uint8
+{
+	Int32,
+	Int64,
+	Float,
+	Double,
+};
+
+struct SHIPEVACUATIONSIM_API FRunLogColumn
+{
+	FString Name;
+	ERunLogColumnType Type = ERunLogColumnType::Double;
+};
+
+struct SHIPEVACUATIONSIM_API FRunLogTable
+{
+	FString Name;
+	TArray<FRunLogColumn> Columns;
+};
+
+namespace RunLogFile
+{
+	static constexpr uint32 Magic = 0x474C5353;	// "SSLG"
+	static constexpr uint32 Version = 1;
+	static constexpr int32 MaxColumns = 8;
+
+	enum class EChunk : uint8
+	{
+		Table = 1,
+		Rows = 2,
+		Summary = 3,
+	};
+
+	inline bool IsIntegerType(ERunLogColumnType Type)
+	{
+		return Type == ERunLogColumnType::Int32 || Type == ERunLogColumnType::Int64;
+	}
+
+	// Bytes per value on disk
+	inline int32 GetTypeSize(ERunLogColumnType Type)
+	{
+		return Type == ERunLogColumnType::Int32 || Type == ERunLogColumnType::Float ? 4 : 8;
+	}
+}
+
+/** Appends chunks to a .simlog file. Not thread safe; owned by the logger thread. */
+class SHIPEVACUATIONSIM_API FRunLogWriter
+{
+public:
+	~FRunLogWriter();
+
+	bool Open(const FString& FilePath);
+	void Close();
+	bool IsOpen() const { return Archive.IsValid(); }
+
+	void WriteTable(int32 TableId, const FRunLogTable& Table);
+
+	// Columns[c][r] holds row r of column c; values are narrowed to the column type here
+	void WriteRows(int32 TableId, const FRunLogTable& Table, const TArray<TArray<double>>& Columns);
+
+	void WriteSummary(const TArray<TPair<FString, FString>>& Summary);
+	void Flush();
+
+private:
+	TUniquePtr<FArchive> Archive;
+};
+
+/** Reads a .simlog back into memory and exports it as CSV. */
+class SHIPEVACUATIONSIM_API FRunLogReader
+{
+public:
+	bool Load(const FString& FilePath);
+
+	const TArray<FRunLogTable>& GetTables() const { return Tables; }
+	int32 FindTable(const FString& Name) const;
+	int32 GetNumRows(int32 TableId) const;
+	double GetValue(int32 TableId, int32 Column, int32 Row) const;
+
+	const TArray<TPair<FString, FString>>& GetSummary() const { return Summary; }
+	const FString* FindSummary(const FString& Key) const;
+
+	// Header row is the column names; integer columns are written without decimals
+	FString TableToCsv(int32 TableId) const;
+	FString SummaryToCsv() const;
+
+	/**
+	 * Writes <BaseName>.csv for the first table, <BaseName>_<Table>.csv for the
+	 * others and <BaseName>_Summary.csv, next to each other in Directory.
+	 */
+	bool ExportCsv(const FString& Directory, const FString& BaseName) const;
+
+private:
+	TArray<FRunLogTable> Tables;
+
+	// Per table, per column values widened to double
+	TArray<TArray<TArray<double>>> Data;
+
+	TArray<TPair<FString, FString>> Summary;
+};
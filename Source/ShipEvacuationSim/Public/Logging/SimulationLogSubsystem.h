@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Logging/AgentLogEvent.h"
+#include "Logging/SimulationRunLogger.h"
+#include "Tasks/Task.h"
+#include "SimulationLogSubsystem.generated.h"
+
+/**
+ * Owns the run log for the current simulation run. Gameplay code records
+ * progress, zone densities and agent events here; rows are buffered and
+ * written by FSimulationRunLogger on its own thread.
+ *
+ * Each run produces Run_N.simlog plus a CSV export written on a worker after EndRun:
+ * Run_N.csv (progress), Run_N_ZoneDensity.csv, Run_N_AgentEvents.csv and Run_N_Summary.csv.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API USimulationLogSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Seconds of simulated time between flushes to disk
+	UPROPERTY(BlueprintReadWrite, Category = "Logging")
+	float FlushInterval = 10.0f;
+
+	UPROPERTY(BlueprintReadWrite, Category = "Logging")
+	bool bExportCsv = true;
+
+	void BeginRun(const FString& Directory, int32 RunIndex);
+	void EndRun();
+
+	UFUNCTION(BlueprintPure, Category = "Logging")
+	bool IsRunActive() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Logging")
+	void LogProgress(int32 AgentsMustered, int32 AgentsActive);
+
+	UFUNCTION(BlueprintCallable, Category = "Logging")
+	void LogZoneDensity(const AActor* Zone, int32 AgentCount, float AreaUsage, float SlowRatio, bool bCongested);
+
+	UFUNCTION(BlueprintCallable, Category = "Logging")
+	void LogAgentEvent(const AActor* Agent, EAgentLogEvent Event);
+
+	// For agents without an actor; ids must not collide with UObject unique ids
+	void LogAgentEventById(int32 AgentId, EAgentLogEvent Event);
+
+	UFUNCTION(BlueprintCallable, Category = "Logging")
+	void SetSummary(const FString& Key, const FString& Value);
+
+	void Flush();
+
+	// USubsystem
+	virtual void Deinitialize() override;
+
+private:
+	TUniquePtr<FSimulationRunLogger> Logger;
+
+	FString RunDirectory;
+	FString RunBaseName;
+	FString RunLogPath;
+	double RunStartTime = 0.0;
+
+	int32 ProgressTable = INDEX_NONE;
+	int32 ZoneTable = INDEX_NONE;
+	int32 EventTable = INDEX_NONE;
+
+	// Zone ids are stable for a run; names go to the summary
+	TMap<TWeakObjectPtr<const AActor>, int32> ZoneIds;
+
+	FTimerHandle FlushTimer;
+
+	// CSV export of the last ended run
+	UE::Tasks::FTask ExportTask;
+
+	double GetRunTime() const;
+	int32 GetZoneId(const AActor* Zone);
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "SimulationPerfSubsystem.generated.h"
+
+class USimulationLogSubsystem;
+
+// "stat Simulation" in the console; the Simulation trace channel in Unreal Insights (-trace=cpu,counters,Simulation)
+DECLARE_STATS_GROUP(TEXT("Simulation"), STATGROUP_Simulation, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd update"), STAT_Sim_CrowdUpdate, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Agent movement"), STAT_Sim_AgentMovement, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Agent tasks"), STAT_Sim_AgentTasks, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Throttled update"), STAT_Sim_ThrottledUpdate, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Stuck check"), STAT_Sim_StuckCheck, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Nav width estimate"), STAT_Sim_NavWidthEstimate, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Nav recovery check"), STAT_Sim_NavRecoveryCheck, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Nav query callbacks"), STAT_Sim_NavQueryCallbacks, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Congestion check"), STAT_Sim_CongestionCheck, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire expansion"), STAT_Sim_FireExpansion, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Nav update submit"), STAT_Sim_NavUpdateSubmit, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Agent spawn"), STAT_Sim_AgentSpawn, STATGROUP_Simulation, SHIPEVACUATIONSIM_API);
+
+UE_TRACE_CHANNEL_EXTERN(SimulationChannel, SHIPEVACUATIONSIM_API);
+
+// Systems timed for the run perf summary; keep in step with the STAT_Sim_ cycle stats
+enum class ESimPerfSystem : uint8
+{
+	CrowdUpdate,
+	AgentMovement,
+	AgentTasks,
+	ThrottledUpdate,
+	StuckCheck,
+	NavWidthEstimate,
+	NavRecoveryCheck,
+	NavQueryCallbacks,
+	CongestionCheck,
+	FireExpansion,
+	NavUpdateSubmit,
+	AgentSpawn,
+	Num
+};
+
+enum class ESimPerfCounter : uint8
+{
+	AgentsTicked,
+	OverlapsQueried,
+	NavQueries,
+	RebuildsRequested,
+	AgentsAllocated,
+	AgentsReused,
+	Num
+};
+
+namespace SimulationPerf
+{
+	// Game thread only
+	SHIPEVACUATIONSIM_API void AddCycles(ESimPerfSystem System, uint64 Cycles);
+
+	// Adds to the stat, the trace counter and the run total
+	SHIPEVACUATIONSIM_API void AddCount(ESimPerfCounter Counter, int32 Amount = 1);
+}
+
+struct FSimPerfScope
+{
+	explicit FSimPerfScope(ESimPerfSystem InSystem)
+		: System(InSystem)
+		, StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FSimPerfScope()
+	{
+		SimulationPerf::AddCycles(System, FPlatformTime::Cycles64() - StartCycles);
+	}
+
+private:
+	ESimPerfSystem System;
+	uint64 StartCycles;
+};
+
+// Times the rest of the enclosing scope for stat Simulation, Insights and the run perf summary
+#define SIM_SCOPE_CYCLE_COUNTER(System) \
+	SCOPE_CYCLE_COUNTER(STAT_Sim_##System); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Sim_##System, SimulationChannel); \
+	const FSimPerfScope PREPROCESSOR_JOIN(SimPerfScope_, __LINE__)(ESimPerfSystem::System)
+
+/**
+ * Per-run performance record. Collects wall-clock frame times and the time and counts
+ * reported through SIM_SCOPE_CYCLE_COUNTER / SimulationPerf::AddCount, and writes them into
+ * the run's summary (frame time mean/p95/p99, mean ms per frame for each system, totals
+ * for each counter), so every experiment batch is also a performance record.
+ *
+ * System times are inclusive: a scope nested in another counts towards both.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API USimulationPerfSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void BeginRun();
+	void WriteSummary(USimulationLogSubsystem& Log) const;
+
+	int32 GetNumFrames() const { return FrameMs.Num(); }
+
+	// 0..100, over the frames of the current run
+	float GetFrameMsPercentile(float Percentile) const;
+
+	// USubsystem
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+private:
+	TArray<float> FrameMs;
+	double LastTickStart = 0.0;
+
+	FDelegateHandle WorldTickHandle;
+
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime);
+};
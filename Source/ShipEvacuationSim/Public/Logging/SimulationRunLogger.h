@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/Runnable.h"
+#include "Logging/RunLogFile.h"
+
+/**
+ * Writes a run log on a background thread.
+ *
+ * The game thread pushes fixed-size rows into a lock-free ring buffer; the
+ * logger thread gathers them into per-table columns and only touches the file
+ * when Flush() or Close() is called. Producer calls are game thread only.
+ */
+class SHIPEVACUATIONSIM_API FSimulationRunLogger : public FRunnable
+{
+public:
+	explicit FSimulationRunLogger(uint32 RingCapacity = 1 << 16);
+	virtual ~FSimulationRunLogger() override;
+
+	bool Open(const FString& FilePath);
+
+	// Blocks until everything queued so far, plus the summary, is on disk
+	void Close();
+
+	bool IsOpen() const { return Thread != nullptr; }
+
+	// Tables may be defined before or after Open; returns the table id
+	int32 DefineTable(const FString& Name, const TArray<FRunLogColumn>& Columns);
+
+	// Values are given in column order and narrowed to the column types when written
+	void AppendRow(int32 TableId, std::initializer_list<double> Values);
+
+	// Summary entries are written once, on Close
+	void SetSummary(const FString& Key, const FString& Value);
+
+	// Asks the logger thread to write everything queued so far
+	void Flush();
+
+	// Number of times the producer had to wait for a full ring buffer
+	int32 GetNumStalls() const { return NumStalls; }
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	enum ECommand : int32
+	{
+		Command_Flush = -1,
+		Command_Close = -2,
+	};
+
+	struct FRecord
+	{
+		int32 TableId = 0;
+		int32 NumValues = 0;
+		double Values[RunLogFile::MaxColumns];
+	};
+
+	void Enqueue(const FRecord& Record);
+	void Drain();
+	void WritePending();
+
+	TCircularQueue<FRecord> Queue;
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	TAtomic<bool> bStopping { false };
+	int32 NumStalls = 0;
+
+	// Shared with the logger thread
+	FCriticalSection Lock;
+	TArray<FRunLogTable> Tables;
+	TArray<TPair<FString, FString>> Summary;
+
+	// Logger thread only
+	FRunLogWriter Writer;
+	int32 NumTablesWritten = 0;
+	TArray<TArray<TArray<double>>> Pending;
+};
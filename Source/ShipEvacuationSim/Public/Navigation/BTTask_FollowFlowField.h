@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_FollowFlowField.generated.h"
+
+/**
+ * Drop-in for Move To on the way to a muster station: the agent follows the
+ * station's shared flow field and the task succeeds once the agent has mustered.
+ * Fails straight away when the field is not ready, so a Move To fallback can follow.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API UBTTask_FollowFlowField : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_FollowFlowField();
+
+	// Muster station actor; leave unset to head for the cheapest station
+	UPROPERTY(EditAnywhere, Category = "Flow Field")
+	FBlackboardKeySelector MusterStationKey;
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+};
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_MoveViaDeckGraph.generated.h"
+
+/**
+ * Drop-in for Move To over long distances: the agent walks portal to portal along
+ * the deck graph's route, so each navmesh query only covers the leg to the next
+ * portal. Moves straight to the goal when the graph is not built.
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API UBTTask_MoveViaDeckGraph : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_MoveViaDeckGraph();
+
+	// Actor or location to move to
+	UPROPERTY(EditAnywhere, Category = "Deck Graph")
+	FBlackboardKeySelector GoalKey;
+
+	UPROPERTY(EditAnywhere, Category = "Deck Graph", meta = (ClampMin = "0.0"))
+	float AcceptanceRadius = 50.f;
+
+	// Should stay below the deck graph's PortalRadius, or the agent stops short of each portal for good
+	UPROPERTY(EditAnywhere, Category = "Deck Graph", meta = (ClampMin = "0.0"))
+	float WaypointAcceptanceRadius = 50.f;
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+private:
+	struct FMoveMemory
+	{
+		FVector Waypoint;
+	};
+
+	bool GetGoal(const UBehaviorTreeComponent& OwnerComp, FVector& OutGoal) const;
+
+	// Moves to the next waypoint towards the goal; Succeeded once there, Failed when the move cannot start
+	EBTNodeResult::Type MoveToNextWaypoint(UBehaviorTreeComponent& OwnerComp, FMoveMemory& Memory) const;
+};
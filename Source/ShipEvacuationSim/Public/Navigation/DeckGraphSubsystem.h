@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "DeckGraphSubsystem.generated.h"
+
+class UNavArea;
+class UNavMetadataSubsystem;
+
+/**
+ * Abstract route graph over the ship: deck regions and stairwells, joined by
+ * portals where they meet. Long routes are planned over the portals first, so
+ * the navmesh only has to find the local segment to the next portal.
+ *
+ * - Regions are connected metadata cells on one deck (BP_DeckVolume bounds when the
+ *   map has them, baked deck ids otherwise); stair cells form their own regions.
+ * - Portal-to-portal costs inside a region are navmesh path costs, so they include
+ *   the nav areas. They are filled in and refreshed a few per frame within a budget.
+ * - A fire or congestion modifier marks stale the cached paths it overlaps, plus the
+ *   unreachable edges on the decks it touches, since it may have opened them again;
+ *   stale edges keep their old cost until the navmesh has finished rebuilding.
+ *
+ * Agents use it through UBTTask_MoveViaDeckGraph, which moves to GetNextWaypoint.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UDeckGraphSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(Config)
+	FString DeckVolumeClassPrefix = TEXT("BP_DeckVolume");
+
+	// Game-thread time per frame spent refreshing portal costs (ms)
+	UPROPERTY(Config)
+	float RefreshBudgetMs = 1.0f;
+
+	// An agent this close to a portal (cm) has reached it; GetNextWaypoint returns the one after
+	UPROPERTY(Config)
+	float PortalRadius = 100.f;
+
+	// Locations are at the feet. Waypoints are the portals to pass through, then End.
+	UFUNCTION(BlueprintCallable, Category = "Navigation")
+	bool PlanRoute(const FVector& Start, const FVector& End, TArray<FVector>& OutWaypoints) const;
+
+	// First waypoint of PlanRoute not yet reached: the only part of the route that needs a navmesh query now
+	UFUNCTION(BlueprintCallable, Category = "Navigation")
+	FVector GetNextWaypoint(const FVector& Start, const FVector& End) const;
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumRegions() const { return Regions.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumPortals() const { return Portals.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumStaleEdges() const { return NumStaleEdges; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FRegion
+	{
+		bool bStairs = false;
+		int32 Deck = 0;
+		TArray<int32> Portals;
+	};
+
+	struct FPortal
+	{
+		FVector Location = FVector::ZeroVector;
+		int32 RegionA = INDEX_NONE;
+		int32 RegionB = INDEX_NONE;
+		TArray<int32> Edges;
+	};
+
+	// Path between two portals of one region
+	struct FEdge
+	{
+		int32 PortalA = INDEX_NONE;
+		int32 PortalB = INDEX_NONE;
+		int32 Region = INDEX_NONE;
+
+		// Straight-line distance until the first refresh; MAX_flt when there is no path
+		float Cost = 0.f;
+		bool bStale = true;
+		TArray<FVector> PathPoints;
+	};
+
+	UPROPERTY(Transient)
+	TObjectPtr<UNavMetadataSubsystem> NavMeta;
+
+	TArray<int32> CellRegions;
+	TArray<FRegion> Regions;
+	TArray<FPortal> Portals;
+	TArray<FEdge> Edges;
+
+	int32 NumStaleEdges = 0;
+	int32 RefreshCursor = 0;
+
+	TMap<TWeakObjectPtr<const AActor>, FBox> ModifierBounds;
+
+	FDelegateHandle BakedHandle;
+	FDelegateHandle AreaHandle;
+
+	void Rebuild();
+	void BuildRegions();
+	void BuildPortals();
+	int32 GetRegionAt(const FVector& Location) const;
+
+	void RefreshEdge(FEdge& Edge);
+	void OnAreaSubmitted(const AActor* Owner, const FBox& Bounds, TSubclassOf<UNavArea> AreaClass);
+};
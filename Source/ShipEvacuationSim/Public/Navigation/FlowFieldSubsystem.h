@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "Templates/SubclassOf.h"
+#include "FlowFieldSubsystem.generated.h"
+
+class UNavArea;
+class UNavMetadataSubsystem;
+struct FFlowFieldGraph;
+
+/**
+ * One cost-to-go field per muster station over the navigation metadata cells, so
+ * agents sample a direction instead of each requesting (and re-planning) a path.
+ *
+ * Costs follow the nav areas: distance times the area's DefaultCost, plus its
+ * FixedAreaEnteringCost when crossing into it. Area changes arrive through the nav
+ * update scheduler, mark only the cells they cover, and each field is repaired from
+ * those cells on a worker task; agents keep sampling the previous field until the
+ * repaired one is swapped in.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UFlowFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Muster stations are actors with this tag or whose class name starts with the prefix
+	UPROPERTY(Config)
+	FName MusterStationTag = TEXT("MusterStation");
+
+	UPROPERTY(Config)
+	FString MusterStationClassPrefix = TEXT("BP_MusterStation");
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumGoals() const { return Fields.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 FindGoal(const AActor* MusterStation) const;
+
+	// Station with the lowest cost-to-go from the location, INDEX_NONE if none is reachable yet
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 FindNearestGoal(const FVector& Location) const;
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	bool IsGoalReady(int32 Goal) const;
+
+	// Location is at the agent's feet; returns false off the grid or before the field is solved
+	bool SampleDirection(int32 Goal, const FVector& Location, FVector& OutDirection) const;
+
+	// In nav cost units (cm for the default area); negative when unknown or unreachable
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	float GetCostToGo(int32 Goal, const FVector& Location) const;
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	float GetLastSolveMs() const { return LastSolveMs; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FSolveResult
+	{
+		TArray<float> Cost;
+		TArray<int32> Next;
+	};
+
+	struct FField
+	{
+		TWeakObjectPtr<AActor> Station;
+		FVector GoalLocation = FVector::ZeroVector;
+		TArray<int32> GoalCells;
+
+		// Per metadata cell: cost to the station and the next cell on the way; empty until the first solve lands
+		TArray<float> Cost;
+		TArray<int32> Next;
+
+		UE::Tasks::TTask<FSolveResult> Solve;
+	};
+
+	struct FAreaModifier
+	{
+		FBox Bounds = FBox(ForceInit);
+		uint8 Area = 0;
+	};
+
+	UPROPERTY(Transient)
+	TObjectPtr<UNavMetadataSubsystem> NavMeta;
+
+	TArray<FField> Fields;
+
+	// Immutable once built, shared with the solve tasks
+	TSharedPtr<const FFlowFieldGraph> Graph;
+
+	// Area index per cell; index 0 is the default area
+	TArray<uint8> CellAreas;
+	TArray<TSubclassOf<UNavArea>> AreaClasses;
+	TMap<TWeakObjectPtr<const AActor>, FAreaModifier> Modifiers;
+
+	// Cells whose area changed since the last solve was launched
+	TSet<int32> DirtyCells;
+	bool bNeedsFullSolve = false;
+	bool bSolving = false;
+	bool bFullSolveInFlight = false;
+
+	double SolveStartTime = 0.0;
+	float LastSolveMs = 0.f;
+
+	FDelegateHandle BakedHandle;
+	FDelegateHandle AreaHandle;
+
+	void CollectStations();
+	void RebuildGraph();
+	void FindGoalCells(FField& Field) const;
+
+	uint8 GetAreaIndex(TSubclassOf<UNavArea> AreaClass);
+	FBox GetModifierBox(const FBox& Bounds) const;
+	void UpdateCellAreas(const FBox& Region);
+
+	void LaunchSolves();
+	void WaitForSolves();
+
+	void OnAreaSubmitted(const AActor* Owner, const FBox& Bounds, TSubclassOf<UNavArea> AreaClass);
+};
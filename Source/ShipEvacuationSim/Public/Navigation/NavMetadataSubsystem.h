@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavMetadataSubsystem.generated.h"
+
+class ANavigationData;
+class ARecastNavMesh;
+
+USTRUCT(BlueprintType)
+struct FNavMetadataSample
+{
+	GENERATED_BODY()
+
+	// Clear walkable width through this point (cm), narrowed by dynamic obstacles
+	UPROPERTY(BlueprintReadOnly, Category = "Navigation")
+	float ClearWidth = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Navigation")
+	float SlopeDegrees = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Navigation")
+	bool bStairs = false;
+
+	// Inside a dynamic obstacle such as a fire
+	UPROPERTY(BlueprintReadOnly, Category = "Navigation")
+	bool bBlocked = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Navigation")
+	int32 Deck = 0;
+};
+
+/**
+ * Navigation metadata baked on a 2D grid over the navmesh, one entry per walkable
+ * layer in each column: clear width, slope/stairs and deck id. Lookups are a hash
+ * probe plus a scan over the few layers in a column, so agents no longer project
+ * points onto the navmesh or read the floor normal every update.
+ *
+ * The bake is cached as NavMetadata/<Map>.navmeta, read from Saved first (where
+ * bakes are written) and then Content (so it can ship next to the map). A cache is
+ * only used if its navmesh tile CRC, bounds and every bake setting match; otherwise
+ * the grid is rebaked. Dynamic obstacles patch only the cells around them.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UNavMetadataSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Grid spacing in cm
+	UPROPERTY(Config)
+	float CellSize = 50.f;
+
+	// Widths are measured up to this far across (cm)
+	UPROPERTY(Config)
+	float MaxClearWidth = 400.f;
+
+	// Slope range treated as stairs, matching the old floor-normal test
+	UPROPERTY(Config)
+	float StairMinSlope = 10.f;
+
+	UPROPERTY(Config)
+	float StairMaxSlope = 45.f;
+
+	// Flat layers further apart than this are separate decks
+	UPROPERTY(Config)
+	float MinDeckSeparation = 150.f;
+
+	// Layers further than this from the query height are not matched
+	UPROPERTY(Config)
+	float MaxLayerDistance = 150.f;
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	bool IsBaked() const { return bBaked; }
+
+	// Location is at the agent's feet (GetNavAgentLocation)
+	UFUNCTION(BlueprintCallable, Category = "Navigation")
+	bool Lookup(const FVector& Location, FNavMetadataSample& OutSample) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Navigation")
+	int32 GetNumDecks() const { return DeckFloors.Num() > 0 ? DeckFloors.Num() : 1; }
+
+	// Cell graph: every layer is a cell, linked to the matching layer in the eight neighbouring columns
+	int32 GetNumCells() const { return Cells.Num(); }
+	int32 FindCellIndex(const FVector& Location) const;
+	FVector GetCellLocation(int32 Index) const;
+	void GetCellSample(int32 Index, FNavMetadataSample& OutSample) const;
+	void GetCellNeighbours(int32 Index, TArray<int32>& OutNeighbours) const;
+	void ForEachCellInBox(const FBox& Box, TFunctionRef<void(int32)> Callback) const;
+
+	// Broadcast when a bake or cache load replaces the cells, which invalidates cell indices
+	FSimpleMulticastDelegate OnBaked;
+
+	// Bakes from the current navmesh and writes the cache to Saved
+	bool Bake();
+
+	// Dynamic obstacles narrow or block the cells they cover; updating one only re-evaluates the cells around it
+	void UpdateObstacle(const UObject* Owner, const FBox& Bounds);
+	void RemoveObstacle(const UObject* Owner);
+
+	// USubsystem
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+private:
+	enum ECellFlags : uint8
+	{
+		Cell_Stairs = 1 << 0,
+		Cell_Blocked = 1 << 1,
+	};
+
+	struct FCell
+	{
+		float Height = 0.f;
+		uint16 ClearWidth = 0;
+		uint16 BakedWidth = 0;
+		uint8 SlopeDegrees = 0;
+		uint8 Flags = 0;
+		int16 Deck = 0;
+
+		friend FArchive& operator<<(FArchive& Ar, FCell& Cell)
+		{
+			return Ar << Cell.Height << Cell.BakedWidth << Cell.SlopeDegrees << Cell.Flags << Cell.Deck;
+		}
+	};
+
+	bool bBaked = false;
+
+	// Column -> [first layer, layer count) in Cells, layers sorted by height
+	TMap<FIntPoint, FIntPoint> Columns;
+	TArray<FCell> Cells;
+	TArray<FIntPoint> CellColumns;
+	TArray<float> DeckFloors;
+
+	// Cache key
+	FBox NavBounds = FBox(ForceInit);
+	int32 NavTileCount = 0;
+	uint32 NavDataCrc = 0;
+
+	TMap<TWeakObjectPtr<const UObject>, FBox> Obstacles;
+
+	ARecastNavMesh* GetNavMesh() const;
+	FIntPoint GetColumn(const FVector& Location) const;
+
+	void IndexColumns();
+
+	void BakeColumns(ARecastNavMesh& NavMesh);
+	void BakeSlopes();
+	void BakeDecks();
+	int32 GetDeckAt(float Height) const;
+
+	void PatchRegion(const FBox& Region);
+
+	void UpdateCacheKey(const ARecastNavMesh& NavMesh);
+	FString GetCacheName() const;
+	bool LoadCache(const FString& FilePath);
+	bool SaveCache(const FString& FilePath) const;
+
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+};
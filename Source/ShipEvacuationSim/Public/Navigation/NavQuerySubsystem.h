@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "NavQuerySubsystem.generated.h"
+
+class ANavigationData;
+
+struct FNavQueryResult
+{
+	// Projection: a navmesh point was found. Raycast: the ray hit the navmesh edge.
+	bool bSuccess = false;
+
+	// Projected point, or where the ray stopped
+	FVector Location = FVector::ZeroVector;
+};
+
+using FNavQueryCallback = TFunction<void(const FNavQueryResult&)>;
+
+/**
+ * Navmesh projections and raycasts for agents, run in batches on worker threads
+ * instead of one synchronous query at a time on the game thread.
+ *
+ * Requests made during a frame are launched together after the world has ticked and
+ * joined at the start of the next world tick, before the navigation system applies
+ * rebuilt tiles, so the Recast data does not change while queries are in flight. Callbacks
+ * run on the game thread at that point, in request order, and only while their owner
+ * is still alive.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UNavQuerySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Queries per worker batch
+	UPROPERTY(Config)
+	int32 BatchSize = 64;
+
+	// INVALID_NAVEXTENT uses the navmesh's default query extent
+	void ProjectPoint(const UObject* Owner, const FVector& Point, const FVector& Extent, FNavQueryCallback&& Callback);
+	void Raycast(const UObject* Owner, const FVector& Start, const FVector& End, FNavQueryCallback&& Callback);
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumQueued() const { return Queued.Num(); }
+
+	// Queries answered in the last batch, and its worker time (ms)
+	int32 GetLastBatchSize() const { return LastBatchSize; }
+	float GetLastBatchMs() const { return LastBatchMs; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FQuery
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		FNavQueryCallback Callback;
+
+		bool bRaycast = false;
+		FVector Start = FVector::ZeroVector;
+
+		// Ray end, or projection extent
+		FVector End = FVector::ZeroVector;
+
+		FNavQueryResult Result;
+	};
+
+	TArray<FQuery> Queued;
+	TArray<FQuery> InFlight;
+	UE::Tasks::TTask<double> Batch;
+
+	int32 LastBatchSize = 0;
+	float LastBatchMs = 0.f;
+
+	FDelegateHandle WorldTickHandle;
+
+	void LaunchBatch();
+	void CompleteBatch();
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime);
+};
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "NavUpdateSchedulerSubsystem.generated.h"
+
+class ANavigationData;
+class UNavArea;
+class UNavModifierComponent;
+class UPrimitiveComponent;
+
+// An actor's nav area covers Bounds from now on (the default area when it no longer modifies navigation)
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnNavAreaSubmitted, const AActor* /*Owner*/, const FBox& /*Bounds*/, TSubclassOf<UNavArea> /*AreaClass*/);
+
+/**
+ * Single entry point for runtime navmesh changes. Nav-affecting actors submit
+ * bound or area changes here instead of poking the navigation system directly.
+ *
+ * - Bound changes smaller than MinBoundsChange since the last submission are held back
+ *   and submitted once the component stops changing for BoundsSettleTime, or after
+ *   MaxBoundsDelay, so slow growth still reaches the navmesh.
+ * - Repeated requests for one component coalesce; an area change that returns to
+ *   the applied area before it is submitted cancels out.
+ * - Requests whose tile-aligned dirty areas overlap are submitted in the same
+ *   frame, so shared tiles are rebuilt once.
+ * - Submission stops when the frame budget is spent or when the navmesh generator
+ *   (which rebuilds tiles on worker threads) already has MaxPendingTileBuilds queued.
+ *
+ * "stat NavUpdates" shows queue depth, pending tile builds, submit time and rebuild latency.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UNavUpdateSchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Bounds must move by at least this much (cm, any corner) to trigger a rebuild
+	UPROPERTY(Config)
+	float MinBoundsChange = 50.f;
+
+	// Smaller changes are submitted after this long without another request (s)...
+	UPROPERTY(Config)
+	float BoundsSettleTime = 1.f;
+
+	// ...or this long after the first of them, if the component keeps changing (s)
+	UPROPERTY(Config)
+	float MaxBoundsDelay = 5.f;
+
+	// Game-thread time per frame spent submitting changes (ms)
+	UPROPERTY(Config)
+	float FrameBudgetMs = 1.0f;
+
+	// Hold new submissions while the generator has more tile builds than this outstanding
+	UPROPERTY(Config)
+	int32 MaxPendingTileBuilds = 64;
+
+	// Bounds of a nav-relevant component changed; bForce skips the size threshold and the delay
+	void RequestBoundsUpdate(UPrimitiveComponent* Component, bool bForce = false);
+
+	void RequestAreaChange(UNavModifierComponent* Modifier, TSubclassOf<UNavArea> AreaClass);
+
+	// Fires as each change is handed to the navigation system, at the coalesced rate
+	FOnNavAreaSubmitted OnAreaSubmitted;
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetQueueDepth() const { return Pending.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumSubmitted() const { return NumSubmitted; }
+
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	int32 GetNumDropped() const { return NumDropped; }
+
+	// Time from the first submission to the generator finishing, for the last rebuild
+	UFUNCTION(BlueprintPure, Category = "Navigation")
+	float GetLastRebuildMs() const { return LastRebuildMs; }
+
+	// USubsystem / FTickableGameObject
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FRequest
+	{
+		TWeakObjectPtr<UActorComponent> Component;
+		FBox DirtyBounds = FBox(ForceInit);
+
+		bool bAreaChange = false;
+		TSubclassOf<UNavArea> AreaClass;
+	};
+
+	TMap<TWeakObjectPtr<UActorComponent>, FRequest> Pending;
+
+	// Components with bound changes below MinBoundsChange: world time of the first and latest
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, FVector2D> Deferred;
+
+	// What the navmesh was last told, to measure changes against
+	TMap<TWeakObjectPtr<UActorComponent>, FBox> SubmittedBounds;
+	TMap<TWeakObjectPtr<UActorComponent>, TSubclassOf<UNavArea>> AppliedAreas;
+
+	int32 NumSubmitted = 0;
+	int32 NumDropped = 0;
+	float LastSubmitMs = 0.f;
+	float LastRebuildMs = 0.f;
+	double RebuildStartTime = 0.0;
+
+	void QueueBoundsUpdate(UPrimitiveComponent* Component);
+	void PromoteDeferred();
+	void Submit(const FRequest& Request);
+
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+};
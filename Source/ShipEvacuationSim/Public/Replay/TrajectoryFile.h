@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+enum class ETrajectoryAgentState : uint8
+{
+	None = 0,
+	Mustered = 1 << 0,
+	Stuck = 1 << 1,
+	Recovering = 1 << 2,
+	OnStairs = 1 << 3,
+};
+ENUM_CLASS_FLAGS(ETrajectoryAgentState);
+
+struct FTrajectorySample
+{
+	int32 AgentId = 0;
+	FVector3f Location = FVector3f::ZeroVector;
+	float Speed = 0.f;
+	int32 Deck = 0;
+	ETrajectoryAgentState State = ETrajectoryAgentState::None;
+};
+
+// All agents at one sample time, sorted by AgentId
+struct FTrajectoryFrame
+{
+	double Time = 0.0;
+	TArray<FTrajectorySample> Samples;
+};
+
+/**
+ * Chunked trajectory recording (.simtraj).
+ *
+ * A header is followed by independently decodable chunks of frames and, once
+ * the recording is closed, a chunk index and footer. Inside a chunk each value
+ * is stored as a zig-zag varint delta against the same agent's previous sample
+ * in that chunk (positions in cm, speeds in cm/s), then the chunk is compressed.
+ * Readers use the index to seek, or scan chunk headers when the footer is missing
+ * because the recording is still being written or the process died.
+ */
+namespace TrajectoryFile
+{
+	static constexpr uint32 Magic = 0x4A525453;		// "STRJ"
+	static constexpr uint32 ChunkMagic = 0x4B4E4843;	// "CHNK"
+	static constexpr uint32 FooterMagic = 0x58444E49;	// "INDX"
+	static constexpr uint32 Version = 1;
+
+	struct FChunkInfo
+	{
+		int64 Offset = 0;
+		int32 NumFrames = 0;
+		double StartTime = 0.0;
+		double EndTime = 0.0;
+	};
+
+	// Serialises frames into the uncompressed chunk payload
+	void EncodeFrames(const TArray<FTrajectoryFrame>& Frames, double StartTime, TArray<uint8>& OutPayload);
+	bool DecodeFrames(const TArray<uint8>& Payload, int32 NumFrames, double StartTime, TArray<FTrajectoryFrame>& OutFrames);
+}
+
+/** Appends compressed chunks to a .simtraj file. Not thread safe; use from one thread at a time. */
+class SHIPEVACUATIONSIM_API FTrajectoryWriter
+{
+public:
+	~FTrajectoryWriter();
+
+	bool Open(const FString& FilePath, float SampleInterval);
+
+	// Writes the chunk index and footer
+	void Close();
+
+	bool IsOpen() const { return Handle.IsValid(); }
+
+	void WriteChunk(const TArray<FTrajectoryFrame>& Frames);
+
+private:
+	TUniquePtr<IFileHandle> Handle;
+	TArray<TrajectoryFile::FChunkInfo> Chunks;
+};
+
+/**
+ * Reads a .simtraj one chunk at a time. The file is memory-mapped where the
+ * platform supports it and read through a file handle otherwise.
+ */
+class SHIPEVACUATIONSIM_API FTrajectoryReader
+{
+public:
+	~FTrajectoryReader();
+
+	bool Open(const FString& FilePath);
+	void Close();
+
+	float GetSampleInterval() const { return SampleInterval; }
+	double GetStartTime() const;
+	double GetEndTime() const;
+
+	int32 GetNumChunks() const { return Chunks.Num(); }
+	const TrajectoryFile::FChunkInfo& GetChunkInfo(int32 Index) const { return Chunks[Index]; }
+
+	// Index of the chunk covering Time, clamped to the recording
+	int32 FindChunk(double Time) const;
+
+	bool ReadChunk(int32 Index, TArray<FTrajectoryFrame>& OutFrames) const;
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TUniquePtr<IFileHandle> Handle;
+	int64 FileSize = 0;
+
+	float SampleInterval = 0.f;
+	TArray<TrajectoryFile::FChunkInfo> Chunks;
+
+	bool ReadBytes(int64 Offset, void* Dest, int64 Size) const;
+	bool ReadIndex();
+	void ScanChunks(int64 Offset);
+};
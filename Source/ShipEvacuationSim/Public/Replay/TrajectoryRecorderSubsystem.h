@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Replay/TrajectoryFile.h"
+#include "Tasks/Pipe.h"
+#include "TrajectoryRecorderSubsystem.generated.h"
+
+/**
+ * Samples every registered agent's position, speed, deck and state at a fixed
+ * rate and writes them to Run_N.simtraj. Sampling happens on the game thread;
+ * encoding, compression and file writes run in order on a task pipe.
+ */
+UCLASS(config = Game)
+class SHIPEVACUATIONSIM_API UTrajectoryRecorderSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Samples per second of simulated time
+	UPROPERTY(Config)
+	float SampleRate = 2.0f;
+
+	UPROPERTY(Config)
+	int32 FramesPerChunk = 64;
+
+	// Deck bands used when the map has no baked navigation metadata
+	UPROPERTY(Config)
+	float DeckBaseZ = 0.0f;
+
+	UPROPERTY(Config)
+	float DeckHeight = 300.0f;
+
+	void BeginRecording(const FString& FilePath);
+
+	// Blocks until all queued chunks and the index are written
+	void EndRecording();
+
+	UFUNCTION(BlueprintPure, Category = "Replay")
+	bool IsRecording() const { return Writer.IsValid(); }
+
+	// USubsystem
+	virtual void Deinitialize() override;
+
+private:
+	TSharedPtr<FTrajectoryWriter> Writer;
+	UE::Tasks::FPipe WritePipe { TEXT("TrajectoryRecorder") };
+	UE::Tasks::FTask LastWrite;
+
+	TArray<FTrajectoryFrame> PendingFrames;
+	double RecordingStartTime = 0.0;
+
+	FTimerHandle SampleTimer;
+
+	void Sample();
+	void FlushChunk();
+};
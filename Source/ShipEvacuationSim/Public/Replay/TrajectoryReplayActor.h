@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Replay/TrajectoryFile.h"
+#include "TrajectoryReplayActor.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+/**
+ * Plays a .simtraj recording back as instanced meshes. No agents, AI,
+ * navigation or physics are involved; positions are interpolated between
+ * recorded frames and chunks are decoded as playback reaches them.
+ *
+ * Per-instance custom data: 0 = ETrajectoryAgentState flags, 1 = speed (cm/s).
+ */
+UCLASS()
+class SHIPEVACUATIONSIM_API ATrajectoryReplayActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ATrajectoryReplayActor();
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Replay")
+	UInstancedStaticMeshComponent* Instances;
+
+	// Recording loaded on BeginPlay when set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	FString FilePath;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay", meta = (ClampMin = "0.0"))
+	float PlaybackRate = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	bool bLoop = false;
+
+	// Mesh scale for one agent; the default cylinder is 100 x 100 x 100
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replay")
+	FVector AgentScale = FVector(0.4f, 0.4f, 1.8f);
+
+	UFUNCTION(BlueprintCallable, Category = "Replay")
+	bool LoadRecording(const FString& InFilePath);
+
+	UFUNCTION(BlueprintCallable, Category = "Replay")
+	void SetPlaybackTime(float Time);
+
+	UFUNCTION(BlueprintPure, Category = "Replay")
+	float GetPlaybackTime() const { return PlaybackTime; }
+
+	UFUNCTION(BlueprintPure, Category = "Replay")
+	float GetDuration() const;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	FTrajectoryReader Reader;
+
+	// Decoded frames of the current chunk, and the next chunk so playback can interpolate across the boundary
+	int32 LoadedChunk = INDEX_NONE;
+	TArray<FTrajectoryFrame> Frames;
+	TArray<FTrajectoryFrame> NextFrames;
+
+	double PlaybackTime = 0.0;
+	bool bPlaying = false;
+
+	TMap<int32, int32> AgentInstances;
+	TArray<FTransform> Transforms;
+
+	void LoadChunkAt(double Time);
+	void UpdateInstances();
+	int32 GetOrAddInstance(int32 AgentId);
+};
@@ -6,6 +6,77 @@
 #include "Engine/GameInstance.h"
 #include "SimulationInstance.generated.h"
 
+/**
+ * Batch settings read from the command line, e.g.
+ * -nullrhi -SimRuns=50 -SimSeed=7 -SimMap=M_TestFull -SimFixedStep=0.05
+ * Run farm workers also get -SimRunStart and -SimLogDir.
+ * -SimRecord[=Hz] writes agent trajectories; -SimReplay=<file.simtraj> plays one back instead of simulating.
+ * -SimLod turns on the simulation LOD; compare its muster times against a batch without it.
+ * -SimNavMeshWalk moves agents by navmesh projection where it is safe; compare its movement cost against a batch without it.
+ * -SimParams="Class.Property=Value,..." overrides actor properties for every run (see FSimulationParameters).
+ * -SimReload reloads the level between runs instead of resetting it in place.
+ */
+USTRUCT(BlueprintType)
+struct FSimulationBatchSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	int32 NumRuns = 50;
+
+	// Index of this process's first run, so shards write distinct Run_N files
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	int32 FirstRun = 0;
+
+	// Run N is seeded with Seed + N
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	int32 Seed = 0;
+
+	// Level to run; empty keeps the level the game started in
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	FString MapName;
+
+	// Output directory for run logs; defaults to Saved/SimulationLogs/
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	FString LogDirectory;
+
+	// Simulation step in seconds; 0 runs in real time
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	float FixedTimeStep = 0.f;
+
+	// True when there is no renderer (-nullrhi)
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	bool bHeadless = false;
+
+	// Record Run_N.simtraj next to the run logs
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	bool bRecordTrajectories = false;
+
+	// Samples per second; 0 uses the recorder's configured rate
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	float TrajectorySampleRate = 0.f;
+
+	// Recording to play back; agents are not simulated when set
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	FString ReplayFile;
+
+	// Demote agents in empty, hazard-free areas to a cheaper update; off unless asked for, as it changes results
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	bool bSimulationLod = false;
+
+	// Move walking agents by navmesh projection away from dynamic obstacles; off unless asked for, as it changes results
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	bool bNavMeshWalking = false;
+
+	// Allow the simulation manager to reset the level in place between runs
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	bool bResetInPlace = true;
+
+	// Property overrides, Class.Property=Value pairs separated by commas
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	FString Parameters;
+};
+
 /**
  * 
  */
@@ -17,4 +88,16 @@ class SHIPEVACUATIONSIM_API USimulationInstance : public UGameInstance
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	int32 PersistentRunIndex = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Simulation")
+	FSimulationBatchSettings BatchSettings;
+
+	UFUNCTION(BlueprintPure, Category = "Simulation")
+	bool IsReplaying() const { return !BatchSettings.ReplayFile.IsEmpty(); }
+
+	virtual void Init() override;
+	virtual void OnStart() override;
+
+private:
+	void ParseBatchSettings();
 };
@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Batch/SimulationParameters.h"
 #include "SimulationManager.generated.h"
 
+class AAiCharacter;
+
 UCLASS()
 class SHIPEVACUATIONSIM_API ASimulationManager : public AActor
 {
@@ -16,25 +19,75 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, Category = "Simulation")
 	int32 MusteredAgents;
+
+	// Number of agents in the run: the larger of what spawners declared and the peak registered count
+	UPROPERTY(BlueprintReadWrite, Category = "Simulation")
+	int32 Population = 0;
+
+	// Spawners that create agents over time declare their total up front, so the run does not end
+	// as AllMustered before the last of them exists. Cleared by the in-place reset.
+	UFUNCTION(BlueprintCallable, Category = "Simulation")
+	void DeclarePopulation(int32 NumAgents);
+
+	// End the run when no agent has moved or mustered for this long (seconds, 0 disables)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	float StallTimeout = 120.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation", meta = (ClampMin = "0.1"))
+	float ProgressCheckInterval = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	float SimulationTimeout = 1800.0f;
+
+	// Reset agents and volumes in place between runs instead of reloading the level.
+	// Only used when a native agent spawner or a Blueprint implementing ISimulationResettable
+	// can repopulate the level; -SimReload turns it off.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bResetInPlace = true;
+
+	// Write Run_N.simtraj for offline replay; also enabled by -SimRecord
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Simulation")
+	bool bRecordTrajectories = false;
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
 	int32 RunIndex = 0;
+	int32 FirstRunIndex = 0;
 	int32 TotalSimulations = 50;
-	int32 MinutesElapsed = 1;
 
 	FString LogDirectoryPath;
-	FString CurrentSimFilePath;
 
-	FTimerHandle MinuteLogTimer;
+	// -SimParams overrides, applied at run start and to actors spawned during the run
+	FSimulationParameters Parameters;
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle AgentActivatedHandle;
+
 	FTimerHandle SimulationTimeoutTimer;
+	FTimerHandle ProgressCheckTimer;
 
+	bool bSimulationEnded = false;
+	int32 LastMusteredCount = 0;
+	int32 DeclaredPopulation = 0;
+	double LastProgressTime = 0.0;
+
+	// Simulated seconds (world time) and wall-clock seconds at run start
 	double SimulationStartTime = 0.0;
+	double WallStartTime = 0.0;
+
+	void SeedRun();
+	void StartRun();
+	void ResetWorldForNextRun();
+	bool CanResetInPlace() const;
 
-	void LogMinuteProgress();
-	void EndCurrentSimulation();
+	void CheckRunProgress();
+	void OnSimulationTimeout();
+	void EndCurrentSimulation(const TCHAR* Reason);
 
 	int32 CountMusteredAgents();
+
+	void OnActorSpawned(AActor* Actor);
+	void OnPooledAgentActivated(AAiCharacter* Agent);
 };
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "SimulationResettable.generated.h"
+
+UINTERFACE(MinimalAPI, Blueprintable)
+class USimulationResettable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors that keep per-run state implement this so the simulation manager can
+ * start the next run without reloading the level. Blueprint spawners implement
+ * it to spawn a fresh population.
+ */
+class SHIPEVACUATIONSIM_API ISimulationResettable
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Simulation")
+	void ResetForNewRun();
+};
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "SimulationResettable.h"
 #include "CrowdDensityVolume.generated.h"
 
 class UNavModifierComponent;
@@ -12,7 +13,7 @@ class UBoxComponent;
  * It modifies the navmesh cost through a NavModifierComponent when congested.
  */
 UCLASS()
-class SHIPEVACUATIONSIM_API ACrowdDensityVolume : public AActor
+class SHIPEVACUATIONSIM_API ACrowdDensityVolume : public AActor, public ISimulationResettable
 {
 	GENERATED_BODY()
 
@@ -38,6 +39,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "")
 	float CheckInterval = 5.0f;
 
+	UFUNCTION(BlueprintPure, Category = "Crowd")
+	bool IsCongested() const { return bIsCongested; }
+
+	// Clears congestion and restores the default nav area
+	virtual void ResetForNewRun_Implementation() override;
+
 protected:
 	virtual void BeginPlay() override;
 
@@ -2,13 +2,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "SimulationResettable.h"
 #include "FireVolume.generated.h"
 
 class UBoxComponent;
 class UNavModifierComponent;
 
 UCLASS()
-class SHIPEVACUATIONSIM_API AFireVolume : public AActor
+class SHIPEVACUATIONSIM_API AFireVolume : public AActor, public ISimulationResettable
 {
 	GENERATED_BODY()
 
@@ -17,6 +18,7 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	// Collision volume that expands over time
@@ -41,6 +43,9 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fire Volume")
 	FVector2D MaxXYSize = FVector2D(5000.f, 5000.f);
 
+	// Shrinks the fire back to its initial extent and restarts the expansion
+	virtual void ResetForNewRun_Implementation() override;
+
 private:
 	float ElapsedTime = 0.0f;
 	FVector InitialExtent;
@@ -48,4 +53,5 @@ private:
 	FTimerHandle ExpansionTimerHandle;
 
 	void ExpandVolumeStep();
+	void ApplyExtent(const FVector& NewExtent);
 };